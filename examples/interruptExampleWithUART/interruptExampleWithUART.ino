@@ -9,7 +9,8 @@
  *
  *              Using interrupts can be useful to get faster readings. This works with the idea that we do not need to
  *check constantly the RFID board for new RFID data, but the RFID board will inform us when there is new data available
- *(by pulling INT pin high).
+ *(by pulling INT pin high). The library handles the interrupt itself: it arms the read on the INT edge, rfid.poll() in
+ *the loop() reads the tag only then and passes it to the callback function.
  *
  *              Default UART speed is 9600, but communication speed can be changed by changing the position of the DIP
  *switches on the breakout.
@@ -44,19 +45,23 @@
 // RFID INT pin is connected to the D2 of the Dasduino Core.
 #define INT_PIN 2
 
-// Flag for interrupt event. Set it to false at start up.
-// Flag must be declared as volatile since it's used in the interrupt routine.
-volatile bool rfidIntFlag = false;
+// RFID library constructor. Set RX pin, TX pin and baud for RFID communicaton speed (software serial).
+Rfid rfid(RX_PIN, TX_PIN, 9600);
 
-// Interrupt function. It just sets the flag to true.
-// NOTE: Do not read RFID from the interrupt function!
-void isr()
+// Function called with every tag read. It gets the tag ID, the RAW RFID data and the time of the INT edge.
+void printTag(const TagEvent &_event)
 {
-    rfidIntFlag = true;
-}
+    Serial.print("Tag available! Tag ID: ");
+    Serial.print(_event.id);
+    Serial.print(" RAW RFID Data: ");
 
-// RFID library constructor. Set RX pin, TX pin and baud for RFID communicaton speed (software serial).
-Rfid rfid(RX_PIN, TX_PIN, 9600);
+    // Print out a RAW RFID data (with RFID header, RFID data, parity bits, etc).
+    // Special function must be used in order to print 64 bit int.
+    rfid.printHex64(_event.raw);
+
+    // Send a new line at the end.
+    Serial.println();
+}
 
 void setup()
 {
@@ -80,34 +85,16 @@ void setup()
         }
     }
 
-    // Attach interrupt on INT pin of the RFID on rising edge.
-    attachInterrupt(digitalPinToInterrupt(INT_PIN), isr, RISING);
+    // Let the library handle the INT pin of the RFID (on rising edge) and send the tags to the printTag().
+    rfid.attachInterruptPin(INT_PIN, RISING);
+    rfid.onTag(printTag);
 
     Serial.println("Place your tag near RFID antenna");
 }
 
 void loop()
 {
-    // Check if the interrupt flag is set. That means, there is new tag available.
-    if (rfidIntFlag)
-    {
-        // Clear the flag, so we can be ready for the next RFID tag.
-        rfidIntFlag = false;
-
-        // Check if there is vaild tag data available.
-        if (rfid.available())
-        {
-            // If there is, read it and print it on the serial.
-            Serial.print("Tag available! Tag ID: ");
-            Serial.print(rfid.getId());
-            Serial.print(" RAW RFID Data: ");
-
-            // Print out a RAW RFID data (with RFID header, RFID data, parity bits, etc).
-            // Special function must be used in order to print 64 bit int.
-            rfid.printHex64(rfid.getRaw());
-
-            // Send a new line at the end.
-            Serial.println();
-        }
-    }
-}
\ No newline at end of file
+    // Read the tag if the INT pin has signaled it, spending at most 1000 microseconds here. The tag goes to the
+    // printTag() function.
+    rfid.poll(1000);
+}
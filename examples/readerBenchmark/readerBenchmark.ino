@@ -0,0 +1,247 @@
+/**
+ **************************************************
+ *
+ * @file        readerBenchmark.ino
+ * @brief       Benchmark of the reader stack on the board. Prints the results over the serial as CSV rows (case,
+ *variant, value, unit, n), the same rows as extras/host/rfid_bench on Linux, so the results from the board and from the
+ *host can be kept in one file and compared. No breakout is needed, upload the code, open the serial monitor at 115200
+ *bauds and copy the rows.
+ *
+ *              Cases run on the board:
+ *              parse           Rfid::available() over a Stream in the memory, per frame. Reader waits
+ *                              SERIAL_TIMEOUT_MS after the last byte of the frame, the wait is subtracted.
+ *              print_hex64     RfidFormat::printHex64() to a Print that drops the bytes.
+ *              queue_*         circular_queue push, pop, pop_n and for_each per element, for_each with the
+ *                              lambda (inlined into the loop) and with the Delegate, the way SoftwareSerial drains
+ *                              its ISR buffer (ESP32 only).
+ *              tx              SoftwareSerial write() bytes per second on TX_PIN (ESP32 only).
+ *
+ *              Cases that need the virtual pins and the virtual breakout (rxbits, easyc_*) run on Linux only, see
+ *              extras/host/rfid_bench.cpp.
+ *
+ *  products:   www.solde.red/333273 - 125kHz RFID board with easyC
+ *
+ * @authors     Borna Biro for Soldered.com
+ ***************************************************/
+
+// Include brekaout specific library.
+#include "RFID-SOLDERED.h"
+#include "RFID-EM4100.h"
+#include "RFID-EVENT.h"
+#include "RFID-FORMAT.h"
+
+#ifdef ARDUINO_ESP32_DEV
+#include "libs/ESPSoftwareSerial/circular_queue/circular_queue.h"
+
+// Free pin for the software serial TX benchmark (nothing needs to be connected).
+#define TX_PIN 5
+#endif
+
+// Number of frames, calls and elements of each case.
+#define FRAMES   20
+#define CALLS    10000
+#define ELEMENTS 256
+#define ROUNDS   20
+
+// Stream holding one frame at a time.
+class FrameStream : public Stream
+{
+  public:
+    const char *frame = "";
+    size_t length = 0;
+    size_t index = 0;
+
+    void load(const char *_text)
+    {
+        frame = _text;
+        length = strlen(_text);
+        index = 0;
+    }
+    int available()
+    {
+        return length - index;
+    }
+    int read()
+    {
+        return index < length ? (uint8_t)frame[index++] : -1;
+    }
+    int peek()
+    {
+        return index < length ? (uint8_t)frame[index] : -1;
+    }
+    size_t write(uint8_t)
+    {
+        return 1;
+    }
+    using Print::write;
+};
+
+// Print that drops the bytes.
+class NullPrint : public Print
+{
+  public:
+    uint32_t bytes = 0;
+
+    size_t write(uint8_t _c)
+    {
+        bytes += _c;
+        return 1;
+    }
+    using Print::write;
+};
+
+// Sum of the outputs, so the compiler can't drop the work.
+volatile uint32_t sink;
+
+void report(const char *_name, const char *_variant, float _value, const char *_unit, uint32_t _n)
+{
+    Serial.print(_name);
+    Serial.print(',');
+    Serial.print(_variant);
+    Serial.print(',');
+    Serial.print(_value, 3);
+    Serial.print(',');
+    Serial.print(_unit);
+    Serial.print(',');
+    Serial.println(_n);
+}
+
+void benchParse()
+{
+    // Frame of the tag 123456 with version 0x1F, as the breakout sends it.
+    char frame[40];
+    char hex[RFID_FORMAT_HEX64_SIZE];
+    RfidFormat::hex64(Em4100::encode(0x1F, 123456), hex);
+    sprintf(frame, "$123456&%s\r\n", hex);
+
+    for (int v = 0; v < 2; v++)
+    {
+        FrameStream stream;
+        Rfid rfid(stream);
+        rfid.begin();
+        rfid.setFrameValidation(v == 0);
+
+        uint32_t total = 0;
+        for (int i = 0; i < FRAMES; i++)
+        {
+            stream.load(frame);
+            unsigned long start = micros();
+            rfid.available();
+            total += micros() - start;
+            sink += rfid.getId();
+        }
+
+        float perFrame = (float)total / FRAMES - SERIAL_TIMEOUT_MS * 1000.0;
+        report("parse", v == 0 ? "validation=on" : "validation=off", perFrame * 1000, "ns/frame", FRAMES);
+    }
+}
+
+void benchHex()
+{
+    NullPrint print;
+    unsigned long start = micros();
+    for (uint32_t i = 0; i < CALLS; i++)
+        RfidFormat::printHex64(print, 0x1F0001E240ULL + i * 0x9E3779B97F4A7C15ULL);
+    report("print_hex64", "print", (float)(micros() - start) * 1000 / CALLS, "ns/call", CALLS);
+    sink += print.bytes;
+}
+
+#ifdef ARDUINO_ESP32_DEV
+template <typename T> void benchQueue(const char *_variant)
+{
+    circular_queue<T, uint32_t *> queue(ELEMENTS);
+    T buffer[32];
+    uint32_t push = 0, pop = 0, popN = 0, forEach = 0, forEachDelegate = 0;
+    uint32_t sum = 0;
+    const Delegate<void(T &&), uint32_t *> counter = {[](uint32_t *_sum, T &&) { (*_sum)++; }, &sum};
+
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        unsigned long start = micros();
+        for (int i = 0; i < ELEMENTS; i++)
+            queue.push(T());
+        push += micros() - start;
+
+        start = micros();
+        for (int i = 0; i < ELEMENTS; i++)
+            queue.pop();
+        pop += micros() - start;
+
+        for (int i = 0; i < ELEMENTS; i++)
+            queue.push(T());
+        start = micros();
+        while (size_t _popped = queue.pop_n(buffer, 32))
+            sum += _popped;
+        popN += micros() - start;
+
+        for (int i = 0; i < ELEMENTS; i++)
+            queue.push(T());
+        start = micros();
+        queue.for_each([&sum](T &&) { sum++; });
+        forEach += micros() - start;
+
+        for (int i = 0; i < ELEMENTS; i++)
+            queue.push(T());
+        start = micros();
+        queue.for_each(counter);
+        forEachDelegate += micros() - start;
+    }
+    sink += sum;
+
+    uint32_t n = (uint32_t)ELEMENTS * ROUNDS;
+    report("queue_push", _variant, (float)push * 1000 / n, "ns/element", n);
+    report("queue_pop", _variant, (float)pop * 1000 / n, "ns/element", n);
+    report("queue_pop_n", _variant, (float)popN * 1000 / n, "ns/element", n);
+    report("queue_for_each", _variant, (float)forEach * 1000 / n, "ns/element", n);
+    report("queue_for_each_delegate", _variant, (float)forEachDelegate * 1000 / n, "ns/element", n);
+}
+
+void benchTx()
+{
+    const uint32_t bauds[] = {9600, 38400, 115200};
+    uint8_t data[64];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = i * 37;
+
+    for (uint32_t baud : bauds)
+    {
+        SoftwareSerial serial(-1, TX_PIN);
+        serial.begin(baud);
+
+        // About a quarter of a second at each baud rate.
+        uint32_t writes = baud / 2400;
+        unsigned long start = micros();
+        for (uint32_t i = 0; i < writes; i++)
+            serial.write(data, sizeof(data));
+        float seconds = (micros() - start) / 1e6;
+
+        char variant[16];
+        sprintf(variant, "baud=%lu", (unsigned long)baud);
+        report("tx", variant, writes * sizeof(data) / seconds, "bytes/s", writes * sizeof(data));
+    }
+}
+#endif
+
+void setup()
+{
+    // Initialize the serial communication via UART
+    Serial.begin(115200);
+    delay(1000);
+
+    Serial.println("case,variant,value,unit,n");
+    benchParse();
+    benchHex();
+#ifdef ARDUINO_ESP32_DEV
+    benchQueue<uint8_t>("type=uint8_t");
+    benchQueue<uint32_t>("type=uint32_t");
+    benchQueue<uint64_t>("type=uint64_t");
+    benchQueue<TagEvent>("type=TagEvent");
+    benchTx();
+#endif
+    Serial.println("done");
+}
+
+void loop()
+{
+    // Nothing here, the benchmark runs once.
+}
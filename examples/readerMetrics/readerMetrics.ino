@@ -0,0 +1,100 @@
+/**
+ **************************************************
+ *
+ * @file        readerMetrics.ino
+ * @brief       Example that shows how to collect the health metrics of the reader (tags read, rejected frames, easyC
+ *bus transactions and errors, check rate...) and send them to the monitoring. Connect the module with Dasduino board
+ *with easyC cable, connect RFID antenna to the breakout board, upload the code and open the serial monitor. Every 10
+ *seconds the metrics are printed in the InfluxDB line protocol, send the same snapshot over your uplink (MQTT,
+ *HTTP, LoRa...) instead. For the slow links use the binary snapshot (RFID_METRICS_BINARY) and send the schema
+ *(RFID_METRICS_SCHEMA) only when its hash changes.
+ *
+ *              The reader also uses the adaptive polling: the breakout is checked often while the tags come and
+ *less and less often while they don't, so the idle reader barely uses the bus.
+ *
+ *  products:   www.solde.red/333273 - 125kHz RFID board with easyC
+ *              www.solde.red/108343 - easyC cable 10cm
+ *
+ * @authors     Borna Biro for Soldered.com
+ ***************************************************/
+
+// Include brekaout specific library.
+#include "RFID-SOLDERED.h"
+
+// Include metrics registry.
+#include "RFID-METRICS.h"
+
+// The metrics, the adaptive polling and the bus stats are left out of the reader on AVR to save RAM, build with
+// -DRFID_METRICS=1 -DRFID_ADAPTIVE_POLLING=1 -DRFID_BUS_STATS=1 to use them there.
+#if !RFID_METRICS || !RFID_ADAPTIVE_POLLING || !RFID_BUS_STATS
+#error "This example needs RFID_METRICS, RFID_ADAPTIVE_POLLING and RFID_BUS_STATS"
+#endif
+
+// RFID library constructor. For easyC usage, there should be no parameters sent to the constructor.
+Rfid rfid;
+
+// Registry of the metrics, it can hold the metrics of more readers.
+RfidMetrics metrics;
+
+// Buffer for the snapshot, big enough for the line protocol of one easyC reader.
+uint8_t snapshot[512];
+
+// Time of the last snapshot.
+unsigned long lastSnapshot = 0;
+
+void setup()
+{
+    // Initialize the serial communication via UART
+    Serial.begin(115200);
+
+    // Initialize RFID library in easyC mode.
+    rfid.begin();
+
+    // Check hardware connections to  the module.
+    if (!rfid.checkHW())
+    {
+        // Send message to the serial.
+        Serial.println("No module detected, check wiring and I2C address!");
+
+        // Stop the code
+        while (1)
+        {
+            // For Dasduino Connect.
+            delay(1);
+        }
+    }
+
+    // Register the metrics of the reader under the name "door1" (it shows up as the source in the snapshot).
+    rfid.setMetrics(&metrics, "door1");
+
+    // Check the breakout every 10 ms after a tag, backing off to once every 250 ms while no tag comes.
+    rfid.setAdaptivePolling(true);
+
+    Serial.println("Place your tag near RFID antenna");
+}
+
+void loop()
+{
+    // Check if there is vaild tag data available.
+    if (rfid.available())
+    {
+        Serial.print("Tag available! Tag ID: ");
+        Serial.println(rfid.getId());
+    }
+
+    // Every 10 seconds print the snapshot of all the metrics.
+    if ((unsigned long)(millis() - lastSnapshot) >= 10000)
+    {
+        lastSnapshot = millis();
+
+        size_t length = metrics.snapshot(snapshot, sizeof(snapshot), RFID_METRICS_LINE);
+        Serial.write(snapshot, length);
+
+        // Check rate and bus utilisation of the last second.
+        Serial.print("Checks per second: ");
+        Serial.print(rfid.pollRate());
+        Serial.print(" Bus utilisation: ");
+        Serial.print(rfid.busUtilization(), 3);
+        Serial.println(" %");
+    }
+}
@@ -0,0 +1,104 @@
+/**
+ **************************************************
+ *
+ * @file        readerWiegand.ino
+ * @brief       Example that shows how to send the tag IDs to the access panel over Wiegand 26. Connect the module with
+ *Dasduino board with easyC cable, connect RFID antenna to the breakout board, connect D0 and D1 lines of the access
+ *panel to the pins 25 and 26 (with the level shifter if the panel uses 5V lines) and upload the code. Each tag placed
+ *near antenna is sent to the panel.
+ *
+ *              On ESP32 the Wiegand pulses are clocked out by the hardware timer, so they are accurate whatever
+ *loop() does (reading the tag included). On the other boards update() is called from loop() and the tag is read with
+ *poll(), which never waits for the whole read, so loop() comes back to update() often enough. For accurate pulses on
+ *those boards call update() from a timer interrupt instead, for example with the TimerOne library:
+ *
+ *              Timer1.initialize(50);
+ *              Timer1.attachInterrupt(wiegandTick);
+ *
+ *              void wiegandTick()
+ *              {
+ *                  wiegand.update();
+ *              }
+ *
+ *  products:   www.solde.red/333273 - 125kHz RFID board with easyC
+ *              www.solde.red/108343 - easyC cable 10cm
+ *
+ * @authors     Borna Biro for Soldered.com
+ ***************************************************/
+
+// Include brekaout specific library.
+#include "RFID-SOLDERED.h"
+
+// Include Wiegand transmitter.
+#include "RFID-WIEGAND.h"
+
+// RFID library constructor. For easyC usage, there should be no parameters sent to the constructor.
+Rfid rfid;
+
+// Wiegand transmitter on D0 = pin 25 and D1 = pin 26.
+RfidWiegand wiegand(25, 26);
+
+void setup()
+{
+    // Initialize the serial communication via UART
+    Serial.begin(115200);
+
+    // Initialize RFID library in easyC mode.
+    rfid.begin();
+
+    // Check hardware connections to  the module.
+    if (!rfid.checkHW())
+    {
+        // Send message to the serial.
+        Serial.println("No module detected, check wiring and I2C address!");
+
+        // Stop the code
+        while (1)
+        {
+            // For Dasduino Connect.
+            delay(1);
+        }
+    }
+
+    // Set both Wiegand lines to idle (high). Default timing is 50 us pulses, 1 ms apart (check the panel documentation
+    // and change it with setTiming() if needed).
+    wiegand.begin();
+
+#ifdef ESP32
+    // Clock the pulses out from the hardware timer, every 50 us.
+    if (!wiegand.beginTimer())
+    {
+        Serial.println("No free hardware timer!");
+    }
+#endif
+
+    Serial.println("Place your tag near RFID antenna");
+}
+
+void loop()
+{
+#ifdef ESP32
+    // Pulses are sent by the timer, the tag can be read the usual way.
+    if (rfid.available())
+    {
+        uint32_t id = rfid.getId();
+        wiegand.send(id, RFID_WIEGAND_26);
+
+        Serial.print("Tag sent over Wiegand! Tag ID: ");
+        Serial.println(id);
+    }
+#else
+    // Move the Wiegand lines if it's time to.
+    wiegand.update();
+
+    // Do at most 40 us of the tag read work, the rest is done by the next calls.
+    if (rfid.poll(40))
+    {
+        uint32_t id = rfid.getId();
+        wiegand.send(id, RFID_WIEGAND_26);
+
+        Serial.print("Tag sent over Wiegand! Tag ID: ");
+        Serial.println(id);
+    }
+#endif
+}
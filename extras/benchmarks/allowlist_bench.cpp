@@ -0,0 +1,93 @@
+/*
+allowlist_bench.cpp - Host benchmark of RfidAllowlist lookups per second against the list size, for the
+sorted and the Eytzinger layout, half of the lookups being hits.
+
+Build and run on Linux:
+    g++ -O2 -std=c++17 -DARDUINO -I../host/shim -I../../src allowlist_bench.cpp ../../src/RFID-ALLOWLIST.cpp \
+        -o allowlist_bench && ./allowlist_bench [image.bin]
+
+With an image made by extras/tools/allowlist_compile.py, the image is memory-mapped and checked instead.
+*/
+
+#include "RFID-ALLOWLIST.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <random>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t LOOKUPS = 4000000;
+
+    double measure(RfidAllowlist& list, const std::vector<uint32_t>& queries, uint32_t& hits)
+    {
+        hits = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t id : queries) hits += list.contains(id);
+        return queries.size() / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    int checkImage(const char* path)
+    {
+        const int fd = open(path, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st)) { std::perror(path); return 1; }
+        const void* image = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == image) { std::perror("mmap"); return 1; }
+        RfidAllowlist list;
+        if (!list.begin(image, st.st_size, false)) { std::printf("%s: not an allowlist image\n", path); return 1; }
+        std::vector<uint32_t> queries(LOOKUPS);
+        std::mt19937 rng(1);
+        for (auto& q : queries) q = rng();
+        uint32_t hits;
+        const double rate = measure(list, queries, hits);
+        std::printf("%s: %u IDs, %.0f lookups/s\n", path, list.size(), rate);
+        munmap(const_cast<void*>(image), st.st_size);
+        close(fd);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1) return checkImage(argv[1]);
+
+    std::printf("%8s %16s %16s\n", "IDs", "sorted/s", "eytzinger/s");
+    std::mt19937 rng(42);
+    for (uint32_t n : { 1000u, 10000u, 50000u, 100000u, 1000000u })
+    {
+        std::vector<uint32_t> sorted;
+        while (sorted.size() < n)
+        {
+            sorted.push_back(rng() | 1);
+            if (sorted.size() == n)
+            {
+                std::sort(sorted.begin(), sorted.end());
+                sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+            }
+        }
+        std::vector<uint32_t> eytz(n);
+        RfidAllowlist::eytzinger(sorted.data(), eytz.data(), n);
+
+        // Half hits, half misses (the list holds odd IDs only).
+        std::vector<uint32_t> queries(LOOKUPS);
+        for (uint32_t i = 0; i < LOOKUPS; ++i) queries[i] = (i & 1) ? sorted[rng() % n] : (rng() & ~1u);
+
+        RfidAllowlist sortedList, eytzList;
+        sortedList.begin(sorted.data(), n, RFID_ALLOWLIST_SORTED, false);
+        eytzList.begin(eytz.data(), n, RFID_ALLOWLIST_EYTZINGER, false);
+        uint32_t sortedHits, eytzHits;
+        const double sortedRate = measure(sortedList, queries, sortedHits);
+        const double eytzRate = measure(eytzList, queries, eytzHits);
+        if (sortedHits != LOOKUPS / 2 || eytzHits != LOOKUPS / 2)
+            std::printf("  warning: hits %u / %u, expected %u\n", sortedHits, eytzHits, LOOKUPS / 2);
+        std::printf("%8u %16.0f %16.0f\n", n, sortedRate, eytzRate);
+    }
+    return 0;
+}
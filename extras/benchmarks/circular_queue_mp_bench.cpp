@@ -0,0 +1,132 @@
+/*
+circular_queue_mp_bench.cpp - Host benchmark of the mutex guarded circular_queue_mp against the
+lock-free circular_queue_mpsc with 1 to 16 producer threads and a single consumer.
+
+Build and run on Linux:
+    g++ -O2 -std=c++17 -pthread -I../../src/libs/ESPSoftwareSerial/circular_queue \
+        circular_queue_mp_bench.cpp -o circular_queue_mp_bench && ./circular_queue_mp_bench
+*/
+
+#include "circular_queue_mp.h"
+#include "circular_queue_mpsc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Same shape as an RFID tag event: ID, timestamp and the raw EM4100 frame.
+    struct TagEvent
+    {
+        uint32_t id;
+        uint32_t timestamp;
+        uint64_t raw;
+    };
+
+    constexpr size_t QUEUE_CAPACITY = 1024;
+    constexpr size_t EVENTS_TOTAL = 1 << 21;
+    // Only every n-th push is timed, so the clock reads do not dominate the result.
+    constexpr size_t LATENCY_SAMPLE_EVERY = 16;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Result
+    {
+        double eventsPerSec;
+        uint64_t p50;
+        uint64_t p99;
+        uint64_t p999;
+        uint64_t max;
+    };
+
+    template< typename Queue >
+    Result run(Queue& queue, unsigned producers)
+    {
+        const size_t perProducer = EVENTS_TOTAL / producers;
+        std::vector<std::vector<uint64_t> > latencies(producers);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> threads;
+
+        for (unsigned p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&, p]() {
+                auto& lat = latencies[p];
+                lat.reserve(perProducer / LATENCY_SAMPLE_EVERY + 1);
+                while (!go.load()) std::this_thread::yield();
+                for (size_t i = 0; i < perProducer; ++i)
+                {
+                    // Timestamps start at 1, a zero timestamp is the queue's empty default value.
+                    TagEvent ev = { p, static_cast<uint32_t>(i + 1), (static_cast<uint64_t>(p) << 32) | i };
+                    if (i % LATENCY_SAMPLE_EVERY)
+                    {
+                        while (!queue.push(ev)) std::this_thread::yield();
+                        continue;
+                    }
+                    const auto start = Clock::now();
+                    while (!queue.push(ev)) std::this_thread::yield();
+                    lat.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+                }
+            });
+        }
+
+        const size_t expected = perProducer * producers;
+        std::vector<uint32_t> lastSeen(producers, 0);
+        size_t received = 0;
+        bool ordered = true;
+        const auto start = Clock::now();
+        go.store(true);
+        while (received < expected)
+        {
+            if (!queue.available())
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            // The lock-free queue counts reserved, not yet committed elements as available.
+            TagEvent ev = queue.pop();
+            if (!ev.timestamp) continue;
+            // Per producer FIFO order must hold for both implementations.
+            if (ev.timestamp != lastSeen[ev.id] + 1) ordered = false;
+            lastSeen[ev.id] = ev.timestamp;
+            ++received;
+        }
+        const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        for (auto& t : threads) t.join();
+        if (!ordered) std::printf("  warning: per-producer order violated\n");
+
+        std::vector<uint64_t> all;
+        for (auto& lat : latencies) all.insert(all.end(), lat.begin(), lat.end());
+        std::sort(all.begin(), all.end());
+        auto pct = [&all](double q) { return all.empty() ? 0 : all[static_cast<size_t>(q * (all.size() - 1))]; };
+        return { expected / elapsed, pct(0.50), pct(0.99), pct(0.999), all.empty() ? 0 : all.back() };
+    }
+
+    void report(const char* name, unsigned producers, const Result& r)
+    {
+        std::printf("%-20s %3u %14.0f %10llu %10llu %10llu %12llu\n", name, producers, r.eventsPerSec,
+            static_cast<unsigned long long>(r.p50), static_cast<unsigned long long>(r.p99),
+            static_cast<unsigned long long>(r.p999), static_cast<unsigned long long>(r.max));
+    }
+}
+
+int main()
+{
+    std::printf("%-20s %3s %14s %10s %10s %10s %12s\n", "queue", "P", "events/s", "p50 ns", "p99 ns", "p99.9 ns",
+        "max ns");
+    for (unsigned producers : { 1u, 2u, 4u, 8u, 16u })
+    {
+        {
+            circular_queue_mp<TagEvent> queue(QUEUE_CAPACITY);
+            report("circular_queue_mp", producers, run(queue, producers));
+        }
+        {
+            circular_queue_mpsc<TagEvent> queue(QUEUE_CAPACITY);
+            report("circular_queue_mpsc", producers, run(queue, producers));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+circular_queue_spsc_bench.cpp - Host benchmark of single-producer, single-consumer throughput of
+circular_queue against the cache-line isolated circular_queue_padded, with the producer and the
+consumer on separate threads (pinned to separate cores when the host has more than one). The consumer
+pops unconditionally and takes the default value 0 as empty (the produced values are never 0), so it
+does not call available(), which would load the producer's position on every element.
+
+Build and run on Linux:
+    g++ -O2 -std=c++17 -pthread -I../../src/libs/ESPSoftwareSerial/circular_queue \
+        circular_queue_spsc_bench.cpp -o circular_queue_spsc_bench && ./circular_queue_spsc_bench
+*/
+
+#include "circular_queue.h"
+#include "circular_queue_padded.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <pthread.h>
+#include <thread>
+
+namespace
+{
+    constexpr size_t QUEUE_CAPACITY = 256;
+    constexpr uint32_t ITEMS = 5000000;
+
+    void pinToCore(unsigned core)
+    {
+        const unsigned cores = std::thread::hardware_concurrency();
+        if (cores < 2) return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core % cores, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    template< typename Queue, typename T >
+    double run(Queue& queue)
+    {
+        std::thread producer([&queue]() {
+            pinToCore(1);
+            for (uint32_t i = 1; i <= ITEMS; ++i)
+            {
+                // 1..255 repeating for uint8_t, never the default value 0.
+                const T val = static_cast<T>(1 + (i - 1) % 255);
+                while (!queue.push(val)) std::this_thread::yield();
+            }
+        });
+
+        pinToCore(0);
+        const auto start = std::chrono::steady_clock::now();
+        uint32_t received = 0;
+        uint64_t sum = 0;
+        while (received < ITEMS)
+        {
+            const T val = queue.pop();
+            if (!val)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            sum += val;
+            ++received;
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        producer.join();
+        if (!sum) std::printf("  warning: nothing received\n");
+        return ITEMS / elapsed;
+    }
+
+    template< typename T >
+    void compare(const char* type)
+    {
+        circular_queue<T> plain(QUEUE_CAPACITY);
+        const double plainRate = run<circular_queue<T>, T>(plain);
+        circular_queue_padded<T> padded(QUEUE_CAPACITY);
+        const double paddedRate = run<circular_queue_padded<T>, T>(padded);
+        std::printf("%-10s %16.0f %16.0f %8.2fx\n", type, plainRate, paddedRate, paddedRate / plainRate);
+    }
+}
+
+int main()
+{
+    std::printf("%-10s %16s %16s %9s\n", "element", "circular_queue", "padded", "gain");
+    compare<uint8_t>("uint8_t");
+    compare<uint32_t>("uint32_t");
+    compare<uint64_t>("uint64_t");
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+delegate_bench.cpp - Host benchmark of the per-element call overhead when draining a circular_queue
+through a Delegate, through a raw function pointer, and through an inlined lambda, with a callee shaped
+like SoftwareSerial's bit decoder. The Delegate goes through the Delegate overload of
+circular_queue::for_each, the other two through the overload taking the callable by type, which is
+what SoftwareSerial::rxBits() uses. The call is a small part of the cost on an x86 host (the modulo of
+the loop and the decoder's division dominate), measure on the board with examples/readerBenchmark
+(queue_for_each and queue_for_each_delegate).
+
+Build and run on Linux:
+    g++ -O2 -std=c++17 -I../../src/libs/ESPSoftwareSerial/circular_queue \
+        delegate_bench.cpp -o delegate_bench && ./delegate_bench
+*/
+
+#include "circular_queue.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace
+{
+    constexpr size_t QUEUE_CAPACITY = 1024;
+    constexpr unsigned ROUNDS = 20000;
+
+    // Stand-in for SoftwareSerial::rxBits(uint32_t): cheap arithmetic on the edge timestamps.
+    struct Decoder
+    {
+        uint32_t lastCycle = 0;
+        uint32_t bits = 0;
+        void edge(uint32_t isrCycle)
+        {
+            bits += (isrCycle - lastCycle) / 833;
+            lastCycle = isrCycle;
+        }
+    };
+
+    Decoder* g_decoder;
+
+    void edgeFn(uint32_t&& isrCycle)
+    {
+        g_decoder->edge(isrCycle);
+    }
+
+    typedef circular_queue<uint32_t, Decoder*> Queue;
+
+    void fill(Queue& queue, uint32_t& cycle)
+    {
+        while (queue.available_for_push())
+        {
+            cycle += 833 * (1 + (cycle & 3));
+            queue.push(cycle);
+        }
+    }
+
+    template< typename Drain >
+    double measure(const char* name, Drain drain)
+    {
+        Queue queue(QUEUE_CAPACITY);
+        uint32_t cycle = 0;
+        double seconds = 0;
+        for (unsigned r = 0; r < ROUNDS; ++r)
+        {
+            fill(queue, cycle);
+            const auto start = std::chrono::steady_clock::now();
+            drain(queue);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        const double ns = seconds * 1e9 / (static_cast<double>(ROUNDS) * QUEUE_CAPACITY);
+        std::printf("%-24s %8.2f ns/element (bits %u)\n", name, ns, g_decoder->bits);
+        return ns;
+    }
+}
+
+int main()
+{
+    Decoder decoder;
+    g_decoder = &decoder;
+
+    const Delegate<void(uint32_t&&), Decoder*> del = { [](Decoder* self, uint32_t&& isrCycle) { self->edge(isrCycle); },
+        &decoder };
+    measure("Delegate", [&del](Queue& q) { q.for_each(del); });
+
+    void (* volatile fn)(uint32_t&&) = edgeFn;
+    measure("function pointer", [fn](Queue& q) { q.for_each(fn); });
+
+    measure("inlined lambda", [&decoder](Queue& q) {
+        q.for_each([&decoder](uint32_t&& isrCycle) { decoder.edge(isrCycle); });
+    });
+    return 0;
+}
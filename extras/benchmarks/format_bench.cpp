@@ -0,0 +1,108 @@
+/*
+format_bench.cpp - Host benchmark of RfidFormat: formatting 1M tag IDs in each format, compared with snprintf.
+Also checks every result against snprintf.
+
+Build and run on Linux:
+    g++ -O2 -std=c++17 -I../../src format_bench.cpp ../../src/RFID-FORMAT.cpp -o format_bench && ./format_bench
+*/
+
+#include "RFID-FORMAT.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t IDS = 1000000;
+
+    using Clock = std::chrono::steady_clock;
+
+    double nsPer(Clock::time_point start, uint32_t n)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n;
+    }
+
+    // Sum of the output, so the compiler can't drop the formatting.
+    volatile uint32_t sink;
+
+    template <typename F> double run(const std::vector<uint64_t> &values, F &&format)
+    {
+        char buf[32];
+        uint32_t sum = 0;
+
+        auto start = Clock::now();
+        for (uint64_t v : values)
+            sum += format(v, buf) + buf[0];
+        double ns = nsPer(start, values.size());
+
+        sink = sum;
+        return ns;
+    }
+}
+
+int main()
+{
+    std::mt19937_64 rng(1);
+    std::vector<uint64_t> raw(IDS);
+    std::vector<uint64_t> ids(IDS);
+    for (uint32_t i = 0; i < IDS; i++)
+    {
+        // Spread over all lengths, not only the long numbers.
+        raw[i] = rng() >> (rng() % 64);
+        ids[i] = (uint32_t)rng();
+    }
+
+    // Check the results first.
+    for (uint32_t i = 0; i < IDS; i++)
+    {
+        char a[32], b[32], c[32], d[32];
+        RfidFormat::decimal64(raw[i], a);
+        snprintf(b, sizeof(b), "%" PRIu64, raw[i]);
+        RfidFormat::hex64(raw[i], c);
+        snprintf(d, sizeof(d), "%016" PRIX64, raw[i]);
+        if (strcmp(a, b) || strcmp(c, d))
+        {
+            printf("mismatch for %" PRIu64 ": %s %s\n", raw[i], a, c);
+            return 1;
+        }
+
+        uint32_t id = (uint32_t)ids[i];
+        RfidFormat::wiegand26(id, a);
+        snprintf(b, sizeof(b), "%03u,%05u", (unsigned)((id >> 16) & 0xFF), (unsigned)(id & 0xFFFF));
+        RfidFormat::wiegand34(id, c);
+        snprintf(d, sizeof(d), "%05u,%05u", (unsigned)(id >> 16), (unsigned)(id & 0xFFFF));
+        if (strcmp(a, b) || strcmp(c, d))
+        {
+            printf("mismatch for %u: %s %s\n", (unsigned)id, a, c);
+            return 1;
+        }
+    }
+
+    printf("%-12s %12s %12s\n", "format", "RfidFormat", "snprintf");
+
+    printf("%-12s %10.1fns %10.1fns\n", "hex64",
+           run(raw, [](uint64_t v, char *buf) { return (uint32_t)RfidFormat::hex64(v, buf); }),
+           run(raw, [](uint64_t v, char *buf) { return (uint32_t)snprintf(buf, 32, "%016" PRIX64, v); }));
+
+    printf("%-12s %10.1fns %10.1fns\n", "decimal64",
+           run(raw, [](uint64_t v, char *buf) { return (uint32_t)RfidFormat::decimal64(v, buf); }),
+           run(raw, [](uint64_t v, char *buf) { return (uint32_t)snprintf(buf, 32, "%" PRIu64, v); }));
+
+    printf("%-12s %10.1fns %10.1fns\n", "wiegand26",
+           run(ids, [](uint64_t v, char *buf) { return (uint32_t)RfidFormat::wiegand26((uint32_t)v, buf); }),
+           run(ids, [](uint64_t v, char *buf) {
+               return (uint32_t)snprintf(buf, 32, "%03u,%05u", (unsigned)((v >> 16) & 0xFF), (unsigned)(v & 0xFFFF));
+           }));
+
+    printf("%-12s %10.1fns %10.1fns\n", "wiegand34",
+           run(ids, [](uint64_t v, char *buf) { return (uint32_t)RfidFormat::wiegand34((uint32_t)v, buf); }),
+           run(ids, [](uint64_t v, char *buf) {
+               return (uint32_t)snprintf(buf, 32, "%05u,%05u", (unsigned)((v >> 16) & 0xFFFF), (unsigned)(v & 0xFFFF));
+           }));
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+allowlist_test.cpp - Checks of the flash-resident allowlist (RfidAllowlist): the sorted and the Eytzinger search agree
+with each other and with the reference for the lists of every shape (full and partial last tree level), and the images
+that are damaged or cut short are rejected. Exits with 1 if any check fails.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/allowlist_test
+*/
+
+#include "RFID-ALLOWLIST.h"
+
+#include <algorithm>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// Repeatable pseudo-random tag IDs (xorshift32).
+static uint32_t nextId(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Sorted unique tag IDs, even and non-zero, spread over the whole range.
+static std::vector<uint32_t> makeIds(uint32_t count)
+{
+    std::vector<uint32_t> ids;
+    uint32_t state = 1 + count;
+    while (ids.size() < count)
+    {
+        ids.clear();
+        for (uint32_t i = 0; i < count; i++)
+            ids.push_back((nextId(state) | 2) & ~1UL);
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+    return ids;
+}
+
+// Allowlist image as made by allowlist_compile.py (passed to begin() as const void *, like a mapped file).
+static std::vector<uint32_t> makeImage(const std::vector<uint32_t> &ids, uint16_t layout)
+{
+    std::vector<uint32_t> image = {RFID_ALLOWLIST_MAGIC, RFID_ALLOWLIST_VERSION | (uint32_t)layout << 16,
+                                   (uint32_t)ids.size()};
+    image.insert(image.end(), ids.begin(), ids.end());
+    return image;
+}
+
+int main()
+{
+    // Every tree shape: one node, full levels (15, 255), one node into a new level (16, 256) and the odd sizes.
+    const uint32_t counts[] = {1, 2, 3, 7, 15, 16, 17, 100, 255, 256, 1000, 4097};
+
+    for (uint32_t count : counts)
+    {
+        std::vector<uint32_t> sorted = makeIds(count);
+
+        // Exactly sized copies, so the address sanitizer sees any read past the end of the list.
+        uint32_t *sortedIds = new uint32_t[count];
+        uint32_t *eytzIds = new uint32_t[count];
+        std::copy(sorted.begin(), sorted.end(), sortedIds);
+        RfidAllowlist::eytzinger(sortedIds, eytzIds, count);
+
+        RfidAllowlist sortedList, eytzList;
+        bool begun = sortedList.begin(sortedIds, count, RFID_ALLOWLIST_SORTED, false) &&
+                     eytzList.begin(eytzIds, count, RFID_ALLOWLIST_EYTZINGER, false);
+
+        // Each listed ID, its neighbours (odd, so never listed) and the ends of the range.
+        bool agree = begun;
+        bool found = begun;
+        for (uint32_t id : sorted)
+        {
+            for (uint32_t query : {id - 1, id, id + 1})
+            {
+                bool expected = std::binary_search(sorted.begin(), sorted.end(), query);
+                agree = agree && sortedList.contains(query) == expected && eytzList.contains(query) == expected;
+            }
+            found = found && sortedList.contains(id) && eytzList.contains(id);
+        }
+        agree = agree && !eytzList.contains(0) && !eytzList.contains(0xFFFFFFFFUL) && !sortedList.contains(0) &&
+                !sortedList.contains(0xFFFFFFFFUL);
+
+        char what[64];
+        snprintf(what, sizeof(what), "%u IDs: every listed ID found", (unsigned)count);
+        check(found, what);
+        snprintf(what, sizeof(what), "%u IDs: sorted and Eytzinger agree with the reference", (unsigned)count);
+        check(agree, what);
+
+        delete[] sortedIds;
+        delete[] eytzIds;
+    }
+
+    // Image checks.
+    std::vector<uint32_t> ids = makeIds(100);
+    std::vector<uint32_t> eytz(ids.size());
+    RfidAllowlist::eytzinger(ids.data(), eytz.data(), ids.size());
+    std::vector<uint32_t> image = makeImage(eytz, RFID_ALLOWLIST_EYTZINGER);
+    size_t size = image.size() * sizeof(uint32_t);
+
+    RfidAllowlist list;
+    const void *data = image.data();
+    check(list.begin(data, size, false) && list.size() == 100 && list.contains(ids[42]),
+          "image: valid image used");
+    check(!list.begin(data, size - 4, false), "image: count larger than the image rejected");
+    check(!list.begin(data, sizeof(RfidAllowlistHeader) - 1, false), "image: image shorter than the header");
+
+    std::vector<uint32_t> damaged = image;
+    damaged[0] ^= 1;
+    data = damaged.data();
+    check(!list.begin(data, size, false), "image: wrong magic rejected");
+    damaged = image;
+    damaged[1] = RFID_ALLOWLIST_VERSION | 7UL << 16;
+    check(!list.begin(data, size, false), "image: unknown layout rejected");
+
+    // Empty list contains nothing.
+    std::vector<uint32_t> empty = makeImage({}, RFID_ALLOWLIST_SORTED);
+    data = empty.data();
+    check(list.begin(data, empty.size() * sizeof(uint32_t), false) && !list.contains(0),
+          "image: empty list contains nothing");
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+/*
+bloom_test.cpp - Checks of the revoked tag ID prefilter (RfidBloomFilter): every added tag ID is found, the false
+positive rate stays near the one the filter was sized for, the shipped blob gives the same answers and the damaged
+blobs are rejected. Exits with 1 if any check fails.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/bloom_test
+*/
+
+#include "RFID-BLOOM.h"
+
+#define REVOKED 2000
+#define LOOKUPS 200000
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// Repeatable pseudo-random tag IDs (xorshift32).
+static uint32_t nextId(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Fraction of the LOOKUPS even tag IDs (never added, the revoked ones are odd) the filter reports.
+static float falsePositiveRate(RfidBloomFilter &filter)
+{
+    uint32_t state = 99;
+    uint32_t hits = 0;
+    for (uint32_t i = 0; i < LOOKUPS; i++)
+        hits += filter.mayContain(nextId(state) & ~1UL);
+    return (float)hits / LOOKUPS;
+}
+
+int main()
+{
+    static uint8_t blob[8192];
+    static uint8_t shipped[8192];
+    const float rates[] = {0.01f, 0.001f};
+
+    for (float rate : rates)
+    {
+        char what[64];
+        RfidBloomFilter filter;
+        uint32_t size = RfidBloomFilter::blobSizeFor(REVOKED, rate);
+        snprintf(what, sizeof(what), "%.1f%%: sized filter fits the blob (%u bytes)", rate * 100, (unsigned)size);
+        check(size <= sizeof(blob) && filter.begin(blob, sizeof(blob), REVOKED, rate), what);
+
+        snprintf(what, sizeof(what), "%.1f%%: empty filter contains nothing", rate * 100);
+        check(falsePositiveRate(filter) == 0, what);
+
+        uint32_t state = 7;
+        for (uint32_t i = 0; i < REVOKED; i++)
+            filter.add(nextId(state) | 1);
+
+        // No false negatives: every revoked tag must be sent to the full denylist check.
+        state = 7;
+        bool found = true;
+        for (uint32_t i = 0; i < REVOKED; i++)
+            found = found && filter.mayContain(nextId(state) | 1);
+        snprintf(what, sizeof(what), "%.1f%%: every added tag ID found", rate * 100);
+        check(found, what);
+
+        // 200k lookups put the measured rate well within 1.5 times the target.
+        float measured = falsePositiveRate(filter);
+        snprintf(what, sizeof(what), "%.1f%%: false positives %.3f%% within 1.5x the target", rate * 100,
+                 measured * 100);
+        check(measured <= rate * 1.5f, what);
+
+        // The blob shipped to another device answers the same.
+        memcpy(shipped, filter.blob(), filter.blobSize());
+        RfidBloomFilter received;
+        snprintf(what, sizeof(what), "%.1f%%: shipped blob loaded", rate * 100);
+        check(received.load(shipped, filter.blobSize()), what);
+        state = 7;
+        found = true;
+        for (uint32_t i = 0; i < REVOKED; i++)
+            found = found && received.mayContain(nextId(state) | 1);
+        snprintf(what, sizeof(what), "%.1f%%: shipped blob gives the same answers", rate * 100);
+        check(found && falsePositiveRate(received) == measured, what);
+    }
+
+    // Damaged blobs.
+    RfidBloomFilter filter;
+    check(!filter.begin(blob, RfidBloomFilter::blobSizeFor(REVOKED, 0.01f) - 1, REVOKED, 0.01f),
+          "begin: buffer one byte short rejected");
+    check(filter.begin(blob, sizeof(blob), REVOKED, 0.01f), "begin: filter for the damaged blob checks");
+    uint32_t size = filter.blobSize();
+    memcpy(shipped, blob, size);
+    check(!filter.load(shipped, size - 1), "load: truncated blob rejected");
+    shipped[0] ^= 0xFF;
+    check(!filter.load(shipped, size), "load: wrong magic rejected");
+
+    // clear() empties the filter.
+    filter.add(12345);
+    filter.clear();
+    check(!filter.mayContain(12345), "clear: tag ID removed");
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+/*
+dedup_test.cpp - Checks of the duplicate tag suppression cache (RfidDedupCache): the re-arm and the hold-off windows
+and the eviction of the entry seen the longest time ago when all the probed entries are taken. Exits with 1 if any
+check fails.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/dedup_test
+*/
+
+#include "RFID-DEDUP.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// First entry searched for the tag, the same multiplicative hash as RfidDedup::hash().
+static uint8_t slot(uint32_t id, uint8_t size)
+{
+    return (uint8_t)((uint32_t)(id * 2654435761UL) >> 24) & (size - 1);
+}
+
+int main()
+{
+    RfidDedupCache<8> cache;
+
+    // Re-arm window: the tag is reported again only after it was not seen for the whole window.
+    cache.setWindows(0, 1000);
+    check(cache.check(1234, 0), "re-arm: new tag reported");
+    bool dropped = true;
+    for (uint32_t now = 500; now <= 5000; now += 500)
+        dropped = dropped && !cache.check(1234, now);
+    check(dropped, "re-arm: tag staying on the antenna dropped");
+    check(!cache.check(1234, 5999), "re-arm: dropped just before the window expires");
+    check(cache.check(1234, 6999), "re-arm: reported after the window expired");
+
+    // Hold-off window: the tag staying on the antenna is reported again every 2 seconds.
+    cache.clear();
+    cache.setWindows(2000, 1000);
+    uint8_t reports = 0;
+    for (uint32_t now = 0; now < 6000; now += 500)
+        reports += cache.check(1234, now);
+    check(reports == 3, "hold-off: reported once per window");
+
+    // Five tags with the same hash, only four entries are probed.
+    uint32_t ids[5];
+    uint8_t n = 0;
+    for (uint32_t id = 1; n < 5; id++)
+        if (slot(id, 8) == 3)
+            ids[n++] = id;
+
+    cache.clear();
+    cache.setWindows(0, 1000);
+    bool added = true;
+    for (uint8_t i = 0; i < 4; i++)
+        added = added && cache.check(ids[i], 10 + 10 * i);
+    check(added, "eviction: four colliding tags reported");
+
+    // The first tag is seen again, so the second one is now the oldest and gets replaced.
+    check(!cache.check(ids[0], 50), "eviction: refreshed tag dropped");
+    check(cache.check(ids[4], 60), "eviction: fifth colliding tag reported");
+    check(!cache.check(ids[0], 70) && !cache.check(ids[2], 70) && !cache.check(ids[3], 70) &&
+              !cache.check(ids[4], 70),
+          "eviction: the other tags kept");
+    check(cache.check(ids[1], 70), "eviction: tag seen the longest time ago evicted");
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
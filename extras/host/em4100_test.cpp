@@ -0,0 +1,71 @@
+/*
+em4100_test.cpp - Checks of the EM4100 frame check (Em4100): known frames (worked out by hand from the frame layout,
+not with encode()) decode to their version and tag ID and validate, and the frames with a flipped parity, data,
+header or stop bit or with the wrong tag ID are rejected. Exits with 1 if any check fails.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/em4100_test
+*/
+
+#include "RFID-EM4100.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// Known frames: header, 10 rows of 4 data bits and the even row parity, even column parity and the stop bit.
+struct KnownFrame
+{
+    uint64_t raw;
+    uint8_t version;
+    uint32_t id;
+};
+
+static const KnownFrame frames[] = {
+    {0xFF800000CB44E1ECULL, 0x00, 0x0012A4C7},
+    {0xFF818000FAAA1B12ULL, 0x06, 0x001E5A3C},
+    {0xFFFBDEF7BDEF7BC0ULL, 0xFF, 0xFFFFFFFF},
+};
+
+int main()
+{
+    for (const KnownFrame &frame : frames)
+    {
+        char what[64];
+        uint8_t version = 0;
+        uint32_t id = 0;
+
+        snprintf(what, sizeof(what), "0x%08X: decoded", (unsigned)frame.id);
+        check(Em4100::decode(frame.raw, &version, &id) && version == frame.version && id == frame.id, what);
+        snprintf(what, sizeof(what), "0x%08X: validated against its tag ID", (unsigned)frame.id);
+        check(Em4100::validate(frame.raw, frame.id), what);
+        snprintf(what, sizeof(what), "0x%08X: encode() gives the same frame", (unsigned)frame.id);
+        check(Em4100::encode(frame.version, frame.id) == frame.raw, what);
+        snprintf(what, sizeof(what), "0x%08X: rejected for another tag ID", (unsigned)frame.id);
+        check(!Em4100::validate(frame.raw, frame.id ^ 1), what);
+
+        // Row parity of the last row (bit 5) and the first column parity bit (bit 4).
+        snprintf(what, sizeof(what), "0x%08X: flipped row parity bit rejected", (unsigned)frame.id);
+        check(!Em4100::validate(frame.raw ^ (1ULL << 5), frame.id), what);
+        snprintf(what, sizeof(what), "0x%08X: flipped column parity bit rejected", (unsigned)frame.id);
+        check(!Em4100::validate(frame.raw ^ (1ULL << 4), frame.id), what);
+
+        // Any single bit error: header, data, parity or stop bit.
+        bool rejected = true;
+        for (uint8_t bit = 0; bit < 64; bit++)
+            rejected = rejected && !Em4100::decode(frame.raw ^ (1ULL << bit), NULL, NULL);
+        snprintf(what, sizeof(what), "0x%08X: every single bit error rejected", (unsigned)frame.id);
+        check(rejected, what);
+    }
+
+    // Two data bits of the same row flipped keep the row parity, the column parity catches them.
+    check(!Em4100::decode(frames[0].raw ^ (3ULL << 6), NULL, NULL), "two bit error in one row rejected");
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
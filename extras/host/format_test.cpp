@@ -0,0 +1,124 @@
+/*
+format_test.cpp - Checks of the tag ID formatter (RfidFormat): HEX, decimal and Wiegand output and its length compared
+with snprintf at the edge values (zero, the digit pair and the 8 digit chunk boundaries, the largest numbers) and a
+pseudo-random sweep, and the Print versions writing the same text. Exits with 1 if any check fails.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/format_test
+*/
+
+#include "RFID-FORMAT.h"
+
+#include <inttypes.h>
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// Print that keeps what is written.
+class TextPrint : public Print
+{
+  public:
+    size_t write(uint8_t _c) override
+    {
+        if (length < sizeof(text) - 1)
+            text[length++] = _c;
+        text[length] = '\0';
+        return 1;
+    }
+
+    void clear()
+    {
+        length = 0;
+        text[0] = '\0';
+    }
+
+    char text[32] = {0};
+    size_t length = 0;
+};
+
+// Repeatable pseudo-random numbers (xorshift64).
+static uint64_t nextValue(uint64_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Formats the value in every format and compares it with snprintf, true if all match.
+static bool matches(uint64_t value)
+{
+    char buf[RFID_FORMAT_DECIMAL64_SIZE];
+    char expected[32];
+    uint32_t id = (uint32_t)value;
+    bool ok = true;
+
+    int n = snprintf(expected, sizeof(expected), "%016" PRIX64, value);
+    ok = ok && RfidFormat::hex64(value, buf) == n && !strcmp(buf, expected);
+
+    n = snprintf(expected, sizeof(expected), "%010" PRIX64, (uint64_t)(value & 0xFFFFFFFFFFULL));
+    ok = ok && RfidFormat::hex64(value, buf, 10) == n && !strcmp(buf, expected);
+
+    n = snprintf(expected, sizeof(expected), "%" PRIu64, value);
+    ok = ok && RfidFormat::decimal64(value, buf) == n && !strcmp(buf, expected);
+
+    n = snprintf(expected, sizeof(expected), "%03u,%05u", (unsigned)(id >> 16 & 0xFF), (unsigned)(id & 0xFFFF));
+    ok = ok && RfidFormat::wiegand26(id, buf) == n && !strcmp(buf, expected);
+
+    n = snprintf(expected, sizeof(expected), "%05u,%05u", (unsigned)(id >> 16), (unsigned)(id & 0xFFFF));
+    ok = ok && RfidFormat::wiegand34(id, buf) == n && !strcmp(buf, expected);
+
+    return ok;
+}
+
+int main()
+{
+    // Zero, the digit pair and the 8 digit chunk boundaries and the largest numbers.
+    const uint64_t edges[] = {0, 1, 9, 10, 99, 100, 9999999, 10000000, 99999999, 100000000, 4294967295ULL,
+                              4294967296ULL, 9999999999999999ULL, 10000000000000000ULL, 0x0000FFFF0000FFFFULL,
+                              0xFFFFFFFFFFFFFFFFULL};
+    bool ok = true;
+    for (uint64_t value : edges)
+        ok = ok && matches(value);
+    check(ok, "edge values match snprintf");
+
+    uint64_t state = 88172645463325252ULL;
+    ok = true;
+    for (uint32_t i = 0; i < 100000; i++)
+    {
+        // Spread over all magnitudes, not only the 20 digit numbers.
+        uint64_t value = nextValue(state);
+        ok = ok && matches(value >> (value & 63));
+    }
+    check(ok, "100k pseudo-random values match snprintf");
+
+    // Known output of a tag.
+    char buf[RFID_FORMAT_DECIMAL64_SIZE];
+    RfidFormat::wiegand26(0x0012A4C7, buf);
+    check(!strcmp(buf, "018,42183"), "Wiegand 26 of tag 0x0012A4C7");
+    RfidFormat::hex64(0xFF8A1F0C80000F3CULL, buf);
+    check(!strcmp(buf, "FF8A1F0C80000F3C"), "HEX of the RAW data");
+    check(RfidFormat::hex64(0xABCDEF, buf, 20) == 16 && !strcmp(buf, "0000000000ABCDEF"),
+          "HEX digits capped at 16");
+
+    // Print versions write the same text and return its length.
+    TextPrint out;
+    ok = RfidFormat::printHex64(out, 0x1234ULL, 6) == 6 && !strcmp(out.text, "001234");
+    out.clear();
+    ok = ok && RfidFormat::printDecimal64(out, 18446744073709551615ULL) == 20 &&
+         !strcmp(out.text, "18446744073709551615");
+    out.clear();
+    ok = ok && RfidFormat::printWiegand26(out, 0x0012A4C7) == 9 && !strcmp(out.text, "018,42183");
+    out.clear();
+    ok = ok && RfidFormat::printWiegand34(out, 0x0012A4C7) == 11 && !strcmp(out.text, "00018,42183");
+    check(ok, "Print versions write the same text");
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
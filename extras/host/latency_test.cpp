@@ -0,0 +1,104 @@
+/*
+latency_test.cpp - Checks of the tag read latency histograms (RfidLatencyStats): the log2 bucket of each sample, the
+percentiles, and the stages recorded by an easyC reader attached with Rfid::setLatencyStats(), starting at the INT edge
+marked by markEdge(). Exits with 1 if any check fails.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/latency_test
+*/
+
+#include "RFID-SOLDERED.h"
+#include "RFID-LATENCY.h"
+#include "RfidBreakout.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// Records one sample of the frame stage.
+static void sample(RfidLatencyStats &stats, uint32_t us)
+{
+    stats.begin(1000);
+    stats.stamp(RFID_LATENCY_FRAME, 1000 + us);
+    stats.end();
+}
+
+// Checks that the sample of us microseconds lands in the bucket and nowhere else.
+static void checkBucket(uint32_t us, uint8_t bucket)
+{
+    RfidLatencyStats stats;
+    sample(stats, us);
+
+    bool only = stats.bucket(RFID_LATENCY_FRAME, bucket) == 1;
+    for (uint8_t b = 0; b < RFID_LATENCY_BUCKETS; b++)
+        only = only && (b == bucket || !stats.bucket(RFID_LATENCY_FRAME, b));
+
+    char what[64];
+    snprintf(what, sizeof(what), "bucket: %lu us in bucket %u", (unsigned long)us, bucket);
+    check(only, what);
+}
+
+int main()
+{
+    // Bucket b holds [2^(b - 1), 2^b) microseconds, the last one everything longer.
+    checkBucket(0, 0);
+    checkBucket(1, 1);
+    checkBucket(2, 2);
+    checkBucket(3, 2);
+    checkBucket(4, 3);
+    checkBucket(1023, 10);
+    checkBucket(1024, 11);
+    checkBucket(1UL << 22, 23);
+    checkBucket(0xFFFFFFFFUL, 23);
+
+    // 90 samples of 100 us (bucket [64, 128)) and 10 of 5000 us (bucket [4096, 8192)).
+    RfidLatencyStats stats;
+    for (uint8_t i = 0; i < 100; i++)
+        sample(stats, i < 90 ? 100 : 5000);
+    RfidLatencySummary summary;
+    check(stats.summary(RFID_LATENCY_FRAME, &summary) && summary.count == 100 && summary.max == 5000,
+          "summary: count and max");
+    check(summary.p50 >= 64 && summary.p50 < 128, "summary: p50 in the bucket of 100 us");
+    check(summary.p95 >= 4096 && summary.p95 <= 5000, "summary: p95 in the bucket of 5000 us, up to max");
+    check(!stats.summary(RFID_LATENCY_DECODE, &summary) && !summary.count, "summary: stage without samples");
+    check(!stats.bucket(RFID_LATENCY_STAGES, 0) && !stats.bucket(0, RFID_LATENCY_BUCKETS), "bucket: out of range");
+
+    // easyC reader with the frame validation, so all the stages are recorded.
+    RfidHost::reset();
+    RfidBreakout breakout;
+    breakout.beginEasyC();
+    Rfid rfid;
+    rfid.begin();
+    rfid.setFrameValidation(true);
+    RfidLatencyStats readerStats;
+    rfid.setLatencyStats(&readerStats);
+
+    breakout.addTag(100, 0x0012A4C7, 0x3C);
+    RfidHost::advanceMicros(200);
+    readerStats.markEdge();
+    RfidHost::advanceMicros(300);
+    check(rfid.available() && rfid.getId() == 0x0012A4C7, "reader: tag read");
+
+    RfidLatencySummary stages[RFID_LATENCY_STAGES];
+    bool counted = true;
+    for (uint8_t s = 0; s < RFID_LATENCY_STAGES; s++)
+        counted = readerStats.summary(s, &stages[s]) && stages[s].count == 1 && counted;
+    check(counted, "reader: one sample of each stage");
+    check(stages[RFID_LATENCY_FIRST_BYTE].max >= 300, "reader: measured from the INT edge");
+    check(stages[RFID_LATENCY_FIRST_BYTE].max <= stages[RFID_LATENCY_FRAME].max &&
+              stages[RFID_LATENCY_FRAME].max <= stages[RFID_LATENCY_DECODE].max &&
+              stages[RFID_LATENCY_DECODE].max <= stages[RFID_LATENCY_DELIVERED].max,
+          "reader: stages in order");
+
+    RfidHost::advanceMicros(2000000);
+    check(!rfid.available() && readerStats.summary(RFID_LATENCY_FRAME, &summary) && summary.count == 1,
+          "reader: no sample without a tag");
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
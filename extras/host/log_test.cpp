@@ -0,0 +1,145 @@
+/*
+log_test.cpp - Checks of the persistent tag event log (RfidEventLog) on a flash partition of the virtual ESP32: the
+events written past the end of a segment survive re-opening the log in order, the oldest segment is erased when the
+log is full and performWork() never erases and writes records in the same call. Exits with 1 if any check fails.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/log_test
+*/
+
+#include "Arduino.h"
+#include "RFID-LOG.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// Partition storage that counts the storage operations.
+class CountingStorage : public RfidLogStorage
+{
+  public:
+    RfidLogPartition partition;
+    uint32_t writes = 0;
+    uint32_t erases = 0;
+
+    uint32_t size()
+    {
+        return partition.size();
+    }
+    uint32_t sectorSize()
+    {
+        return partition.sectorSize();
+    }
+    bool read(uint32_t _address, void *_data, uint32_t _length)
+    {
+        return partition.read(_address, _data, _length);
+    }
+    bool write(uint32_t _address, const void *_data, uint32_t _length)
+    {
+        writes++;
+        return partition.write(_address, _data, _length);
+    }
+    bool erase(uint32_t _address)
+    {
+        erases++;
+        return partition.erase(_address);
+    }
+};
+
+// Appends the events with the IDs from..to, with performWork() after each one. Returns false if a call of
+// performWork() erased a segment and wrote the records too.
+static bool appendEvents(RfidEventLogBase &log, CountingStorage &storage, uint32_t from, uint32_t to)
+{
+    bool steps = true;
+    for (uint32_t id = from; id <= to; id++)
+    {
+        TagEvent event = {id, id * 10, (uint64_t)id << 20, 1, 0};
+        log.append(event);
+
+        uint32_t writes = storage.writes;
+        uint32_t erases = storage.erases;
+        log.performWork();
+        // Opening a segment is its erase and the write of its header, nothing more.
+        if (storage.erases != erases && storage.writes - writes > 1)
+            steps = false;
+    }
+
+    return steps;
+}
+
+// Reads the whole log, checks that the IDs go up by one and the other fields match. Returns the number of events.
+static uint32_t readEvents(RfidEventLogBase &log, uint32_t *firstId, uint32_t *lastId, bool *ordered)
+{
+    RfidLogCursor cursor;
+    TagEvent event;
+    uint32_t n = 0;
+
+    *ordered = log.first(&cursor);
+    while (log.next(&cursor, &event))
+    {
+        if (!n)
+            *firstId = event.id;
+        else if (event.id != *lastId + 1)
+            *ordered = false;
+        if (event.timestamp != event.id * 10 || event.raw != (uint64_t)event.id << 20 || event.reader != 1)
+            *ordered = false;
+        *lastId = event.id;
+        n++;
+    }
+
+    return n;
+}
+
+int main()
+{
+    // Three 4 KB sectors of 20 byte records, the header and 203 events in each segment.
+    RfidHost::addPartition("rfidlog", 3 * SPI_FLASH_SEC_SIZE);
+    const uint32_t perSegment = SPI_FLASH_SEC_SIZE / sizeof(RfidLogRecord) - 1;
+
+    CountingStorage storage;
+    check(storage.partition.begin("rfidlog"), "partition found");
+
+    uint32_t firstId = 0;
+    uint32_t lastId = 0;
+    bool ordered = false;
+
+    {
+        RfidEventLog<16> log;
+        check(log.begin(&storage) && storage.erases == 1, "empty partition formatted");
+
+        bool steps = appendEvents(log, storage, 1, 300);
+        check(steps, "segment erase in its own performWork() call");
+        check(log.pending() == 300 % 16 && storage.erases == 2, "full batches written past the first segment");
+        check(log.flush() && !log.pending(), "flush() writes the partly filled batch");
+    }
+
+    {
+        RfidEventLog<16> log;
+        uint32_t erases = storage.erases;
+        check(log.begin(&storage) && storage.erases == erases, "log re-opened without erasing");
+        uint32_t n = readEvents(log, &firstId, &lastId, &ordered);
+        check(n == 300 && firstId == 1 && lastId == 300 && ordered, "re-opened: 300 events in order");
+
+        // Appending continues after the last record, past the end of the log, erasing the oldest segment.
+        bool steps = appendEvents(log, storage, 301, 700);
+        check(steps && log.flush(), "appended after re-opening");
+        check(storage.erases == erases + 2, "oldest segment erased when the log is full");
+    }
+
+    {
+        RfidEventLog<16> log;
+        check(log.begin(&storage), "log re-opened after the wrap");
+        uint32_t n = readEvents(log, &firstId, &lastId, &ordered);
+        check(ordered && lastId == 700 && n == 700 - firstId + 1, "wrapped: newest events in order");
+        check(n > 2 * perSegment && n <= 3 * perSegment && firstId == perSegment + 1,
+              "wrapped: whole oldest segment dropped");
+    }
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+/*
+presence_test.cpp - Checks of the presence tracker (RfidPresence) on the virtual clock: arrival after the needed number
+of reads, no arrival for a single stray read, departure after departMs without reads and the eviction when the table
+is full. Exits with 1 if any check fails.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/presence_test
+*/
+
+#include "Arduino.h"
+#include "RFID-PRESENCE.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// Lets the time pass in 10 ms steps, calling update() as loop() would, reading the tag every readMs (0 for no reads).
+// Returns the number of events that came meanwhile, the last one in *last.
+static uint8_t run(RfidPresenceTracker &tracker, uint32_t ms, uint32_t id, uint32_t readMs, RfidPresenceEvent *last)
+{
+    uint8_t events = 0;
+    for (uint32_t t = 10; t <= ms; t += 10)
+    {
+        RfidHost::advanceMicros(10000);
+        if (readMs && !(t % readMs))
+            tracker.seen(id, 0, millis());
+        tracker.update(millis());
+        while (tracker.getEvent(last))
+            events++;
+    }
+
+    return events;
+}
+
+int main()
+{
+    RfidHost::reset();
+    RfidPresence<2> tracker;
+    tracker.setThresholds(3, 1000);
+    RfidPresenceEvent event = {0, 0, 0, 0, 0};
+
+    // Single stray read: the tag never arrives and leaves silently.
+    tracker.seen(100, 0, millis());
+    check(!run(tracker, 2000, 0, 0, &event) && !tracker.isPresent(100, 0) && !tracker.presentCount(),
+          "single read: no arrive, no depart");
+
+    // Read every 200 ms: arrives on the third read.
+    uint32_t start = millis();
+    check(run(tracker, 400, 200, 200, &event) == 0, "two reads: not arrived yet");
+    check(run(tracker, 200, 200, 200, &event) == 1 && event.type == RFID_PRESENCE_ARRIVED && event.id == 200 &&
+              tracker.isPresent(200, 0),
+          "third read: arrived");
+    check(event.time - start >= 590 && event.time - start <= 610, "arrive: time of the third read");
+
+    // Stays for 3 more seconds, then no more reads: departs departMs after the last read.
+    check(run(tracker, 3000, 200, 200, &event) == 0, "staying on the antenna: no events");
+    uint32_t lastRead = millis();
+    check(run(tracker, 990, 0, 0, &event) == 0 && tracker.isPresent(200, 0), "no depart before departMs");
+    check(run(tracker, 20, 0, 0, &event) == 1 && event.type == RFID_PRESENCE_DEPARTED && !tracker.isPresent(200, 0),
+          "departed after departMs without reads");
+    check(event.time - lastRead >= 1000 && event.time - lastRead <= 1020, "depart: time");
+    check(event.dwell >= 3390 && event.dwell <= 3410, "depart: dwell from the first to the last read");
+
+    // Table of two: the pending tag seen the longest time ago is evicted, present tags never are.
+    tracker.clear();
+    tracker.setThresholds(2, 1000);
+    tracker.seen(1, 0, millis());
+    RfidHost::advanceMicros(10000);
+    tracker.seen(2, 0, millis());
+    RfidHost::advanceMicros(10000);
+    check(tracker.seen(3, 0, millis()), "full table: oldest pending tag evicted for the new one");
+    RfidHost::advanceMicros(10000);
+    check(tracker.seen(2, 0, millis()) && tracker.isPresent(2, 0), "full table: newer pending tag kept, arrives");
+    check(tracker.seen(3, 0, millis()) && tracker.isPresent(3, 0), "full table: new tag arrives");
+    check(!tracker.seen(1, 0, millis()) && tracker.presentCount() == 2, "full table of present tags: read not tracked");
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+/*
+queue_test.cpp - Checks of the circular queue variants used by the reader: circular_queue_waitable with a producer
+task on the virtual ESP32 (FreeRTOS task notification path) and circular_queue_lossy under a producer and a consumer
+on real threads. Exits with 1 if any check fails.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/queue_test
+*/
+
+#include "Arduino.h"
+#include "circular_queue_lossy.h"
+#include "circular_queue_waitable.h"
+
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// Producer task of the waitable queue: pushes 1..count, a few at a time with a sleep in between.
+struct WaitableProducer
+{
+    circular_queue_waitable<uint32_t> *queue;
+    uint32_t count;
+    uint32_t rejected;
+};
+
+static void waitableProducer(void *ctx)
+{
+    WaitableProducer *producer = (WaitableProducer *)ctx;
+    for (uint32_t i = 1; i <= producer->count; i++)
+    {
+        if (!producer->queue->push(i))
+            producer->rejected++;
+        if (!(i % 3))
+            vTaskDelay(2);
+    }
+    vTaskDelete(NULL);
+}
+
+static void testWaitable()
+{
+    RfidHost::reset();
+    circular_queue_waitable<uint32_t> queue(8);
+    uint32_t value = 0;
+
+    uint64_t start = RfidHost::cycles();
+    check(!queue.pop_wait(value, 10), "waitable: pop_wait() times out on an empty queue");
+    uint64_t waited = (RfidHost::cycles() - start) / RfidHost::CPU_MHZ;
+    check(waited >= 9000 && waited <= 11000, "waitable: timeout waits on the virtual clock");
+
+    check(queue.push(7) && queue.pop_wait(value, 0) && value == 7, "waitable: pop_wait() returns a queued value");
+    check(queue.push_from_isr(8) && queue.pop_wait(value, 0) && value == 8, "waitable: push_from_isr()");
+
+    WaitableProducer producer = {&queue, 300, 0};
+    check(xTaskCreate(waitableProducer, "producer", 2048, &producer, 2, NULL) == pdPASS, "waitable: producer task");
+
+    std::vector<uint32_t> received;
+    uint32_t buffer[4];
+    while (received.size() < producer.count)
+    {
+        // Alternate the single and the block pop, sleeping until the producer task pushes.
+        if (received.size() % 2)
+        {
+            size_t n = queue.pop_n_wait(buffer, 4, 1000);
+            if (!n)
+                break;
+            received.insert(received.end(), buffer, buffer + n);
+        }
+        else
+        {
+            if (!queue.pop_wait(value, 1000))
+                break;
+            received.push_back(value);
+        }
+    }
+
+    bool ordered = received.size() == producer.count;
+    for (size_t i = 0; ordered && i < received.size(); i++)
+        ordered = received[i] == i + 1;
+    check(ordered && !producer.rejected, "waitable: all values from the task, in order");
+    check(!queue.pop_wait(value, 5) && !queue.available(), "waitable: empty after the producer ended");
+}
+
+// Element of the lossy queue stress test, a torn copy has the check not matching the number.
+struct LossyItem
+{
+    uint32_t number;
+    uint32_t check;
+};
+
+static void testLossy()
+{
+    circular_queue_lossy<LossyItem> queue(8);
+    LossyItem item = {0, 0};
+
+    check(queue.capacity() == 8 && !queue.pop(item), "lossy: empty queue");
+    for (uint32_t i = 1; i <= 11; i++)
+        queue.push(LossyItem{i, ~i});
+    bool newest = queue.available() == 8 && queue.dropped() == 3;
+    for (uint32_t i = 4; newest && i <= 11; i++)
+        newest = queue.pop(item) && item.number == i;
+    check(newest && !queue.pop(item), "lossy: full queue keeps the newest elements");
+
+    // Producer and consumer on their own threads, the consumer falls behind now and then.
+    const uint32_t count = 2000000;
+    uint32_t before = queue.dropped();
+    std::atomic<bool> finished(false);
+    std::thread producer([&queue, &finished, count]() {
+        for (uint32_t i = 1; i <= count; i++)
+            queue.push(LossyItem{i, ~i});
+        finished = true;
+    });
+
+    uint32_t popped = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+    bool whole = true;
+    bool ended;
+    do
+    {
+        ended = finished;
+        while (queue.pop(item))
+        {
+            ordered = ordered && item.number > last;
+            whole = whole && item.check == ~item.number;
+            last = item.number;
+            if (!(++popped % 1000))
+                std::this_thread::yield();
+        }
+    } while (!ended);
+    producer.join();
+
+    check(ordered, "lossy: threads, elements in order");
+    check(whole, "lossy: threads, no torn elements");
+    check(popped + queue.dropped() - before == count, "lossy: threads, popped and dropped add up");
+    check(popped > 0 && queue.dropped() - before > 0, "lossy: threads, both popped and dropped");
+}
+
+int main()
+{
+    testWaitable();
+    testLossy();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,475 @@
+/*
+rfid_bench.cpp - Benchmark suite of the reader stack on the virtual ESP32, with the results in CSV or JSON so they can
+be kept and compared between releases and tuning options. The same CSV rows are printed on the board by the
+readerBenchmark example (the cases that don't need the virtual devices).
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host
+    ./build-host/rfid_bench [format=text|csv|json] [only=<case>] [scale=1]
+
+Cases (host time is measured with steady_clock, virtual time on the virtual clock):
+    parse           Rfid::available() over a Stream, per frame (getTheSerialData, strtoul, getUint64, validation).
+                    Each time read costs 1 ms of virtual time here, so the 20 ms wait for more bytes after the frame
+                    is a few loop passes and the result is the read and decode cost.
+    print_hex64     RfidFormat::printHex64() to a Print (what Rfid::printHex64() runs) and hex64() to a buffer.
+    queue_*         circular_queue push, pop, pop_n (32 at a time) and for_each, per element, for several element
+                    types.
+    rxbits          Edges per second decoded by SoftwareSerial::rxBits() (host time in available() / read()), with
+                    the UART frames coming from RfidUartWave.
+    tx              SoftwareSerial::write() bytes per second of virtual time (the line rate is baud / 10) and the host
+                    time per byte (the bit timing busy waits).
+    easyc_*         I2C transactions per delivered tag and per idle poll of Rfid::available(), from the virtual
+                    breakout, and the virtual bus time per tag.
+
+scale multiplies the iteration counts (use less than 1 for a quick run).
+*/
+
+#include "ESPSoftwareSerial.h"
+#include "RFID-EM4100.h"
+#include "RFID-EVENT.h"
+#include "RFID-FORMAT.h"
+#include "RFID-SOLDERED.h"
+#include "RfidBreakout.h"
+#include "RfidUartWave.h"
+#include "circular_queue.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct Result
+{
+    std::string name;
+    std::string variant;
+    double value;
+    std::string unit;
+    uint64_t n;
+};
+
+static std::vector<Result> results;
+static std::string only;
+static double scale = 1;
+
+// Sum of the outputs, so the compiler can't drop the work.
+static volatile uint32_t sink;
+
+static double nsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static uint64_t count(uint64_t n)
+{
+    uint64_t scaled = (uint64_t)(n * scale);
+    return scaled ? scaled : 1;
+}
+
+static bool selected(const char *name)
+{
+    return only.empty() || std::string(name).compare(0, only.size(), only) == 0;
+}
+
+static void report(const char *name, const std::string &variant, double value, const char *unit, uint64_t n)
+{
+    results.push_back(Result{name, variant, value, unit, n});
+}
+
+// Stream holding one frame at a time.
+class FrameStream : public Stream
+{
+  public:
+    const char *frame = "";
+    size_t length = 0;
+    size_t index = 0;
+
+    void load(const std::string &text)
+    {
+        frame = text.c_str();
+        length = text.size();
+        index = 0;
+    }
+    int available()
+    {
+        return (int)(length - index);
+    }
+    int read()
+    {
+        return index < length ? (uint8_t)frame[index++] : -1;
+    }
+    int peek()
+    {
+        return index < length ? (uint8_t)frame[index] : -1;
+    }
+    size_t write(uint8_t c)
+    {
+        (void)c;
+        return 1;
+    }
+    using Print::write;
+};
+
+// Print that only counts the bytes.
+class NullPrint : public Print
+{
+  public:
+    uint32_t bytes = 0;
+
+    size_t write(uint8_t c)
+    {
+        bytes += c;
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+        bytes += buffer[0] + size;
+        return size;
+    }
+    using Print::write;
+};
+
+static void benchParse()
+{
+    // Frames of random tags, as the breakout sends them.
+    std::mt19937 random(1);
+    std::vector<std::string> frames;
+    for (int i = 0; i < 256; i++)
+    {
+        uint32_t id = random();
+        char hex[RFID_FORMAT_HEX64_SIZE];
+        RfidFormat::hex64(Em4100::encode(random() & 0xFF, id), hex);
+        frames.push_back("$" + std::to_string(id) + "&" + hex + "\r\n");
+    }
+
+    for (bool validation : {true, false})
+    {
+        RfidHost::reset();
+        RfidHost::setReadCost(RfidHost::CPU_MHZ * 1000);
+
+        FrameStream stream;
+        Rfid rfid(stream);
+        rfid.begin();
+        rfid.setFrameValidation(validation);
+
+        uint64_t n = count(20000);
+        uint32_t delivered = 0;
+        double ns = 0;
+        for (uint64_t i = 0; i < n; i++)
+        {
+            stream.load(frames[i % frames.size()]);
+            auto start = Clock::now();
+            bool ok = rfid.available();
+            ns += nsSince(start);
+            if (ok)
+                delivered += rfid.getId() != 0;
+        }
+        if (delivered != n)
+            fprintf(stderr, "parse: only %u / %llu frames delivered\n", delivered, (unsigned long long)n);
+
+        report("parse", validation ? "validation=on" : "validation=off", ns / n, "ns/frame", n);
+    }
+}
+
+static void benchHex()
+{
+    std::mt19937_64 random(1);
+    std::vector<uint64_t> values(4096);
+    for (uint64_t &value : values)
+        value = random();
+
+    uint64_t n = count(2000000);
+    NullPrint print;
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < n; i++)
+        RfidFormat::printHex64(print, values[i & 4095]);
+    report("print_hex64", "print", nsSince(start) / n, "ns/call", n);
+    sink = print.bytes;
+
+    char buffer[RFID_FORMAT_HEX64_SIZE];
+    uint32_t sum = 0;
+    start = Clock::now();
+    for (uint64_t i = 0; i < n; i++)
+        sum += RfidFormat::hex64(values[i & 4095], buffer) + buffer[15];
+    report("print_hex64", "buffer", nsSince(start) / n, "ns/call", n);
+    sink = sum;
+}
+
+template <typename T> static T element(uint32_t i)
+{
+    return (T)i;
+}
+
+template <> TagEvent element<TagEvent>(uint32_t i)
+{
+    TagEvent event = TagEvent();
+    event.id = i;
+    event.timestamp = i;
+    return event;
+}
+
+static uint32_t key(uint32_t value)
+{
+    return value;
+}
+
+static uint32_t key(const TagEvent &event)
+{
+    return event.id;
+}
+
+template <typename T> static void benchQueue(const char *type)
+{
+    const size_t capacity = 1024;
+    const size_t chunk = 32;
+    circular_queue<T> queue(capacity);
+    T buffer[chunk];
+
+    uint64_t rounds = count(10000);
+    uint64_t n = rounds * capacity;
+    double pushNs = 0, popNs = 0, popNNs = 0, forEachNs = 0;
+    uint32_t sum = 0;
+
+    for (uint64_t r = 0; r < rounds; r++)
+    {
+        auto start = Clock::now();
+        for (size_t i = 0; i < capacity; i++)
+            queue.push(element<T>(i));
+        pushNs += nsSince(start);
+
+        start = Clock::now();
+        for (size_t i = 0; i < capacity; i++)
+            sum += key(queue.pop());
+        popNs += nsSince(start);
+
+        for (size_t i = 0; i < capacity; i++)
+            queue.push(element<T>(i));
+        start = Clock::now();
+        while (size_t popped = queue.pop_n(buffer, chunk))
+            sum += key(buffer[popped - 1]);
+        popNNs += nsSince(start);
+
+        for (size_t i = 0; i < capacity; i++)
+            queue.push(element<T>(i));
+        start = Clock::now();
+        queue.for_each([&sum](T &&value) { sum += key(value); });
+        forEachNs += nsSince(start);
+    }
+    sink = sum;
+
+    std::string variant = std::string("type=") + type;
+    report("queue_push", variant, pushNs / n, "ns/element", n);
+    report("queue_pop", variant, popNs / n, "ns/element", n);
+    report("queue_pop_n", variant, popNNs / n, "ns/element", n);
+    report("queue_for_each", variant, forEachNs / n, "ns/element", n);
+}
+
+static void benchRxBits()
+{
+    const uint8_t pin = 4;
+    const size_t chunk = 32;
+
+    for (uint32_t baud : {9600, 38400, 74880, 115200})
+    {
+        RfidHost::reset();
+        RfidUartWave wave(pin);
+        wave.setFormat(baud);
+        wave.begin();
+
+        SoftwareSerial serial(pin, -1);
+        serial.begin(baud);
+        RfidHost::advanceMicros(100);
+
+        std::mt19937 random(1);
+        uint64_t bytes = count(20000);
+        uint64_t received = 0;
+        const uint64_t frameCycles = (uint64_t)RfidHost::CPU_MHZ * 1000000 / baud * 10;
+        double ns = 0;
+
+        for (uint64_t sent = 0; sent < bytes; sent += chunk)
+        {
+            uint8_t data[chunk];
+            for (size_t i = 0; i < chunk; i++)
+                data[i] = random();
+
+            RfidHost::runUntil(wave.send(data, chunk) + 3 * frameCycles);
+
+            auto start = Clock::now();
+            while (serial.available())
+            {
+                serial.read();
+                received++;
+            }
+            ns += nsSince(start);
+        }
+        bytes = (bytes + chunk - 1) / chunk * chunk;
+        if (received != bytes)
+            fprintf(stderr, "rxbits: %llu / %llu bytes received at %u baud\n", (unsigned long long)received,
+                    (unsigned long long)bytes, baud);
+
+        report("rxbits", "baud=" + std::to_string(baud), wave.edges() / (ns / 1e9), "edges/s", wave.edges());
+    }
+}
+
+static void benchTx()
+{
+    for (uint32_t baud : {9600, 38400, 115200, 230400})
+    {
+        RfidHost::reset();
+        SoftwareSerial serial(-1, 5);
+        serial.begin(baud);
+
+        uint8_t data[64];
+        for (size_t i = 0; i < sizeof(data); i++)
+            data[i] = i * 37;
+
+        // Bit timing busy waits, so the slow baud rates get fewer bytes.
+        uint64_t writes = count(baud / 2400);
+        uint64_t startCycle = RfidHost::cycles();
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < writes; i++)
+            serial.write(data, sizeof(data));
+        double ns = nsSince(start);
+        double seconds = (double)(RfidHost::cycles() - startCycle) / RfidHost::CPU_MHZ / 1e6;
+
+        uint64_t bytes = writes * sizeof(data);
+        std::string variant = "baud=" + std::to_string(baud);
+        report("tx", variant, bytes / seconds, "bytes/s", bytes);
+        report("tx_host", variant, ns / bytes, "ns/byte", bytes);
+    }
+}
+
+static void benchEasyC()
+{
+    for (bool validation : {true, false})
+    {
+        RfidHost::reset();
+        RfidBreakout breakout;
+        breakout.beginEasyC();
+
+        Rfid rfid;
+        rfid.begin(breakout.getAddress());
+        rfid.setFrameValidation(validation);
+
+        uint64_t tags = count(200);
+        for (uint64_t i = 0; i < tags; i++)
+            breakout.addTag(1000 + i * 20000, 1000 + i);
+
+        uint64_t tagTransactions = 0, idleTransactions = 0, idlePolls = 0, delivered = 0, tagCycles = 0;
+        while (!breakout.idle() || delivered < tags)
+        {
+            uint32_t before = Wire.transactions();
+            uint64_t startCycle = RfidHost::cycles();
+            if (rfid.available())
+            {
+                rfid.getId();
+                rfid.getRaw();
+                tagTransactions += Wire.transactions() - before;
+                tagCycles += RfidHost::cycles() - startCycle;
+                delivered++;
+            }
+            else
+            {
+                idleTransactions += Wire.transactions() - before;
+                idlePolls++;
+            }
+            RfidHost::advanceMicros(1000);
+
+            if (breakout.idle() && RfidHost::cycles() > (1000 + tags * 20000 + 100000ULL) * RfidHost::CPU_MHZ)
+                break;
+        }
+        if (delivered != tags)
+            fprintf(stderr, "easyc: %llu / %llu tags delivered\n", (unsigned long long)delivered,
+                    (unsigned long long)tags);
+
+        std::string variant = validation ? "validation=on" : "validation=off";
+        report("easyc_tag", variant, delivered ? (double)tagTransactions / delivered : 0, "transactions/tag",
+               delivered);
+        report("easyc_tag_bus", variant, delivered ? (double)tagCycles / RfidHost::CPU_MHZ / delivered : 0,
+               "us/tag", delivered);
+        report("easyc_idle_poll", variant, idlePolls ? (double)idleTransactions / idlePolls : 0,
+               "transactions/poll", idlePolls);
+    }
+}
+
+static void print(const std::string &format)
+{
+    if (format == "csv")
+    {
+        printf("case,variant,value,unit,n\n");
+        for (const Result &r : results)
+            printf("%s,%s,%.6g,%s,%llu\n", r.name.c_str(), r.variant.c_str(), r.value, r.unit.c_str(),
+                   (unsigned long long)r.n);
+    }
+    else if (format == "json")
+    {
+        printf("{\n  \"benchmark\": \"rfid_bench\",\n  \"scale\": %g,\n  \"results\": [\n", scale);
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result &r = results[i];
+            printf("    {\"case\": \"%s\", \"variant\": \"%s\", \"value\": %.6g, \"unit\": \"%s\", \"n\": %llu}%s\n",
+                   r.name.c_str(), r.variant.c_str(), r.value, r.unit.c_str(), (unsigned long long)r.n,
+                   i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    }
+    else
+    {
+        printf("%-18s %-16s %14s  %s\n", "case", "variant", "value", "unit");
+        for (const Result &r : results)
+            printf("%-18s %-16s %14.2f  %s\n", r.name.c_str(), r.variant.c_str(), r.value, r.unit.c_str());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string format = "text";
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        const char *value = eq == std::string::npos ? "" : argv[i] + eq + 1;
+
+        if (key == "format")
+            format = value;
+        else if (key == "only")
+            only = value;
+        else if (key == "scale")
+            scale = atof(value);
+        else
+        {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (format != "text" && format != "csv" && format != "json")
+    {
+        fprintf(stderr, "Unknown format %s (use text, csv or json)\n", format.c_str());
+        return 2;
+    }
+
+    if (selected("parse"))
+        benchParse();
+    if (selected("print_hex64"))
+        benchHex();
+    if (selected("queue"))
+    {
+        benchQueue<uint8_t>("uint8_t");
+        benchQueue<uint32_t>("uint32_t");
+        benchQueue<uint64_t>("uint64_t");
+        benchQueue<TagEvent>("TagEvent");
+    }
+    if (selected("rxbits"))
+        benchRxBits();
+    if (selected("tx"))
+        benchTx();
+    if (selected("easyc"))
+        benchEasyC();
+
+    print(format);
+    return 0;
+}
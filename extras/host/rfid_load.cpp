@@ -0,0 +1,245 @@
+/*
+rfid_load.cpp - Throughput and tail latency of Rfid against the virtual breakout, with the reader polled from a loop
+like on the board. Latency is measured on the virtual clock, from the tag coming out of the breakout (UART frame start
+or easyC registers set) to getId() returning it. Host CPU time per read is printed too, run it under perf or valgrind
+to profile the read path.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host
+    ./build-host/rfid_load [interface=uart|stream|easyc] [switches=0-7] [tags=200] [period=50000] [poll=100]
+                           [latency=0] [jitter=0] [ber=0] [drop=0] [nack=0] [seed=1] [budget=0]
+                           [task=0] [block=0] [int=0] [adaptive=0] [metrics=0]
+
+period is the time between the tags and poll the loop() time, both in microseconds. On UART keep the period longer
+than the frame (about 100 ms at 2400 baud, 2 ms at 115200) plus the 20 ms Rfid waits for more bytes after the last
+one, otherwise the frames run together and get dropped, and the latency can't be matched to its tag. budget above 0
+polls with Rfid::poll(budget) instead of available(), the longest call is printed. task=1 reads in the reader task
+(Rfid::beginTask()) and the loop takes the tags from its queue. block is the time the loop is blocked by the other work
+(WiFi, TLS) in each pass, in microseconds. int=1 connects the INT pin of the breakout to Rfid::attachInterruptPin(),
+the tags come to the onTag() callback from poll() (with budget, 1000 by default) or into the queue of the task. The I2C
+transactions are printed, with the INT pin the bus is used only for the tags. adaptive above 0 enables the adaptive
+easyC polling (Rfid::setAdaptivePolling()) with that ceiling in microseconds, the check rate and the bus utilisation of
+the last second are printed. Use a long period (1000000) to see the backoff between the tags. metrics=1 registers the
+reader in RfidMetrics and prints its snapshot in the line protocol at the end.
+*/
+
+#include "RFID-SOLDERED.h"
+#include "RFID-METRICS.h"
+#include "RfidBreakout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    std::string interface = "uart";
+    unsigned long switches = 0, tags = 200, period = 50000, poll = 100, latency = 0, jitter = 0, seed = 1,
+                  budget = 0, block = 0, adaptive = 0;
+    bool task = false, interrupt = false, metrics = false;
+    double ber = 0, drop = 0, nack = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        const char *value = eq == std::string::npos ? "" : argv[i] + eq + 1;
+
+        if (key == "interface")
+            interface = value;
+        else if (key == "switches")
+            switches = strtoul(value, NULL, 0);
+        else if (key == "tags")
+            tags = strtoul(value, NULL, 0);
+        else if (key == "period")
+            period = strtoul(value, NULL, 0);
+        else if (key == "poll")
+            poll = strtoul(value, NULL, 0);
+        else if (key == "latency")
+            latency = strtoul(value, NULL, 0);
+        else if (key == "jitter")
+            jitter = strtoul(value, NULL, 0);
+        else if (key == "budget")
+            budget = strtoul(value, NULL, 0);
+        else if (key == "task")
+            task = atoi(value);
+        else if (key == "int")
+            interrupt = atoi(value);
+        else if (key == "metrics")
+            metrics = atoi(value);
+        else if (key == "adaptive")
+            adaptive = strtoul(value, NULL, 0);
+        else if (key == "block")
+            block = strtoul(value, NULL, 0);
+        else if (key == "seed")
+            seed = strtoul(value, NULL, 0);
+        else if (key == "ber")
+            ber = atof(value);
+        else if (key == "drop")
+            drop = atof(value);
+        else if (key == "nack")
+            nack = atof(value);
+        else
+        {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    RfidHost::reset();
+    RfidBreakout breakout;
+    breakout.setSwitches(switches);
+    breakout.setLatency(latency, jitter);
+    breakout.setFaults(ber, drop, nack);
+    breakout.setSeed(seed);
+
+    Rfid *rfid;
+    if (interface == "uart")
+    {
+        breakout.beginUart(4, 5);
+        rfid = new Rfid(4, 5, breakout.getBaud());
+    }
+    else if (interface == "stream")
+    {
+        breakout.beginStream();
+        rfid = new Rfid(breakout);
+    }
+    else if (interface == "easyc")
+    {
+        breakout.beginEasyC();
+        rfid = new Rfid();
+    }
+    else
+    {
+        fprintf(stderr, "Unknown interface %s\n", interface.c_str());
+        return 2;
+    }
+
+    if (interface == "easyc")
+        rfid->begin(breakout.getAddress());
+    else
+        rfid->begin();
+    RfidHost::advanceMicros(1000);
+
+    // Ping can be lost to the faults too, try a few times like a sketch would.
+    bool detected = false;
+    for (uint8_t i = 0; i < 5 && !detected; i++)
+        detected = rfid->checkHW();
+    if (!detected)
+    {
+        fprintf(stderr, "Breakout not detected\n");
+        return 1;
+    }
+
+    // Tag i has ID 1000 + i, so wrong IDs can be told apart.
+    const uint32_t firstId = 1000;
+    for (unsigned long i = 0; i < tags; i++)
+        breakout.addTag(1000 + i * period, firstId + i);
+
+    // Tags delivered in a loop pass, with the time they were delivered.
+    std::vector<std::pair<uint32_t, uint64_t> > delivered;
+
+    const uint8_t intPin = 2;
+    if (interrupt)
+    {
+        breakout.setIntPin(intPin);
+        rfid->attachInterruptPin(intPin);
+        if (!task)
+        {
+            if (!budget)
+                budget = 1000;
+            rfid->onTag([&delivered](const TagEvent &event) { delivered.push_back({event.id, RfidHost::cycles()}); });
+        }
+    }
+
+    RfidMetrics registry;
+    if (metrics)
+        rfid->setMetrics(&registry, "load");
+
+    if (adaptive)
+        rfid->setAdaptivePolling(true, RFID_ADAPTIVE_FAST_US, adaptive);
+
+    RfidEventQueue queue(64);
+    if (task && !rfid->beginTask(queue))
+    {
+        fprintf(stderr, "Reader task not started\n");
+        return 1;
+    }
+
+    std::vector<double> latencies;
+    unsigned long wrong = 0;
+    uint64_t longestCall = 0;
+    uint32_t startTransactions = Wire.transactions();
+    uint64_t startCycle = RfidHost::cycles();
+    auto start = std::chrono::steady_clock::now();
+
+    // Runs until all tags are out and one more period passed for the last one.
+    uint64_t endCycle = 0;
+    while (!endCycle || RfidHost::cycles() < endCycle)
+    {
+        if (!endCycle && breakout.idle())
+            endCycle = RfidHost::cycles() + (uint64_t)period * RfidHost::CPU_MHZ;
+
+        // Loop pass takes all the tags from the queue of the task, or one from the reader (the callback gets it).
+        uint64_t callCycle = RfidHost::cycles();
+        if (task)
+        {
+            while (queue.available())
+                delivered.push_back({queue.pop().id, RfidHost::cycles()});
+        }
+        else if ((budget ? rfid->poll(budget) : rfid->available()) && !interrupt)
+        {
+            delivered.push_back({rfid->getId(), RfidHost::cycles()});
+        }
+        longestCall = std::max(longestCall, RfidHost::cycles() - callCycle);
+
+        for (const std::pair<uint32_t, uint64_t> &tag : delivered)
+        {
+            if (tag.first < firstId || tag.first >= firstId + tags)
+                wrong++;
+            else
+                latencies.push_back((double)(tag.second - breakout.lastTagCycle()) / RfidHost::CPU_MHZ);
+        }
+        delivered.clear();
+
+        if (block)
+            delayMicroseconds(block);
+        RfidHost::advanceMicros(poll);
+    }
+
+    double hostNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    double virtualSeconds = (double)(RfidHost::cycles() - startCycle) / RfidHost::CPU_MHZ / 1e6;
+    RfidBreakoutStats stats = breakout.stats();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[(size_t)(p * (latencies.size() - 1) + 0.5)];
+    };
+
+    printf("interface %s, %lu baud / address 0x%02X, %lu tags every %lu us, poll %lu us\n", interface.c_str(),
+           (unsigned long)breakout.getBaud(), breakout.getAddress(), tags, period, poll);
+    printf("delivered %zu / %lu (%.2f%%), wrong %lu\n", latencies.size(), tags,
+           tags ? 100.0 * latencies.size() / tags : 0.0, wrong);
+    printf("breakout: frames %u, dropped bytes %u, bit errors %u, NACKs %u, overwritten %u\n", stats.frames,
+           stats.droppedBytes, stats.bitErrors, stats.nacks, stats.overwritten);
+    printf("throughput %.1f tags/s (virtual time %.3f s)\n", virtualSeconds > 0 ? latencies.size() / virtualSeconds : 0,
+           virtualSeconds);
+    printf("latency us: p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n", percentile(0.5), percentile(0.9),
+           percentile(0.99), latencies.empty() ? 0.0 : latencies.back());
+    if (task)
+        printf("reader task: dropped %u (queue full)\n", rfid->droppedEvents());
+    printf("longest %s call %.1f us\n", task ? "queue" : budget ? "poll()" : "available()",
+           (double)longestCall / RfidHost::CPU_MHZ);
+    printf("I2C transactions %u\n", Wire.transactions() - startTransactions);
+    if (interface == "easyc")
+        printf("last second: %.1f checks/s, bus utilisation %.3f%%, check interval %u us\n", rfid->pollRate(),
+               rfid->busUtilization(), rfid->pollInterval());
+    printf("host CPU %.0f ns per tag\n", tags ? hostNs / tags : 0.0);
+    if (metrics)
+        registry.snapshot(Serial, RFID_METRICS_LINE);
+
+    delete rfid;
+    return 0;
+}
@@ -0,0 +1,256 @@
+/*
+rfid_replay.cpp - Records the reader traffic into a capture file and plays a capture back through Rfid. A capture made
+on the board (RfidCapture to Serial or to the SD card) replays the same way, so field problems can be run again on
+Linux, as a regression test (exits with 1 if the tags read differ from the tags the reader returned when the capture
+was made) or as a benchmark.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host
+    ./build-host/rfid_replay record=<file> [interface=uart|stream|easyc] [switches=0-7] [tags=50] [period=50000]
+                             [edges=0] [poll=100]
+    ./build-host/rfid_replay play=<file> [via=stream|uart|edges|easyc] [speed=original|max] [poll=100]
+
+record runs the virtual breakout like rfid_load and captures what the reader sees, edges=1 adds the software serial
+edges (interface=uart). play uses the interface in the capture header by default (uart, stream or easyc), speed=max
+shortens the gaps longer than 21 ms, so the idle time is skipped. Both can be given, the capture is recorded and then
+played.
+*/
+
+#include "RFID-SOLDERED.h"
+#include "RFID-CAPTURE.h"
+#include "RfidBreakout.h"
+#include "RfidReplay.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+static const uint8_t RX_PIN = 4;
+static const uint8_t TX_PIN = 5;
+
+struct Options
+{
+    std::string record;
+    std::string play;
+    std::string interface = "uart";
+    std::string via;
+    std::string speed = "original";
+    unsigned long switches = 0, tags = 50, period = 50000, poll = 100;
+    bool edges = false;
+};
+
+static int record(const Options &options)
+{
+    RfidHost::reset();
+    RfidBreakout breakout;
+    breakout.setSwitches(options.switches);
+
+    Rfid *rfid;
+    uint8_t sources = RFID_CAPTURE_UART | RFID_CAPTURE_EASYC;
+    if (options.interface == "uart")
+    {
+        breakout.beginUart(RX_PIN, TX_PIN);
+        rfid = new Rfid(RX_PIN, TX_PIN, breakout.getBaud());
+        if (options.edges)
+            sources |= RFID_CAPTURE_EDGES;
+    }
+    else if (options.interface == "stream")
+    {
+        breakout.beginStream();
+        rfid = new Rfid(breakout);
+    }
+    else if (options.interface == "easyc")
+    {
+        breakout.beginEasyC();
+        rfid = new Rfid();
+    }
+    else
+    {
+        fprintf(stderr, "Unknown interface %s\n", options.interface.c_str());
+        return 2;
+    }
+
+    if (options.interface == "easyc")
+        rfid->begin(breakout.getAddress());
+    else
+        rfid->begin();
+    RfidHost::advanceMicros(1000);
+
+    RfidCaptureFile file;
+    if (!file.open(options.record.c_str()))
+    {
+        fprintf(stderr, "Can't create %s\n", options.record.c_str());
+        delete rfid;
+        return 2;
+    }
+    RfidCapture capture;
+    capture.begin(file, sources);
+    rfid->setCapture(&capture);
+
+    // The ping and its answer are in the capture too.
+    rfid->checkHW();
+
+    for (unsigned long i = 0; i < options.tags; i++)
+        breakout.addTag(1000 + i * options.period, 1000 + i);
+
+    unsigned long delivered = 0;
+    uint64_t endCycle = 0;
+    while (!endCycle || RfidHost::cycles() < endCycle)
+    {
+        if (!endCycle && breakout.idle())
+            endCycle = RfidHost::cycles() + (uint64_t)options.period * RfidHost::CPU_MHZ;
+
+        if (rfid->available())
+        {
+            rfid->getId();
+            rfid->getRaw();
+            delivered++;
+        }
+        RfidHost::advanceMicros(options.poll);
+    }
+
+    rfid->setCapture(NULL);
+    delete rfid;
+    file.close();
+
+    printf("recorded %s: %lu / %lu tags, %u records, %u bytes (%.1f bytes per tag)\n", options.record.c_str(),
+           delivered, options.tags, capture.records(), capture.bytes(),
+           delivered ? (double)capture.bytes() / delivered : 0.0);
+    return capture.errors() ? 1 : 0;
+}
+
+static int play(const Options &options)
+{
+    RfidHost::reset();
+    RfidReplay replay;
+    if (!replay.load(options.play.c_str()))
+    {
+        fprintf(stderr, "%s is not a capture\n", options.play.c_str());
+        return 2;
+    }
+    const RfidCaptureHeader &header = replay.header();
+
+    std::string via = options.via;
+    if (via.empty())
+        via = !header.native ? "easyc" : header.baud ? "uart" : "stream";
+    replay.setSpeed(options.speed == "max" ? RFID_REPLAY_MAX : RFID_REPLAY_ORIGINAL);
+
+    // Playback is started before begin(), so the line is already idle when the software serial starts.
+    Rfid *rfid;
+    bool playing;
+    if (via == "stream")
+    {
+        rfid = new Rfid(replay);
+        playing = replay.playStream();
+        rfid->begin();
+    }
+    else if (via == "uart" || via == "edges")
+    {
+        playing = via == "uart" ? replay.playUart(RX_PIN) : replay.playEdges(RX_PIN);
+        rfid = new Rfid(RX_PIN, TX_PIN, header.baud);
+        if (playing)
+            rfid->begin();
+    }
+    else if (via == "easyc")
+    {
+        rfid = new Rfid();
+        playing = replay.playEasyC();
+        rfid->begin(header.address);
+    }
+    else
+    {
+        fprintf(stderr, "Unknown via %s\n", via.c_str());
+        return 2;
+    }
+
+    if (!playing)
+    {
+        fprintf(stderr, "Capture has no traffic to play via %s\n", via.c_str());
+        delete rfid;
+        return 2;
+    }
+
+    std::vector<uint32_t> ids;
+    uint64_t startCycle = RfidHost::cycles();
+    uint64_t endCycle = replay.endCycle() + 2 * RFID_REPLAY_MAX_GAP_US * (uint64_t)RfidHost::CPU_MHZ;
+    auto start = std::chrono::steady_clock::now();
+
+    while (!replay.idle() || RfidHost::cycles() < endCycle)
+    {
+        if (rfid->available())
+            ids.push_back(rfid->getId());
+        RfidHost::advanceMicros(options.poll);
+    }
+
+    double hostNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    double virtualSeconds = (double)(RfidHost::cycles() - startCycle) / RfidHost::CPU_MHZ / 1e6;
+    delete rfid;
+
+    const std::vector<uint32_t> &expected = replay.tagIds();
+    size_t same = 0;
+    while (same < ids.size() && same < expected.size() && ids[same] == expected[same])
+        same++;
+    bool match = same == ids.size() && same == expected.size();
+
+    printf("played %s via %s at %s speed: %zu / %zu tags, %s\n", options.play.c_str(), via.c_str(),
+           options.speed.c_str(), ids.size(), expected.size(), match ? "same as recorded" : "DIFFERENT");
+    if (!match)
+        printf("first difference at tag %zu\n", same);
+    printf("virtual time %.3f s (%.1f tags/s), host CPU %.0f ns per tag\n", virtualSeconds,
+           virtualSeconds > 0 ? ids.size() / virtualSeconds : 0.0, ids.empty() ? 0.0 : hostNs / ids.size());
+
+    return match ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        const char *value = eq == std::string::npos ? "" : argv[i] + eq + 1;
+
+        if (key == "record")
+            options.record = value;
+        else if (key == "play")
+            options.play = value;
+        else if (key == "interface")
+            options.interface = value;
+        else if (key == "via")
+            options.via = value;
+        else if (key == "speed")
+            options.speed = value;
+        else if (key == "switches")
+            options.switches = strtoul(value, NULL, 0);
+        else if (key == "tags")
+            options.tags = strtoul(value, NULL, 0);
+        else if (key == "period")
+            options.period = strtoul(value, NULL, 0);
+        else if (key == "poll")
+            options.poll = strtoul(value, NULL, 0);
+        else if (key == "edges")
+            options.edges = atoi(value);
+        else
+        {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if (options.record.empty() && options.play.empty())
+    {
+        fprintf(stderr, "Give record=<file> and/or play=<file>\n");
+        return 2;
+    }
+
+    int result = 0;
+    if (!options.record.empty())
+        result = record(options);
+    if (!result && !options.play.empty())
+        result = play(options);
+
+    return result;
+}
@@ -0,0 +1,240 @@
+/*
+rfid_smoke.cpp - Runs the library on the virtual ESP32: a native reader over a given Stream, an easyC reader over the
+virtual I2C bus and a native reader with its own software serial, all talking to the virtual breakout, and the metrics
+of each of them. Exits with 1 if any read or metric is wrong.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/rfid_smoke
+*/
+
+#include "RFID-SOLDERED.h"
+#include "RFID-EM4100.h"
+#include "RFID-METRICS.h"
+#include "RfidBreakout.h"
+
+#include <string>
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok)
+        failures++;
+}
+
+// Stream holding the bytes the breakout sent, the bytes written to it are kept in tx.
+class BufferStream : public Stream
+{
+  public:
+    std::string rx;
+    std::string tx;
+    size_t index = 0;
+
+    int available()
+    {
+        return (int)(rx.size() - index);
+    }
+    int read()
+    {
+        return index < rx.size() ? (uint8_t)rx[index++] : -1;
+    }
+    int peek()
+    {
+        return index < rx.size() ? (uint8_t)rx[index] : -1;
+    }
+    size_t write(uint8_t c)
+    {
+        tx.push_back((char)c);
+        return 1;
+    }
+    using Print::write;
+};
+
+static void countEdge(uint8_t pin, bool level, uint64_t cycle, void *ctx)
+{
+    (void)level;
+    (void)cycle;
+    if (pin == 5)
+        (*(uint32_t *)ctx)++;
+}
+
+static std::string frameText(uint32_t id, uint64_t raw)
+{
+    char text[40];
+    snprintf(text, sizeof(text), "$%lu&%016llX\r\n", (unsigned long)id, (unsigned long long)raw);
+    return text;
+}
+
+int main()
+{
+    const uint32_t id = 0x0012A4C7;
+    const uint64_t raw = Em4100::encode(0x3C, id);
+
+    // Native reader over the given Stream.
+    {
+        RfidHost::reset();
+        BufferStream stream;
+        Rfid rfid(stream);
+        rfid.begin();
+
+        stream.rx = frameText(id, raw);
+        check(rfid.available(), "stream: tag available");
+        check(rfid.getId() == id, "stream: tag ID");
+
+        stream.rx = frameText(id, raw ^ 0x10);
+        stream.index = 0;
+        check(rfid.available() && rfid.getRaw() == (raw ^ 0x10), "stream: corrupted frame passed without validation");
+
+        rfid.setFrameValidation(true);
+        stream.index = 0;
+        check(!rfid.available(), "stream: corrupted frame rejected");
+
+        stream.rx = "#hello\r\n";
+        stream.index = 0;
+        check(rfid.checkHW() && stream.tx.find("#rfping") != std::string::npos, "stream: ping answered");
+    }
+
+    // easyC reader over the virtual I2C bus.
+    {
+        RfidHost::reset();
+        RfidBreakout breakout;
+        breakout.beginEasyC();
+
+        Rfid rfid;
+        rfid.begin();
+        check(rfid.checkHW(), "easyC: breakout found");
+
+        breakout.addTag(100, id, 0x3C);
+        RfidHost::advanceMicros(200);
+        uint32_t before = Wire.transactions();
+        check(rfid.available(), "easyC: tag available");
+        check(rfid.getId() == id, "easyC: tag ID");
+        printf("%-60s %u\n", "easyC: I2C transactions per tag", (unsigned)(Wire.transactions() - before));
+        check(!rfid.available(), "easyC: tag cleared after reading");
+
+        // Validated tag taken only by getId(), the RAW data of the next tag must come from the breakout.
+        rfid.setFrameValidation(true);
+        breakout.addTag(100, id, 0x3C);
+        RfidHost::advanceMicros(200);
+        check(rfid.available() && rfid.getId() == id, "easyC: validated tag ID");
+        rfid.setFrameValidation(false);
+        breakout.addTag(100, id + 1, 0x3D);
+        RfidHost::advanceMicros(200);
+        check(rfid.available() && rfid.getRaw() == Em4100::encode(0x3D, id + 1), "easyC: no stale RAW data");
+    }
+
+    // Native reader with its own software serial, RX on pin 4, TX on pin 5, at each of the DIP switch baud rates.
+    for (uint8_t switches = 0; switches < 8; switches++)
+    {
+        RfidHost::reset();
+        uint32_t txEdges = 0;
+        RfidHost::watchPins(countEdge, &txEdges);
+
+        RfidBreakout breakout;
+        breakout.setSwitches(switches);
+        breakout.setLatency(500, 0);
+        breakout.beginUart(4, 5);
+
+        Rfid rfid(4, 5, breakout.getBaud());
+        rfid.begin();
+        RfidHost::advanceMicros(1000);
+
+        char what[64];
+        snprintf(what, sizeof(what), "software serial %6lu: ping answered", (unsigned long)breakout.getBaud());
+        check(rfid.checkHW() && txEdges > 0 && breakout.stats().pings == 1, what);
+
+        breakout.addTag(0, id, 0x3C);
+        while (!breakout.idle())
+            RfidHost::advanceMicros(100);
+        snprintf(what, sizeof(what), "software serial %6lu: tag ID", (unsigned long)breakout.getBaud());
+        check(rfid.available() && rfid.getId() == id, what);
+
+        rfid.end();
+        breakout.addTag(0, id, 0x3C);
+        while (!breakout.idle())
+            RfidHost::advanceMicros(100);
+        snprintf(what, sizeof(what), "software serial %6lu: nothing after end()", (unsigned long)breakout.getBaud());
+        check(!rfid.available(), what);
+        RfidHost::unwatchPins(countEdge, &txEdges);
+    }
+
+    // Metrics of the readers, registered in one registry and serialized.
+    {
+        RfidHost::reset();
+        RfidMetrics metrics;
+
+        BufferStream stream;
+        Rfid native(stream);
+        native.begin();
+        native.setFrameValidation(true);
+        check(native.setMetrics(&metrics, "door") && metrics.size() == 8, "metrics: stream reader registered");
+
+        stream.rx = frameText(id, raw);
+        native.available();
+        stream.rx = frameText(id, raw ^ 0x10);
+        stream.index = 0;
+        native.available();
+
+        char line[512];
+        size_t length = metrics.snapshot((uint8_t *)line, sizeof(line) - 1, RFID_METRICS_LINE);
+        line[length] = '\0';
+        check(strstr(line, "rfid,source=door tags=1i,invalid=1i,") != NULL, "metrics: stream tags and invalid frames");
+        check(!metrics.snapshot((uint8_t *)line, 20, RFID_METRICS_LINE), "metrics: snapshot too big for the buffer");
+
+        RfidBreakout breakout;
+        breakout.beginEasyC();
+        Rfid easyc;
+        easyc.begin();
+        easyc.setFrameValidation(true);
+        check(easyc.setMetrics(&metrics, "gate") && metrics.size() == 20, "metrics: easyC reader registered");
+        breakout.addTag(100, id, 0x3C);
+        RfidHost::advanceMicros(200);
+        easyc.available();
+
+        uint8_t binary[RFID_METRICS_BINARY_MAX];
+        length = metrics.snapshot(binary, sizeof(binary), RFID_METRICS_BINARY);
+        uint32_t hash = binary[4] | binary[5] << 8 | binary[6] << 16 | (uint32_t)binary[7] << 24;
+        check(length > RFID_METRICS_HEADER_SIZE && binary[0] == 'R' && binary[3] == 20 && hash == metrics.schemaHash(),
+              "metrics: binary snapshot");
+
+        // LEB128 values in the order of the schema, the easyC reader follows the 8 values of the stream reader.
+        uint32_t values[20] = {0};
+        size_t at = RFID_METRICS_HEADER_SIZE;
+        for (uint8_t i = 0; i < 20 && at < length; i++)
+            for (uint8_t shift = 0; at < length; shift += 7)
+            {
+                values[i] |= (uint32_t)(binary[at] & 0x7F) << shift;
+                if (!(binary[at++] & 0x80))
+                    break;
+            }
+        check(at == length && values[8 + RFID_METRIC_TAGS] == 1 && values[8 + RFID_METRIC_BUS_CHECKS] == 1 &&
+                  values[8 + RFID_METRIC_BUS_MICROS] > 0 && values[16 + RFID_METRIC_EASYC_WRITES] == 3 &&
+                  values[16 + RFID_METRIC_EASYC_READS] == 3,
+              "metrics: easyC tag, checks and bus transactions");
+
+        Rfid moved(std::move(easyc));
+        check(metrics.size() == 20 && metrics.schemaHash() == hash, "metrics: registration moved with the reader");
+        moved.setMetrics(NULL, NULL);
+        check(metrics.size() == 8 && metrics.schemaHash() != hash, "metrics: reader removed");
+
+        breakout.end();
+        RfidBreakout uart;
+        uart.beginUart(4, 5);
+        {
+            Rfid serial(4, 5, uart.getBaud());
+            serial.begin();
+            check(serial.setMetrics(&metrics, "lobby") && metrics.size() == 21, "metrics: software serial registered");
+            RfidHost::advanceMicros(1000);
+            serial.checkHW();
+            length = metrics.snapshot((uint8_t *)line, sizeof(line) - 1, RFID_METRICS_LINE);
+            line[length] = '\0';
+            check(strstr(line, "serial,source=lobby rx_bytes=8i,tx_bytes=9i,") != NULL,
+                  "metrics: software serial bytes");
+        }
+        check(metrics.size() == 8, "metrics: destroyed reader removed");
+    }
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
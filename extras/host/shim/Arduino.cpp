@@ -0,0 +1,624 @@
+/**
+ **************************************************
+ *
+ * @file        Arduino.cpp
+ * @brief       Virtual ESP32: clock, scheduled events, GPIO pins with interrupts and the Arduino functions using
+ *              them.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "Arduino.h"
+#include "soc/gpio_struct.h"
+
+#include <queue>
+#include <random>
+#include <vector>
+
+EspClass ESP;
+HardwareSerial Serial;
+
+// Hardware timer: its alarm is a scheduled event of the clock, the callback runs like a pin ISR.
+struct hw_timer_s
+{
+    bool used;
+    uint32_t frequency;
+    void (*fn)(void);
+    void (*fnArg)(void *);
+    void *arg;
+    uint64_t period;
+    uint64_t next;
+    bool autoreload;
+    bool pending;
+};
+
+namespace
+{
+// Scheduled event, events with the same time run in the order they were scheduled.
+struct Event
+{
+    uint64_t cycle;
+    uint64_t order;
+    RfidHost::EventFn fn;
+    void *ctx;
+};
+
+struct Later
+{
+    bool operator()(const Event &_a, const Event &_b) const
+    {
+        return _a.cycle != _b.cycle ? _a.cycle > _b.cycle : _a.order > _b.order;
+    }
+};
+
+// Interrupt attached to the pin.
+struct PinIsr
+{
+    void (*fn)(void);
+    void (*fnArg)(void *);
+    void *arg;
+    int mode;
+    bool pending;
+};
+
+struct Watcher
+{
+    RfidHost::PinWatcher fn;
+    void *ctx;
+};
+
+const uint8_t MAX_WATCHERS = 8;
+const uint8_t MAX_TIMERS = 4;
+const uint8_t PORTS = RfidHost::PINS / 32;
+
+// Virtual clock and the events.
+uint64_t now = 0;
+uint32_t readCost = RfidHost::CPU_MHZ;
+uint32_t cycleCountCost = 24;
+uint64_t eventOrder = 0;
+std::priority_queue<Event, std::vector<Event>, Later> events;
+
+// GPIO registers as seen by the library, and the output levels last reported to the watchers.
+volatile uint32_t gpioIn[PORTS];
+volatile uint32_t gpioOut[PORTS];
+uint32_t reportedOut[PORTS];
+uint8_t pinModes[RfidHost::PINS];
+bool pinDriven[RfidHost::PINS];
+
+// Interrupts.
+PinIsr isrs[RfidHost::PINS];
+int interruptsDisabled = 0;
+bool inIsr = false;
+uint32_t isrCallCount = 0;
+uint64_t isrCycleCount = 0;
+uint32_t isrLatencyMin = RfidHost::ISR_LATENCY;
+uint32_t isrLatencyMax = RfidHost::ISR_LATENCY;
+std::minstd_rand isrJitter;
+
+Watcher watchers[MAX_WATCHERS];
+
+hw_timer_s timers[MAX_TIMERS];
+
+bool getBit(volatile uint32_t *_reg, uint8_t _pin)
+{
+    return (_reg[_pin / 32] >> (_pin % 32)) & 1;
+}
+
+void setBit(volatile uint32_t *_reg, uint8_t _pin, bool _level)
+{
+    if (_level)
+        _reg[_pin / 32] |= 1UL << (_pin % 32);
+    else
+        _reg[_pin / 32] &= ~(1UL << (_pin % 32));
+}
+
+// Reports the output pin changes (made by digitalWrite() or by writing the output register directly) to the watchers.
+void checkOutputs()
+{
+    for (uint8_t _port = 0; _port < PORTS; _port++)
+    {
+        uint32_t _changed = gpioOut[_port] ^ reportedOut[_port];
+        reportedOut[_port] = gpioOut[_port];
+
+        while (_changed)
+        {
+            uint8_t _bit = __builtin_ctz(_changed);
+            _changed &= _changed - 1;
+
+            uint8_t _pin = _port * 32 + _bit;
+            bool _level = (gpioOut[_port] >> _bit) & 1;
+            for (uint8_t i = 0; i < MAX_WATCHERS; i++)
+            {
+                if (watchers[i].fn)
+                    watchers[i].fn(_pin, _level, now, watchers[i].ctx);
+            }
+        }
+    }
+}
+
+void runIsr(uint8_t _pin)
+{
+    PinIsr &_isr = isrs[_pin];
+    if (_isr.fnArg)
+        _isr.fnArg(_isr.arg);
+    else if (_isr.fn)
+        _isr.fn();
+}
+
+void runTimerIsr(hw_timer_s &_timer)
+{
+    if (_timer.fnArg)
+        _timer.fnArg(_timer.arg);
+    else if (_timer.fn)
+        _timer.fn();
+}
+
+// Runs the interrupts that were held back while another ISR ran or while interrupts were disabled. Like the ESP-IDF
+// 4.x GPIO driver, the interrupt of the pin is cleared when its ISR returns, so the edges of the same pin during its
+// ISR are lost (the software serial RX ISR above 74880 baud samples the whole byte inside the ISR and relies on it).
+void runPendingIsrs()
+{
+    bool _ran = true;
+    while (_ran && !inIsr && !interruptsDisabled)
+    {
+        _ran = false;
+        for (uint8_t i = 0; i < RfidHost::PINS; i++)
+        {
+            if (isrs[i].pending)
+            {
+                uint64_t _start = now;
+                inIsr = true;
+                runIsr(i);
+                inIsr = false;
+                isrCallCount++;
+                isrCycleCount += now - _start;
+                isrs[i].pending = false;
+                _ran = true;
+            }
+        }
+        for (uint8_t i = 0; i < MAX_TIMERS; i++)
+        {
+            if (timers[i].pending)
+            {
+                uint64_t _start = now;
+                inIsr = true;
+                timers[i].pending = false;
+                runTimerIsr(timers[i]);
+                inIsr = false;
+                isrCallCount++;
+                isrCycleCount += now - _start;
+                _ran = true;
+            }
+        }
+    }
+}
+
+// Alarm of the timer, raises its interrupt and schedules the next alarm when it reloads.
+void timerEvent(void *_ctx)
+{
+    hw_timer_s *_timer = (hw_timer_s *)_ctx;
+    if (_timer->autoreload)
+    {
+        _timer->next += _timer->period;
+        RfidHost::schedule(_timer->next, timerEvent, _timer);
+    }
+
+    if (_timer->fn || _timer->fnArg)
+    {
+        _timer->pending = true;
+        runPendingIsrs();
+    }
+}
+
+// Raises the interrupt of the pin. Like the hardware, one interrupt per pin is latched while it can't run.
+void raiseIsr(void *_ctx)
+{
+    uint8_t _pin = (uint8_t)(uintptr_t)_ctx;
+    if (!isrs[_pin].fn && !isrs[_pin].fnArg)
+        return;
+
+    isrs[_pin].pending = true;
+    runPendingIsrs();
+}
+
+void attach(uint8_t _pin, void (*_fn)(void), void (*_fnArg)(void *), void *_arg, int _mode)
+{
+    if (_pin >= RfidHost::PINS)
+        return;
+
+    isrs[_pin].fn = _fn;
+    isrs[_pin].fnArg = _fnArg;
+    isrs[_pin].arg = _arg;
+    isrs[_pin].mode = _mode;
+    isrs[_pin].pending = false;
+}
+} // namespace
+
+namespace RfidHost
+{
+void reset()
+{
+    // Tasks are deleted first, they may still use the clock while they unwind.
+    deleteTasks();
+
+    now = 0;
+    readCost = CPU_MHZ;
+    cycleCountCost = 24;
+    eventOrder = 0;
+    events = std::priority_queue<Event, std::vector<Event>, Later>();
+
+    for (uint8_t i = 0; i < PORTS; i++)
+    {
+        gpioIn[i] = 0;
+        gpioOut[i] = 0;
+        reportedOut[i] = 0;
+    }
+    for (uint8_t i = 0; i < PINS; i++)
+    {
+        pinModes[i] = INPUT;
+        pinDriven[i] = false;
+        isrs[i] = PinIsr();
+    }
+    for (uint8_t i = 0; i < MAX_TIMERS; i++)
+        timers[i] = hw_timer_s();
+    for (uint8_t i = 0; i < MAX_WATCHERS; i++)
+        watchers[i] = Watcher();
+
+    interruptsDisabled = 0;
+    inIsr = false;
+    isrCallCount = 0;
+    isrCycleCount = 0;
+    isrLatencyMin = ISR_LATENCY;
+    isrLatencyMax = ISR_LATENCY;
+}
+
+uint64_t cycles()
+{
+    return now;
+}
+
+void runUntil(uint64_t _cycle)
+{
+    // Output register may have been written since the last clock move, report it with the time it was written.
+    checkOutputs();
+
+    while (!events.empty() && (!_cycle || events.top().cycle <= _cycle))
+    {
+        Event _event = events.top();
+        events.pop();
+
+        if (_event.cycle > now)
+            now = _event.cycle;
+        _event.fn(_event.ctx);
+        checkOutputs();
+    }
+
+    if (_cycle > now)
+        now = _cycle;
+}
+
+void advance(uint64_t _cycles)
+{
+    runUntil(now + _cycles);
+}
+
+void advanceMicros(uint64_t _us)
+{
+    advance(_us * CPU_MHZ);
+}
+
+void setReadCost(uint32_t _timeCycles, uint32_t _cycleCountCycles)
+{
+    readCost = _timeCycles;
+    cycleCountCost = _cycleCountCycles;
+}
+
+void schedule(uint64_t _cycle, EventFn _fn, void *_ctx)
+{
+    Event _event = {_cycle < now ? now : _cycle, eventOrder++, _fn, _ctx};
+    events.push(_event);
+}
+
+void cancelEvents(void *_ctx)
+{
+    std::priority_queue<Event, std::vector<Event>, Later> _kept;
+    for (; !events.empty(); events.pop())
+    {
+        if (events.top().ctx != _ctx)
+            _kept.push(events.top());
+    }
+    events.swap(_kept);
+}
+
+size_t pendingEvents()
+{
+    return events.size();
+}
+
+void setPin(uint8_t _pin, bool _level)
+{
+    if (_pin >= PINS)
+        return;
+
+    pinDriven[_pin] = true;
+    bool _old = getBit(gpioIn, _pin);
+    setBit(gpioIn, _pin, _level);
+    if (_old == _level)
+        return;
+
+    int _mode = isrs[_pin].mode;
+    bool _match = _mode == CHANGE || (_mode == RISING && _level) || (_mode == FALLING && !_level);
+    if (!_match || (!isrs[_pin].fn && !isrs[_pin].fnArg))
+        return;
+
+    uint32_t _latency = isrLatencyMin;
+    if (isrLatencyMax > isrLatencyMin)
+        _latency += isrJitter() % (isrLatencyMax - isrLatencyMin + 1);
+
+    if (_latency)
+        schedule(now + _latency, raiseIsr, (void *)(uintptr_t)_pin);
+    else
+        raiseIsr((void *)(uintptr_t)_pin);
+}
+
+bool getPin(uint8_t _pin)
+{
+    return digitalRead(_pin);
+}
+
+void setIsrLatency(uint32_t _minCycles, uint32_t _maxCycles, uint32_t _seed)
+{
+    isrLatencyMin = _minCycles;
+    isrLatencyMax = _maxCycles > _minCycles ? _maxCycles : _minCycles;
+    isrJitter.seed(_seed);
+}
+
+bool isrContext()
+{
+    return inIsr || interruptsDisabled;
+}
+
+uint32_t isrCalls()
+{
+    return isrCallCount;
+}
+
+uint64_t isrCycles()
+{
+    return isrCycleCount;
+}
+
+void watchPins(PinWatcher _fn, void *_ctx)
+{
+    for (uint8_t i = 0; i < MAX_WATCHERS; i++)
+    {
+        if (!watchers[i].fn)
+        {
+            watchers[i].fn = _fn;
+            watchers[i].ctx = _ctx;
+            return;
+        }
+    }
+}
+
+void unwatchPins(PinWatcher _fn, void *_ctx)
+{
+    for (uint8_t i = 0; i < MAX_WATCHERS; i++)
+    {
+        if (watchers[i].fn == _fn && watchers[i].ctx == _ctx)
+            watchers[i] = Watcher();
+    }
+}
+} // namespace RfidHost
+
+unsigned long millis()
+{
+    RfidHost::advance(readCost);
+    return (unsigned long)(now / (RfidHost::CPU_MHZ * 1000UL));
+}
+
+unsigned long micros()
+{
+    RfidHost::advance(readCost);
+    return (unsigned long)(uint32_t)(now / RfidHost::CPU_MHZ);
+}
+
+void delay(uint32_t _ms)
+{
+    // Like on the ESP32, delay() in a task blocks it and lets the other tasks run.
+    if (RfidHost::inTask())
+    {
+        vTaskDelay(pdMS_TO_TICKS(_ms));
+        return;
+    }
+
+    RfidHost::advance((uint64_t)_ms * RfidHost::CPU_MHZ * 1000);
+}
+
+void delayMicroseconds(uint32_t _us)
+{
+    RfidHost::advanceMicros(_us);
+}
+
+void yield()
+{
+    RfidHost::advance(readCost);
+}
+
+void optimistic_yield(uint32_t _intervalUs)
+{
+    (void)_intervalUs;
+    RfidHost::advance(readCost);
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    RfidHost::advance(cycleCountCost);
+    return (uint32_t)now;
+}
+
+void pinMode(uint8_t _pin, uint8_t _mode)
+{
+    if (_pin >= RfidHost::PINS)
+        return;
+
+    pinModes[_pin] = _mode;
+
+    // Pull-up holds the pin high until something drives it.
+    if ((_mode & PULLUP) && !pinDriven[_pin])
+        setBit(gpioIn, _pin, true);
+}
+
+void digitalWrite(uint8_t _pin, uint8_t _level)
+{
+    if (_pin >= RfidHost::PINS)
+        return;
+
+    setBit(gpioOut, _pin, _level);
+    checkOutputs();
+}
+
+int digitalRead(uint8_t _pin)
+{
+    if (_pin >= RfidHost::PINS)
+        return LOW;
+
+    return (pinModes[_pin] & OUTPUT) == OUTPUT ? getBit(gpioOut, _pin) : getBit(gpioIn, _pin);
+}
+
+void attachInterrupt(uint8_t _pin, void (*_isr)(void), int _mode)
+{
+    attach(_pin, _isr, NULL, NULL, _mode);
+}
+
+void attachInterruptArg(uint8_t _pin, void (*_isr)(void *), void *_arg, int _mode)
+{
+    attach(_pin, NULL, _isr, _arg, _mode);
+}
+
+void detachInterrupt(uint8_t _pin)
+{
+    attach(_pin, NULL, NULL, NULL, 0);
+}
+
+void noInterrupts()
+{
+    interruptsDisabled++;
+}
+
+void interrupts()
+{
+    if (interruptsDisabled)
+        interruptsDisabled--;
+
+    runPendingIsrs();
+}
+
+hw_timer_t *timerBegin(uint32_t _frequency)
+{
+    for (uint8_t i = 0; i < MAX_TIMERS; i++)
+    {
+        if (!timers[i].used)
+        {
+            timers[i] = hw_timer_s();
+            timers[i].used = true;
+            timers[i].frequency = _frequency ? _frequency : 1;
+            return &timers[i];
+        }
+    }
+
+    return NULL;
+}
+
+void timerEnd(hw_timer_t *_timer)
+{
+    if (!_timer)
+        return;
+
+    RfidHost::cancelEvents(_timer);
+    *_timer = hw_timer_s();
+}
+
+void timerAttachInterrupt(hw_timer_t *_timer, void (*_isr)(void))
+{
+    if (!_timer)
+        return;
+
+    _timer->fn = _isr;
+    _timer->fnArg = NULL;
+}
+
+void timerAttachInterruptArg(hw_timer_t *_timer, void (*_isr)(void *), void *_arg)
+{
+    if (!_timer)
+        return;
+
+    _timer->fn = NULL;
+    _timer->fnArg = _isr;
+    _timer->arg = _arg;
+}
+
+void timerDetachInterrupt(hw_timer_t *_timer)
+{
+    if (!_timer)
+        return;
+
+    _timer->fn = NULL;
+    _timer->fnArg = NULL;
+    _timer->pending = false;
+}
+
+void timerAlarm(hw_timer_t *_timer, uint64_t _alarmValue, bool _autoreload, uint64_t _reloadCount)
+{
+    (void)_reloadCount;
+    if (!_timer)
+        return;
+
+    // Counter restarts from 0, the alarm comes after _alarmValue counts.
+    RfidHost::cancelEvents(_timer);
+    _timer->period = _alarmValue * RfidHost::CPU_MHZ * 1000000ULL / _timer->frequency;
+    if (!_timer->period)
+        _timer->period = 1;
+    _timer->next = RfidHost::cycles() + _timer->period;
+    _timer->autoreload = _autoreload;
+    RfidHost::schedule(_timer->next, timerEvent, _timer);
+}
+
+gpio_dev_t GPIO = {{0, true}, {0, false}, {{1, true}}, {{1, false}}};
+
+RfidHostGpioW1 &RfidHostGpioW1::operator=(uint32_t _mask)
+{
+    if (set)
+        gpioOut[port] |= _mask;
+    else
+        gpioOut[port] &= ~_mask;
+
+    return *this;
+}
+
+volatile uint32_t *portInputRegister(uint8_t _port)
+{
+    return &gpioIn[_port < PORTS ? _port : 0];
+}
+
+volatile uint32_t *portOutputRegister(uint8_t _port)
+{
+    return &gpioOut[_port < PORTS ? _port : 0];
+}
+
+bool psramFound()
+{
+    return false;
+}
+
+size_t HardwareSerial::write(uint8_t _c)
+{
+    return fwrite(&_c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t *_buffer, size_t _size)
+{
+    return fwrite(_buffer, 1, _size, stdout);
+}
@@ -0,0 +1,162 @@
+/**
+ **************************************************
+ *
+ * @file        Arduino.h
+ * @brief       Arduino core for the virtual ESP32 used to build the library on Linux. Time comes from the virtual
+ *              clock, GPIO from the virtual pins (see RfidHost.h) and the tasks from freertos/task.h.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST_ARDUINO__
+#define __RFID_HOST_ARDUINO__
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "Print.h"
+#include "RfidHost.h"
+#include "Stream.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+using std::max;
+using std::min;
+
+// Pin levels, modes and interrupt modes (values of the ESP32 core).
+#define LOW            0x0
+#define HIGH           0x1
+#define INPUT          0x01
+#define OUTPUT         0x03
+#define PULLUP         0x04
+#define INPUT_PULLUP   0x05
+#define PULLDOWN       0x08
+#define INPUT_PULLDOWN 0x09
+#define RISING         0x01
+#define FALLING        0x02
+#define CHANGE         0x03
+#define ONLOW          0x04
+#define ONHIGH         0x05
+
+#define NOT_AN_INTERRUPT -1
+
+// Flash is memory mapped on the ESP32.
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s)    (s)
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#define bitRead(value, bit)  (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)   ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// Time (virtual clock).
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t _ms);
+void delayMicroseconds(uint32_t _us);
+void yield();
+void optimistic_yield(uint32_t _intervalUs);
+
+// GPIO (virtual pins).
+void pinMode(uint8_t _pin, uint8_t _mode);
+void digitalWrite(uint8_t _pin, uint8_t _level);
+int digitalRead(uint8_t _pin);
+void attachInterrupt(uint8_t _pin, void (*_isr)(void), int _mode);
+void attachInterruptArg(uint8_t _pin, void (*_isr)(void *), void *_arg, int _mode);
+void detachInterrupt(uint8_t _pin);
+void noInterrupts();
+void interrupts();
+
+#define digitalPinToInterrupt(p) ((p) < RfidHost::PINS ? (p) : NOT_AN_INTERRUPT)
+#define digitalPinToPort(p)      ((p) / 32)
+#define digitalPinToBitMask(p)   (1UL << ((p) % 32))
+volatile uint32_t *portInputRegister(uint8_t _port);
+volatile uint32_t *portOutputRegister(uint8_t _port);
+
+// Version of the Arduino-ESP32 core the shim follows (the hardware timer API below is the one of the 3.x core).
+#define ESP_ARDUINO_VERSION_MAJOR 3
+
+// Hardware timers (up to 4), counting at the frequency given to timerBegin(). The alarm callback runs as an ISR.
+typedef struct hw_timer_s hw_timer_t;
+hw_timer_t *timerBegin(uint32_t _frequency);
+void timerEnd(hw_timer_t *_timer);
+void timerAttachInterrupt(hw_timer_t *_timer, void (*_isr)(void));
+void timerAttachInterruptArg(hw_timer_t *_timer, void (*_isr)(void *), void *_arg);
+void timerDetachInterrupt(hw_timer_t *_timer);
+void timerAlarm(hw_timer_t *_timer, uint64_t _alarmValue, bool _autoreload, uint64_t _reloadCount);
+
+// FreeRTOS critical sections, they hold the virtual interrupts back.
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define taskENTER_CRITICAL(mux) noInterrupts()
+#define taskEXIT_CRITICAL(mux)  interrupts()
+
+bool psramFound();
+
+// ESP32 specific functions.
+class EspClass
+{
+  public:
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz()
+    {
+        return RfidHost::CPU_MHZ;
+    }
+    uint32_t getFreeHeap()
+    {
+        return 0;
+    }
+};
+extern EspClass ESP;
+
+// Serial is the standard output.
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long _baud)
+    {
+        (void)_baud;
+    }
+    void end()
+    {
+    }
+    int available()
+    {
+        return 0;
+    }
+    int read()
+    {
+        return -1;
+    }
+    int peek()
+    {
+        return -1;
+    }
+    size_t write(uint8_t _c);
+    size_t write(const uint8_t *_buffer, size_t _size);
+    using Print::write;
+    operator bool() const
+    {
+        return true;
+    }
+};
+extern HardwareSerial Serial;
+
+#endif
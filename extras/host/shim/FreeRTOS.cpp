@@ -0,0 +1,320 @@
+/**
+ **************************************************
+ *
+ * @file        FreeRTOS.cpp
+ * @brief       FreeRTOS tasks of the virtual ESP32. Tasks are threads that hand the CPU over to each other, so only
+ *              one of them runs at a time and the virtual clock stays single threaded.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "Arduino.h"
+#include "freertos/task.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct tskTaskControlBlock
+{
+    TaskFunction_t fn;
+    void *arg;
+    UBaseType_t priority;
+    BaseType_t core;
+    std::thread thread;
+
+    // Task that gave the CPU to this one, it gets the CPU back when this one blocks.
+    tskTaskControlBlock *resumer;
+
+    uint32_t notifications;
+
+    // Waiting for its wake event (vTaskDelay(), ulTaskNotifyTake() or not started yet), and waiting for a notification.
+    bool blocked;
+    bool waitingNotify;
+
+    // Asked to exit by vTaskDelete(), and returned from the task function.
+    bool deleted;
+    bool finished;
+};
+
+namespace
+{
+// Thrown in the task to unwind it when it's deleted.
+struct TaskExit
+{
+};
+
+const uint64_t TICK_CYCLES = (uint64_t)RfidHost::CPU_MHZ * 1000 * portTICK_PERIOD_MS;
+
+// Arduino loop task, the main thread.
+tskTaskControlBlock loopTask = {NULL, NULL, 1, 1, std::thread(), NULL, 0, false, false, false, false};
+
+// Task that has the CPU, and the task of the calling thread.
+std::mutex cpuLock;
+std::condition_variable cpuChange;
+tskTaskControlBlock *running = &loopTask;
+thread_local tskTaskControlBlock *self = &loopTask;
+
+std::vector<tskTaskControlBlock *> tasks;
+
+// Waits for the task that finished to end its thread and frees it.
+void reap(tskTaskControlBlock *_task)
+{
+    _task->thread.join();
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        if (tasks[i] == _task)
+        {
+            tasks.erase(tasks.begin() + i);
+            break;
+        }
+    }
+    delete _task;
+}
+
+// Gives the CPU to the task and waits until it blocks or ends.
+void switchTo(tskTaskControlBlock *_task)
+{
+    tskTaskControlBlock *_self = self;
+    {
+        std::unique_lock<std::mutex> _lock(cpuLock);
+        _task->resumer = _self;
+        running = _task;
+        cpuChange.notify_all();
+        cpuChange.wait(_lock, [_self] { return running == _self; });
+    }
+
+    if (_task->finished)
+        reap(_task);
+
+    // Deleted by the task it ran.
+    if (_self->deleted)
+        throw TaskExit();
+}
+
+// Gives the CPU back to the task that ran the calling task and waits to be run again.
+void block()
+{
+    tskTaskControlBlock *_self = self;
+    {
+        std::unique_lock<std::mutex> _lock(cpuLock);
+        _self->blocked = true;
+        running = _self->resumer;
+        cpuChange.notify_all();
+        cpuChange.wait(_lock, [_self] { return running == _self; });
+        _self->blocked = false;
+    }
+
+    if (_self->deleted)
+        throw TaskExit();
+}
+
+// Clock event that runs the blocked task. Tasks don't switch while an ISR runs (the clock also moves inside the ISRs
+// that busy wait), the task runs a little later.
+void wakeEvent(void *_ctx)
+{
+    tskTaskControlBlock *_task = (tskTaskControlBlock *)_ctx;
+    if (!_task->blocked || _task->finished)
+        return;
+
+    if (RfidHost::isrContext())
+        RfidHost::schedule(RfidHost::cycles() + RfidHost::ISR_LATENCY, wakeEvent, _task);
+    else
+        switchTo(_task);
+}
+
+void taskMain(tskTaskControlBlock *_task)
+{
+    self = _task;
+    {
+        std::unique_lock<std::mutex> _lock(cpuLock);
+        cpuChange.wait(_lock, [_task] { return running == _task; });
+        _task->blocked = false;
+    }
+
+    try
+    {
+        if (!_task->deleted)
+            _task->fn(_task->arg);
+    }
+    catch (TaskExit &)
+    {
+    }
+
+    // FreeRTOS task must not return from its function, here it ends the task like vTaskDelete(NULL).
+    std::unique_lock<std::mutex> _lock(cpuLock);
+    _task->finished = true;
+    running = _task->resumer;
+    cpuChange.notify_all();
+}
+} // namespace
+
+namespace RfidHost
+{
+void deleteTasks()
+{
+    std::vector<tskTaskControlBlock *> _tasks = tasks;
+    for (size_t i = _tasks.size(); i > 0; i--)
+        vTaskDelete(_tasks[i - 1]);
+
+    loopTask.notifications = 0;
+}
+
+size_t taskCount()
+{
+    return tasks.size();
+}
+
+bool inTask()
+{
+    return self != &loopTask;
+}
+} // namespace RfidHost
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t _fn, const char *_name, uint32_t _stackDepth, void *_arg,
+                                   UBaseType_t _priority, TaskHandle_t *_handle, BaseType_t _core)
+{
+    (void)_name;
+    (void)_stackDepth;
+
+    if (!_fn || _priority >= configMAX_PRIORITIES)
+        return pdFAIL;
+
+    tskTaskControlBlock *_task = new tskTaskControlBlock();
+    _task->fn = _fn;
+    _task->arg = _arg;
+    _task->priority = _priority;
+    _task->core = _core;
+    _task->blocked = true;
+    tasks.push_back(_task);
+    _task->thread = std::thread(taskMain, _task);
+
+    if (_handle)
+        *_handle = _task;
+
+    // Task starts when the clock moves next.
+    RfidHost::schedule(RfidHost::cycles(), wakeEvent, _task);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t _fn, const char *_name, uint32_t _stackDepth, void *_arg,
+                       UBaseType_t _priority, TaskHandle_t *_handle)
+{
+    return xTaskCreatePinnedToCore(_fn, _name, _stackDepth, _arg, _priority, _handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t _task)
+{
+    if (!_task)
+        _task = self;
+
+    // Loop task can't be deleted.
+    if (_task == &loopTask)
+        return;
+
+    _task->deleted = true;
+    if (_task == self)
+        throw TaskExit();
+
+    RfidHost::cancelEvents(_task);
+
+    // Task that is not blocked is waiting for a task it ran, it exits when it gets the CPU back.
+    if (_task->blocked)
+        switchTo(_task);
+}
+
+void vTaskDelay(TickType_t _ticks)
+{
+    if (self == &loopTask)
+    {
+        RfidHost::advance((uint64_t)_ticks * TICK_CYCLES);
+        return;
+    }
+
+    RfidHost::schedule(RfidHost::cycles() + (uint64_t)_ticks * TICK_CYCLES, wakeEvent, self);
+    block();
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(RfidHost::cycles() / TICK_CYCLES);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return self;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t _task)
+{
+    return _task ? _task->priority : self->priority;
+}
+
+BaseType_t xPortGetCoreID()
+{
+    return self->core == tskNO_AFFINITY ? 0 : self->core;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t _task)
+{
+    _task->notifications++;
+
+    // Waiting task runs when the clock moves next.
+    if (_task->waitingNotify && _task->blocked)
+    {
+        _task->waitingNotify = false;
+        RfidHost::cancelEvents(_task);
+        RfidHost::schedule(RfidHost::cycles(), wakeEvent, _task);
+    }
+
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t _task, BaseType_t *_woken)
+{
+    xTaskNotifyGive(_task);
+    if (_woken)
+        *_woken = pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t _clear, TickType_t _ticks)
+{
+    tskTaskControlBlock *_self = self;
+
+    if (!_self->notifications && _ticks)
+    {
+        if (_self == &loopTask)
+        {
+            // Loop task moves the clock until it's notified (the other tasks run on the way), or until nothing is
+            // left that could notify it (the rest of the timeout then just passes).
+            uint64_t _end = _ticks == portMAX_DELAY ? 0 : RfidHost::cycles() + (uint64_t)_ticks * TICK_CYCLES;
+            while (!_self->notifications && (!_end || RfidHost::cycles() < _end) && RfidHost::pendingEvents())
+            {
+                uint64_t _step = TICK_CYCLES;
+                if (_end && _end - RfidHost::cycles() < _step)
+                    _step = _end - RfidHost::cycles();
+                RfidHost::advance(_step);
+            }
+            if (!_self->notifications && _end && RfidHost::cycles() < _end)
+                RfidHost::advance(_end - RfidHost::cycles());
+        }
+        else
+        {
+            _self->waitingNotify = true;
+            if (_ticks != portMAX_DELAY)
+                RfidHost::schedule(RfidHost::cycles() + (uint64_t)_ticks * TICK_CYCLES, wakeEvent, _self);
+            block();
+            _self->waitingNotify = false;
+            RfidHost::cancelEvents(_self);
+        }
+    }
+
+    uint32_t _count = _self->notifications;
+    if (_count)
+        _self->notifications = _clear ? 0 : _count - 1;
+
+    return _count;
+}
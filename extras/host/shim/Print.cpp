@@ -0,0 +1,192 @@
+/**
+ **************************************************
+ *
+ * @file        Print.cpp
+ * @brief       Arduino Print and Stream functions for the virtual ESP32.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "Arduino.h"
+
+#include <stdarg.h>
+
+size_t Print::write(const uint8_t *_buffer, size_t _size)
+{
+    size_t _n = 0;
+    while (_size--)
+    {
+        if (!write(*_buffer++))
+            break;
+        _n++;
+    }
+    return _n;
+}
+
+size_t Print::print(const char *_str)
+{
+    return write(_str);
+}
+
+size_t Print::print(char _c)
+{
+    return write((uint8_t)_c);
+}
+
+size_t Print::print(unsigned char _n, int _base)
+{
+    return print((unsigned long long)_n, _base);
+}
+
+size_t Print::print(int _n, int _base)
+{
+    return print((long long)_n, _base);
+}
+
+size_t Print::print(unsigned int _n, int _base)
+{
+    return print((unsigned long long)_n, _base);
+}
+
+size_t Print::print(long _n, int _base)
+{
+    return print((long long)_n, _base);
+}
+
+size_t Print::print(unsigned long _n, int _base)
+{
+    return print((unsigned long long)_n, _base);
+}
+
+size_t Print::print(long long _n, int _base)
+{
+    // Like the Arduino core, only the decimal numbers get the sign.
+    if (_base == DEC && _n < 0)
+        return print('-') + printNumber(-(unsigned long long)_n, DEC);
+
+    return printNumber((unsigned long long)_n, _base);
+}
+
+size_t Print::print(unsigned long long _n, int _base)
+{
+    return printNumber(_n, _base);
+}
+
+size_t Print::print(double _n, int _digits)
+{
+    char _buffer[64];
+    int _length = snprintf(_buffer, sizeof(_buffer), "%.*f", _digits, _n);
+    return _length > 0 ? write((const uint8_t *)_buffer, strlen(_buffer)) : 0;
+}
+
+size_t Print::println()
+{
+    return write("\r\n");
+}
+
+size_t Print::printf(const char *_format, ...)
+{
+    char _buffer[256];
+    va_list _args;
+    va_start(_args, _format);
+    int _length = vsnprintf(_buffer, sizeof(_buffer), _format, _args);
+    va_end(_args);
+
+    return _length > 0 ? write((const uint8_t *)_buffer, strlen(_buffer)) : 0;
+}
+
+size_t Print::printNumber(unsigned long long _n, uint8_t _base)
+{
+    char _buffer[8 * sizeof(_n) + 1];
+    char *_str = &_buffer[sizeof(_buffer) - 1];
+    *_str = '\0';
+
+    if (_base < 2)
+        _base = 10;
+
+    do
+    {
+        char _digit = _n % _base;
+        _n /= _base;
+        *--_str = _digit < 10 ? _digit + '0' : _digit + 'A' - 10;
+    } while (_n);
+
+    return write(_str);
+}
+
+bool Stream::find(const char *_target)
+{
+    size_t _length = strlen(_target);
+    size_t _index = 0;
+    if (!_length)
+        return true;
+
+    int _c;
+    while ((_c = timedRead()) >= 0)
+    {
+        if (_c == _target[_index])
+        {
+            if (++_index == _length)
+                return true;
+        }
+        else
+        {
+            _index = _c == _target[0] ? 1 : 0;
+        }
+    }
+    return false;
+}
+
+size_t Stream::readBytes(char *_buffer, size_t _length)
+{
+    size_t _count = 0;
+    while (_count < _length)
+    {
+        int _c = timedRead();
+        if (_c < 0)
+            break;
+        *_buffer++ = (char)_c;
+        _count++;
+    }
+    return _count;
+}
+
+size_t Stream::readBytesUntil(char _terminator, char *_buffer, size_t _length)
+{
+    size_t _count = 0;
+    while (_count < _length)
+    {
+        int _c = timedRead();
+        if (_c < 0 || _c == _terminator)
+            break;
+        *_buffer++ = (char)_c;
+        _count++;
+    }
+    return _count;
+}
+
+int Stream::timedRead()
+{
+    _startMillis = millis();
+    do
+    {
+        int _c = read();
+        if (_c >= 0)
+            return _c;
+    } while (millis() - _startMillis < _timeout);
+    return -1;
+}
+
+int Stream::timedPeek()
+{
+    _startMillis = millis();
+    do
+    {
+        int _c = peek();
+        if (_c >= 0)
+            return _c;
+    } while (millis() - _startMillis < _timeout);
+    return -1;
+}
@@ -0,0 +1,78 @@
+/**
+ **************************************************
+ *
+ * @file        Print.h
+ * @brief       Arduino Print class for the virtual ESP32.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST_PRINT__
+#define __RFID_HOST_PRINT__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print
+{
+  public:
+    virtual ~Print()
+    {
+    }
+
+    virtual size_t write(uint8_t _c) = 0;
+    virtual size_t write(const uint8_t *_buffer, size_t _size);
+    size_t write(const char *_str)
+    {
+        return _str ? write((const uint8_t *)_str, strlen(_str)) : 0;
+    }
+    size_t write(const char *_buffer, size_t _size)
+    {
+        return write((const uint8_t *)_buffer, _size);
+    }
+    virtual int availableForWrite()
+    {
+        return 0;
+    }
+    virtual void flush()
+    {
+    }
+
+    size_t print(const char *_str);
+    size_t print(char _c);
+    size_t print(unsigned char _n, int _base = DEC);
+    size_t print(int _n, int _base = DEC);
+    size_t print(unsigned int _n, int _base = DEC);
+    size_t print(long _n, int _base = DEC);
+    size_t print(unsigned long _n, int _base = DEC);
+    size_t print(long long _n, int _base = DEC);
+    size_t print(unsigned long long _n, int _base = DEC);
+    size_t print(double _n, int _digits = 2);
+
+    size_t println();
+    template <typename T> size_t println(T _value)
+    {
+        size_t _n = print(_value);
+        return _n + println();
+    }
+    template <typename T> size_t println(T _value, int _format)
+    {
+        size_t _n = print(_value, _format);
+        return _n + println();
+    }
+
+    size_t printf(const char *_format, ...) __attribute__((format(printf, 2, 3)));
+
+  private:
+    size_t printNumber(unsigned long long _n, uint8_t _base);
+};
+
+#endif
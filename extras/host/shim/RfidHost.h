@@ -0,0 +1,95 @@
+/**
+ **************************************************
+ *
+ * @file        RfidHost.h
+ * @brief       Control of the virtual ESP32 used to run the library on Linux: virtual clock, scheduled events,
+ *              GPIO pins and their interrupts.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST__
+#define __RFID_HOST__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace RfidHost
+{
+// Clock of the virtual CPU (ESP.getCycleCount() counts these cycles).
+const uint32_t CPU_MHZ = 240;
+
+// Default delay from the pin edge to the ISR call in cycles (about 2 us through the ESP32 GPIO interrupt dispatch).
+const uint32_t ISR_LATENCY = 480;
+
+// Number of GPIO pins.
+const uint8_t PINS = 64;
+
+// Event run by the clock when its time comes.
+typedef void (*EventFn)(void *_ctx);
+
+// Called when an output pin changes (by digitalWrite() or by writing the GPIO output register).
+typedef void (*PinWatcher)(uint8_t _pin, bool _level, uint64_t _cycle, void *_ctx);
+
+// Puts the virtual ESP32 into the power-on state: time 0, all pins low inputs, no tasks, no events, no interrupts,
+// default read costs and ISR latency.
+void reset();
+
+// Current time in cycles, without moving the clock.
+uint64_t cycles();
+
+// Moves the clock, running all events that come due on the way.
+void advance(uint64_t _cycles);
+void advanceMicros(uint64_t _us);
+
+// Runs the events until the time, or until there are no more events if _cycle is 0.
+void runUntil(uint64_t _cycle);
+
+// Cycles added by each read of the time, so the busy waits of the library make progress: by millis() and micros()
+// (default 240, 1 us) and by ESP.getCycleCount() (default 24, the bit timing of the software serial depends on it).
+void setReadCost(uint32_t _timeCycles, uint32_t _cycleCountCycles = 24);
+
+// Schedules the event at the absolute time in cycles.
+void schedule(uint64_t _cycle, EventFn _fn, void *_ctx);
+
+// Removes the scheduled events with the context (call it before the object used as the context goes away).
+void cancelEvents(void *_ctx);
+
+// Number of scheduled events that did not run yet.
+size_t pendingEvents();
+
+// Drives the input pin, runs its interrupt if the edge matches (after the ISR latency).
+void setPin(uint8_t _pin, bool _level);
+
+// Level of the pin as seen by digitalRead().
+bool getPin(uint8_t _pin);
+
+// Sets the range of the delay from the pin edge to the ISR call, in cycles. Each interrupt gets a random delay from
+// the range. Default is ISR_LATENCY.
+void setIsrLatency(uint32_t _minCycles, uint32_t _maxCycles, uint32_t _seed = 1);
+
+// Number of ISR calls and the cycles spent in them since the reset (the time the ISRs moved the clock, by busy
+// waiting or reading the time).
+uint32_t isrCalls();
+uint64_t isrCycles();
+
+// Adds the watcher of the output pins (up to 8 watchers).
+void watchPins(PinWatcher _fn, void *_ctx);
+void unwatchPins(PinWatcher _fn, void *_ctx);
+
+// Deletes all the FreeRTOS tasks (reset() does it too), the number of tasks, and true if called from a task (not from
+// the loop task, the main thread). See freertos/task.h.
+void deleteTasks();
+size_t taskCount();
+bool inTask();
+
+// True while an ISR runs or the interrupts are disabled, the tasks don't switch then.
+bool isrContext();
+
+// Adds the in-memory flash data partition found by esp_partition_find_first() (up to 4 partitions).
+void addPartition(const char *_label, uint32_t _size);
+} // namespace RfidHost
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ **************************************************
+ *
+ * @file        Stream.h
+ * @brief       Arduino Stream class for the virtual ESP32.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST_STREAM__
+#define __RFID_HOST_STREAM__
+
+#include "Print.h"
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long _ms)
+    {
+        _timeout = _ms;
+    }
+    unsigned long getTimeout()
+    {
+        return _timeout;
+    }
+
+    bool find(const char *_target);
+    virtual size_t readBytes(char *_buffer, size_t _length);
+    virtual size_t readBytes(uint8_t *_buffer, size_t _length)
+    {
+        return readBytes((char *)_buffer, _length);
+    }
+    size_t readBytesUntil(char _terminator, char *_buffer, size_t _length);
+
+  protected:
+    int timedRead();
+    int timedPeek();
+
+    // Names used by the Arduino cores (ESPSoftwareSerial uses them).
+    unsigned long _timeout = 1000;
+    unsigned long _startMillis = 0;
+};
+
+#endif
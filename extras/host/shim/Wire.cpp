@@ -0,0 +1,173 @@
+/**
+ **************************************************
+ *
+ * @file        Wire.cpp
+ * @brief       Arduino I2C (Wire) functions for the virtual ESP32.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "Wire.h"
+
+TwoWire Wire;
+
+bool TwoWire::begin()
+{
+    return true;
+}
+
+bool TwoWire::begin(int _sda, int _scl, uint32_t _frequency)
+{
+    (void)_sda;
+    (void)_scl;
+    if (_frequency)
+        clockHz = _frequency;
+    return true;
+}
+
+void TwoWire::end()
+{
+}
+
+void TwoWire::setClock(uint32_t _frequency)
+{
+    if (_frequency)
+        clockHz = _frequency;
+}
+
+uint32_t TwoWire::getClock()
+{
+    return clockHz;
+}
+
+void TwoWire::beginTransmission(int _address)
+{
+    txAddress = (uint8_t)_address;
+    txLength = 0;
+    transmitting = true;
+}
+
+/**
+ * @brief                   Sends the buffered bytes to the device.
+ *
+ * @return                  uint8_t - 0 on success, 2 for the address NACK, 3 for the data NACK (same as the core).
+ */
+uint8_t TwoWire::endTransmission(bool _sendStop)
+{
+    (void)_sendStop;
+    transmitting = false;
+    transactionCount++;
+    busTime(1 + txLength);
+
+    for (uint8_t i = 0; i < RFID_HOST_I2C_DEVICES; i++)
+    {
+        uint8_t _error = 0;
+        if (devices[i] && devices[i]->i2cWrite(txAddress, txBuffer, txLength, &_error))
+            return _error;
+    }
+    return 2;
+}
+
+uint8_t TwoWire::requestFrom(int _address, int _quantity, int _sendStop)
+{
+    (void)_sendStop;
+    if (_quantity > I2C_BUFFER_LENGTH)
+        _quantity = I2C_BUFFER_LENGTH;
+    if (_quantity < 0)
+        _quantity = 0;
+
+    transactionCount++;
+    busTime(1 + _quantity);
+
+    rxIndex = 0;
+    rxLength = 0;
+    for (uint8_t i = 0; i < RFID_HOST_I2C_DEVICES; i++)
+    {
+        if (devices[i] && devices[i]->i2cRead((uint8_t)_address, rxBuffer, _quantity))
+        {
+            rxLength = _quantity;
+            break;
+        }
+    }
+    return (uint8_t)rxLength;
+}
+
+size_t TwoWire::write(uint8_t _c)
+{
+    if (!transmitting || txLength >= I2C_BUFFER_LENGTH)
+        return 0;
+
+    txBuffer[txLength++] = _c;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *_buffer, size_t _size)
+{
+    size_t _n = 0;
+    while (_n < _size && write(_buffer[_n]))
+        _n++;
+    return _n;
+}
+
+int TwoWire::available()
+{
+    return (int)(rxLength - rxIndex);
+}
+
+int TwoWire::read()
+{
+    return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
+
+int TwoWire::peek()
+{
+    return rxIndex < rxLength ? rxBuffer[rxIndex] : -1;
+}
+
+void TwoWire::flush()
+{
+    rxIndex = 0;
+    rxLength = 0;
+    txLength = 0;
+}
+
+void TwoWire::attach(TwoWireDevice *_device)
+{
+    for (uint8_t i = 0; i < RFID_HOST_I2C_DEVICES; i++)
+    {
+        if (!devices[i])
+        {
+            devices[i] = _device;
+            return;
+        }
+    }
+}
+
+void TwoWire::detach(TwoWireDevice *_device)
+{
+    for (uint8_t i = 0; i < RFID_HOST_I2C_DEVICES; i++)
+    {
+        if (devices[i] == _device)
+            devices[i] = NULL;
+    }
+}
+
+uint32_t TwoWire::transactions()
+{
+    return transactionCount;
+}
+
+/**
+ * @brief                   Moves the virtual clock by the time the transaction takes on the bus (9 clocks per byte
+ *                          with the ACK, plus the start and the stop condition).
+ *
+ * @param                   size_t _bytes
+ *                          Number of bytes, with the address byte.
+ */
+void TwoWire::busTime(size_t _bytes)
+{
+    uint64_t _clocks = _bytes * 9 + 2;
+    RfidHost::advance(_clocks * RfidHost::CPU_MHZ * 1000000ULL / clockHz);
+}
@@ -0,0 +1,86 @@
+/**
+ **************************************************
+ *
+ * @file        Wire.h
+ * @brief       Arduino I2C (Wire) for the virtual ESP32. Transactions go to the attached virtual devices and take
+ *              the bus time on the virtual clock.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST_WIRE__
+#define __RFID_HOST_WIRE__
+
+#include "Arduino.h"
+
+// Size of the transmit and receive buffers (same as the ESP32 core).
+#define I2C_BUFFER_LENGTH 128
+
+// Number of devices that can be attached to the bus.
+#define RFID_HOST_I2C_DEVICES 8
+
+/**
+ * Virtual I2C device. Each device checks the address and ignores the transactions that are not for it.
+ */
+class TwoWireDevice
+{
+  public:
+    virtual ~TwoWireDevice()
+    {
+    }
+
+    // Handles the write transaction. Returns true if the device ACKed the address, *_error is set for the data NACK.
+    virtual bool i2cWrite(uint8_t _address, const uint8_t *_data, size_t _n, uint8_t *_error) = 0;
+
+    // Handles the read transaction. Returns true if the device ACKed the address and fills _data with _n bytes.
+    virtual bool i2cRead(uint8_t _address, uint8_t *_data, size_t _n) = 0;
+};
+
+class TwoWire : public Stream
+{
+  public:
+    bool begin();
+    bool begin(int _sda, int _scl, uint32_t _frequency = 0);
+    void end();
+    void setClock(uint32_t _frequency);
+    uint32_t getClock();
+
+    void beginTransmission(int _address);
+    uint8_t endTransmission(bool _sendStop = true);
+    uint8_t requestFrom(int _address, int _quantity, int _sendStop = 1);
+
+    size_t write(uint8_t _c);
+    size_t write(const uint8_t *_buffer, size_t _size);
+    using Print::write;
+    int available();
+    int read();
+    int peek();
+    void flush();
+
+    // Virtual bus.
+    void attach(TwoWireDevice *_device);
+    void detach(TwoWireDevice *_device);
+    uint32_t transactions();
+
+  private:
+    void busTime(size_t _bytes);
+
+    TwoWireDevice *devices[RFID_HOST_I2C_DEVICES] = {};
+    uint32_t clockHz = 100000;
+    uint32_t transactionCount = 0;
+
+    uint8_t txAddress = 0;
+    uint8_t txBuffer[I2C_BUFFER_LENGTH];
+    size_t txLength = 0;
+    bool transmitting = false;
+
+    uint8_t rxBuffer[I2C_BUFFER_LENGTH];
+    size_t rxLength = 0;
+    size_t rxIndex = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ **************************************************
+ *
+ * @file        esp_attr.h
+ * @brief       ESP-IDF attributes for the virtual ESP32 (they have no effect on Linux).
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST_ESP_ATTR__
+#define __RFID_HOST_ESP_ATTR__
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+
+#endif
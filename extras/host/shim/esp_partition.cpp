@@ -0,0 +1,113 @@
+/**
+ **************************************************
+ *
+ * @file        esp_partition.cpp
+ * @brief       In-memory flash partitions of the virtual ESP32.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "esp_partition.h"
+#include "RfidHost.h"
+
+#include <string.h>
+
+#include <vector>
+
+namespace
+{
+const uint8_t MAX_PARTITIONS = 4;
+
+// Flash contents live on, RfidHost::reset() does not clear them (like a power cycle).
+esp_partition_t partitions[MAX_PARTITIONS];
+std::vector<uint8_t> contents[MAX_PARTITIONS];
+uint8_t partitionCount = 0;
+uint32_t nextAddress = 0x110000;
+
+std::vector<uint8_t> *dataOf(const esp_partition_t *_partition, size_t _offset, size_t _size)
+{
+    if (!_partition || _partition < partitions || _partition >= partitions + partitionCount)
+        return NULL;
+    if (_offset > _partition->size || _size > _partition->size - _offset)
+        return NULL;
+
+    return &contents[_partition - partitions];
+}
+} // namespace
+
+namespace RfidHost
+{
+void addPartition(const char *_label, uint32_t _size)
+{
+    if (partitionCount >= MAX_PARTITIONS)
+        return;
+
+    esp_partition_t *_partition = &partitions[partitionCount];
+    _partition->type = ESP_PARTITION_TYPE_DATA;
+    _partition->subtype = ESP_PARTITION_SUBTYPE_ANY;
+    _partition->address = nextAddress;
+    _partition->size = _size;
+    _partition->encrypted = false;
+    strncpy(_partition->label, _label, sizeof(_partition->label) - 1);
+    _partition->label[sizeof(_partition->label) - 1] = '\0';
+
+    // New flash comes erased.
+    contents[partitionCount].assign(_size, 0xFF);
+    nextAddress += (_size + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+    partitionCount++;
+}
+} // namespace RfidHost
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t _type, esp_partition_subtype_t _subtype,
+                                                const char *_label)
+{
+    for (uint8_t i = 0; i < partitionCount; i++)
+    {
+        if (partitions[i].type != _type)
+            continue;
+        if (_subtype != ESP_PARTITION_SUBTYPE_ANY && partitions[i].subtype != _subtype)
+            continue;
+        if (_label && strcmp(partitions[i].label, _label))
+            continue;
+
+        return &partitions[i];
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *_partition, size_t _offset, void *_dst, size_t _size)
+{
+    std::vector<uint8_t> *_data = dataOf(_partition, _offset, _size);
+    if (!_data || !_dst)
+        return ESP_ERR_INVALID_ARG;
+
+    memcpy(_dst, _data->data() + _offset, _size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *_partition, size_t _offset, const void *_src, size_t _size)
+{
+    std::vector<uint8_t> *_data = dataOf(_partition, _offset, _size);
+    if (!_data || !_src)
+        return ESP_ERR_INVALID_ARG;
+
+    // NOR flash can only clear the bits.
+    const uint8_t *_bytes = (const uint8_t *)_src;
+    for (size_t i = 0; i < _size; i++)
+        (*_data)[_offset + i] &= _bytes[i];
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *_partition, size_t _offset, size_t _size)
+{
+    std::vector<uint8_t> *_data = dataOf(_partition, _offset, _size);
+    if (!_data)
+        return ESP_ERR_INVALID_ARG;
+    if (_offset % SPI_FLASH_SEC_SIZE || _size % SPI_FLASH_SEC_SIZE)
+        return ESP_ERR_INVALID_SIZE;
+
+    memset(_data->data() + _offset, 0xFF, _size);
+    return ESP_OK;
+}
@@ -0,0 +1,54 @@
+/**
+ **************************************************
+ *
+ * @file        esp_partition.h
+ * @brief       ESP-IDF flash partitions for the virtual ESP32, kept in memory with the NOR flash behaviour (erase
+ *              sets the bits, write only clears them). Add them with RfidHost::addPartition().
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST_ESP_PARTITION__
+#define __RFID_HOST_ESP_PARTITION__
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK                0
+#define ESP_FAIL              -1
+#define ESP_ERR_INVALID_ARG   0x102
+#define ESP_ERR_INVALID_SIZE  0x104
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum
+{
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct
+{
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t _type, esp_partition_subtype_t _subtype,
+                                                const char *_label);
+esp_err_t esp_partition_read(const esp_partition_t *_partition, size_t _offset, void *_dst, size_t _size);
+esp_err_t esp_partition_write(const esp_partition_t *_partition, size_t _offset, const void *_src, size_t _size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *_partition, size_t _offset, size_t _size);
+
+#endif
@@ -0,0 +1,36 @@
+/**
+ **************************************************
+ *
+ * @file        FreeRTOS.h
+ * @brief       FreeRTOS types and constants of the virtual ESP32 (see task.h for the tasks).
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST_FREERTOS__
+#define __RFID_HOST_FREERTOS__
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+// Tick is 1 ms, like in the ESP32 Arduino core.
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms) / portTICK_PERIOD_MS)
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFUL)
+#define configMAX_PRIORITIES 25
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  0
+#define pdPASS  1
+
+// Tasks switch only when they block, so there is nothing to yield to from an ISR.
+#define portYIELD_FROM_ISR(...)
+
+#endif
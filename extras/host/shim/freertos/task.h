@@ -0,0 +1,42 @@
+/**
+ **************************************************
+ *
+ * @file        task.h
+ * @brief       FreeRTOS tasks of the virtual ESP32. Each task is a thread, but only one of the tasks (or the main
+ *              thread, the Arduino loop task) runs at a time, on the virtual clock: a task runs until it blocks
+ *              (vTaskDelay(), delay(), ulTaskNotifyTake()) and is woken by a clock event, so the runs are the same
+ *              each time. Both cores are one CPU here, the core given to xTaskCreatePinnedToCore() is only kept.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST_TASK__
+#define __RFID_HOST_TASK__
+
+#include "FreeRTOS.h"
+
+#include <stddef.h>
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t _fn, const char *_name, uint32_t _stackDepth, void *_arg,
+                                   UBaseType_t _priority, TaskHandle_t *_handle, BaseType_t _core);
+BaseType_t xTaskCreate(TaskFunction_t _fn, const char *_name, uint32_t _stackDepth, void *_arg,
+                       UBaseType_t _priority, TaskHandle_t *_handle);
+void vTaskDelete(TaskHandle_t _task);
+void vTaskDelay(TickType_t _ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskPriorityGet(TaskHandle_t _task);
+BaseType_t xPortGetCoreID();
+
+BaseType_t xTaskNotifyGive(TaskHandle_t _task);
+void vTaskNotifyGiveFromISR(TaskHandle_t _task, BaseType_t *_woken);
+uint32_t ulTaskNotifyTake(BaseType_t _clear, TickType_t _ticks);
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ **************************************************
+ *
+ * @file        gpio_struct.h
+ * @brief       ESP-IDF GPIO registers for the virtual ESP32. Only the write-1-to-set and write-1-to-clear output
+ *              registers are there, writing them changes the virtual output pins.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_HOST_GPIO_STRUCT__
+#define __RFID_HOST_GPIO_STRUCT__
+
+#include <stdint.h>
+
+// Number of the GPIO pins of the ESP32 (pins 32 and up are in the second output register).
+#define SOC_GPIO_PIN_COUNT 40
+
+// Write-only register, the pins of the port set in the written mask are set (or cleared), the others are left alone.
+struct RfidHostGpioW1
+{
+    uint8_t port;
+    bool set;
+    RfidHostGpioW1 &operator=(uint32_t _mask);
+};
+
+// Register of the pins 32 and up, written through val.
+struct RfidHostGpioW1Reg
+{
+    RfidHostGpioW1 val;
+};
+
+typedef struct
+{
+    RfidHostGpioW1 out_w1ts;
+    RfidHostGpioW1 out_w1tc;
+    RfidHostGpioW1Reg out1_w1ts;
+    RfidHostGpioW1Reg out1_w1tc;
+} gpio_dev_t;
+
+extern gpio_dev_t GPIO;
+
+#endif
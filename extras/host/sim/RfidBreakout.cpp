@@ -0,0 +1,627 @@
+/**
+ **************************************************
+ *
+ * @file        RfidBreakout.cpp
+ * @brief       Virtual Soldered 125kHz RFID breakout functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RfidBreakout.h"
+#include "RFID-EM4100.h"
+
+// UART baud rates selected by the DIP switches (switch 1 is bit 0).
+static const uint32_t breakoutBauds[8] = {9600, 2400, 4800, 19200, 38400, 57600, 115200, 230400};
+
+/**
+ * @brief                   Virtual breakout constructor. DIP switches are off (9600 baud, address 0x30), no latency,
+ *                          no faults.
+ */
+RfidBreakout::RfidBreakout()
+{
+    random.seed(1);
+}
+
+/**
+ * @brief                   Disconnects the breakout and cancels its scheduled events.
+ */
+RfidBreakout::~RfidBreakout()
+{
+    end();
+}
+
+/**
+ * @brief                   Sets the DIP switches, as printed on the board.
+ *
+ * @param                   uint8_t _switches
+ *                          Switch 1 is bit 0, switch 2 is bit 1 and switch 3 is bit 2 (1 is on).
+ */
+void RfidBreakout::setSwitches(uint8_t _switches)
+{
+    switches = _switches & 0x07;
+}
+
+/**
+ * @brief                   Gets the UART baud rate set by the DIP switches.
+ *
+ * @return                  uint32_t - Baud rate.
+ */
+uint32_t RfidBreakout::getBaud()
+{
+    return baudForSwitches(switches);
+}
+
+/**
+ * @brief                   Gets the easyC address set by the DIP switches.
+ *
+ * @return                  uint8_t - I2C address.
+ */
+uint8_t RfidBreakout::getAddress()
+{
+    return addressForSwitches(switches);
+}
+
+/**
+ * @brief                   Gets the UART baud rate for the DIP switches.
+ *
+ * @param                   uint8_t _switches
+ *                          DIP switches (see setSwitches()).
+ *
+ * @return                  uint32_t - Baud rate.
+ */
+uint32_t RfidBreakout::baudForSwitches(uint8_t _switches)
+{
+    return breakoutBauds[_switches & 0x07];
+}
+
+/**
+ * @brief                   Gets the easyC address for the DIP switches (switch 3 is the lowest address bit).
+ *
+ * @param                   uint8_t _switches
+ *                          DIP switches (see setSwitches()).
+ *
+ * @return                  uint8_t - I2C address.
+ */
+uint8_t RfidBreakout::addressForSwitches(uint8_t _switches)
+{
+    return RFID_BREAKOUT_ADDRESS | ((_switches & 1) << 2) | (_switches & 2) | ((_switches >> 2) & 1);
+}
+
+/**
+ * @brief                   Connects the breakout UART to the virtual pins.
+ *
+ * @param                   uint8_t _txPin
+ *                          Pin driven by the breakout TXD (the RX pin of the reader).
+ * @param                   uint8_t _rxPin
+ *                          Pin listened by the breakout RXD (the TX pin of the reader).
+ */
+void RfidBreakout::beginUart(uint8_t _txPin, uint8_t _rxPin)
+{
+    end();
+    mode = RFID_BREAKOUT_UART;
+    txPin = _txPin;
+    rxPin = _rxPin;
+
+    // UART line is idle high.
+    txLevel = true;
+    RfidHost::setPin(txPin, HIGH);
+    RfidHost::watchPins(watchRx, this);
+}
+
+/**
+ * @brief                   Uses the breakout as the Stream given to Rfid(Stream &).
+ */
+void RfidBreakout::beginStream()
+{
+    end();
+    mode = RFID_BREAKOUT_STREAM;
+}
+
+/**
+ * @brief                   Connects the breakout to the virtual I2C bus.
+ */
+void RfidBreakout::beginEasyC()
+{
+    end();
+    mode = RFID_BREAKOUT_EASYC;
+    Wire.attach(this);
+}
+
+/**
+ * @brief                   Disconnects the breakout. Tags and bytes not sent yet are dropped.
+ */
+void RfidBreakout::end()
+{
+    if (mode == RFID_BREAKOUT_UART)
+        RfidHost::unwatchPins(watchRx, this);
+    else if (mode == RFID_BREAKOUT_EASYC)
+        Wire.detach(this);
+
+    RfidHost::cancelEvents(this);
+    tags.clear();
+    pinChanges.clear();
+    streamBytes.clear();
+    rxEdges.clear();
+    rxLine.clear();
+    rxBusy = false;
+    txFreeCycle = 0;
+    clearTag();
+    mode = RFID_BREAKOUT_NONE;
+}
+
+/**
+ * @brief                   Sets the INT pin, high while there is a tag that was not read (cleared on easyC, sent on
+ *                          UART).
+ *
+ * @param                   uint8_t _pin
+ *                          Pin connected to the INT of the breakout.
+ */
+void RfidBreakout::setIntPin(uint8_t _pin)
+{
+    intPin = _pin;
+    RfidHost::setPin(intPin, LOW);
+}
+
+/**
+ * @brief                   Sets the time from the tag read (and from the ping) to the response.
+ *
+ * @param                   uint32_t _latencyUs
+ *                          Fixed latency in microseconds.
+ * @param                   uint32_t _jitterUs
+ *                          Random latency added to it, from 0 to _jitterUs microseconds.
+ */
+void RfidBreakout::setLatency(uint32_t _latencyUs, uint32_t _jitterUs)
+{
+    latencyUs = _latencyUs;
+    jitterUs = _jitterUs;
+}
+
+/**
+ * @brief                   Sets the fault rates.
+ *
+ * @param                   double _bitErrorRate
+ *                          Probability of a flipped UART bit (any bit on the pins, data bits on the Stream).
+ * @param                   double _byteDropRate
+ *                          Probability of a UART byte not being sent.
+ * @param                   double _nackRate
+ *                          Probability of an I2C transaction being NACKed.
+ */
+void RfidBreakout::setFaults(double _bitErrorRate, double _byteDropRate, double _nackRate)
+{
+    bitErrorRate = _bitErrorRate;
+    byteDropRate = _byteDropRate;
+    nackRate = _nackRate;
+}
+
+/**
+ * @brief                   Seeds the random generator used for the jitter and the faults.
+ *
+ * @param                   uint32_t _seed
+ *                          Seed, the same seed gives the same run.
+ */
+void RfidBreakout::setSeed(uint32_t _seed)
+{
+    random.seed(_seed);
+}
+
+/**
+ * @brief                   Adds the tag reads.
+ *
+ * @param                   uint64_t _inUs
+ *                          Time of the first read from now, in microseconds.
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ * @param                   uint8_t _version
+ *                          Version / customer byte of the EM4100 frame.
+ * @param                   uint32_t _count
+ *                          Number of reads (a tag held at the antenna is read again and again).
+ * @param                   uint32_t _periodUs
+ *                          Time between the reads in microseconds.
+ */
+void RfidBreakout::addTag(uint64_t _inUs, uint32_t _id, uint8_t _version, uint32_t _count, uint32_t _periodUs)
+{
+    uint64_t _start = RfidHost::cycles() + _inUs * RfidHost::CPU_MHZ;
+    for (uint32_t i = 0; i < _count; i++)
+    {
+        uint64_t _cycle = _start + (uint64_t)i * _periodUs * RfidHost::CPU_MHZ + latency();
+        Tag _tag = {_id, _version};
+        tags.insert(std::make_pair(_cycle, _tag));
+        RfidHost::schedule(_cycle, tagEvent, this);
+    }
+}
+
+/**
+ * @brief                   Adds the tag reads from the script. Each line is
+ *
+ *                              <in us> <tag ID> [<count> <period us> [<version>]]
+ *
+ *                          with the same meaning as the addTag() parameters (numbers can be hex with 0x). Empty lines
+ *                          and lines starting with # are skipped.
+ *
+ * @param                   const char *_text
+ *                          Script.
+ *
+ * @return                  bool - True if all lines were added, false on the first bad line.
+ */
+bool RfidBreakout::script(const char *_text)
+{
+    while (_text && *_text)
+    {
+        const char *_end = strchr(_text, '\n');
+        std::string _line(_text, _end ? _end - _text : strlen(_text));
+        _text = _end ? _end + 1 : NULL;
+
+        size_t _first = _line.find_first_not_of(" \t\r");
+        if (_first == std::string::npos || _line[_first] == '#')
+            continue;
+
+        unsigned long long _inUs = 0, _id = 0, _count = 1, _period = 0, _version = 0;
+        int _n = sscanf(_line.c_str(), "%lli %lli %lli %lli %lli", (long long *)&_inUs, (long long *)&_id,
+                        (long long *)&_count, (long long *)&_period, (long long *)&_version);
+        if (_n < 2 || _n == 3)
+            return false;
+
+        addTag(_inUs, (uint32_t)_id, (uint8_t)_version, (uint32_t)_count, (uint32_t)_period);
+    }
+
+    return true;
+}
+
+/**
+ * @brief                   Checks if the breakout has nothing more to do (all tags read and all bytes sent).
+ *
+ * @return                  bool - True if idle.
+ */
+bool RfidBreakout::idle()
+{
+    return tags.empty() && pinChanges.empty() && txFreeCycle <= RfidHost::cycles();
+}
+
+/**
+ * @brief                   Gets the time the last tag came out of the breakout (frame start on UART, registers set on
+ *                          easyC), to measure the latency of the reader from it.
+ *
+ * @return                  uint64_t - Time in cycles.
+ */
+uint64_t RfidBreakout::lastTagCycle()
+{
+    return lastTag;
+}
+
+/**
+ * @brief                   Gets the counters of the breakout.
+ *
+ * @return                  RfidBreakoutStats - Counters.
+ */
+RfidBreakoutStats RfidBreakout::stats()
+{
+    return counters;
+}
+
+int RfidBreakout::available()
+{
+    int _n = 0;
+    uint64_t _now = RfidHost::cycles();
+    for (size_t i = 0; i < streamBytes.size() && streamBytes[i].first <= _now; i++)
+        _n++;
+    return _n;
+}
+
+int RfidBreakout::read()
+{
+    int _c = peek();
+    if (_c >= 0)
+        streamBytes.pop_front();
+    return _c;
+}
+
+int RfidBreakout::peek()
+{
+    if (streamBytes.empty() || streamBytes.front().first > RfidHost::cycles())
+        return -1;
+    return streamBytes.front().second;
+}
+
+size_t RfidBreakout::write(uint8_t _c)
+{
+    if (mode != RFID_BREAKOUT_STREAM)
+        return 0;
+
+    command((char)_c);
+    return 1;
+}
+
+bool RfidBreakout::i2cWrite(uint8_t _address, const uint8_t *_data, size_t _n, uint8_t *_error)
+{
+    if (mode != RFID_BREAKOUT_EASYC || _address != getAddress())
+        return false;
+
+    if (chance(nackRate))
+    {
+        counters.nacks++;
+        return false;
+    }
+
+    *_error = 0;
+    if (_n)
+    {
+        reg = _data[0];
+        if (reg == 3)
+            clearTag();
+    }
+    return true;
+}
+
+bool RfidBreakout::i2cRead(uint8_t _address, uint8_t *_data, size_t _n)
+{
+    if (mode != RFID_BREAKOUT_EASYC || _address != getAddress())
+        return false;
+
+    if (chance(nackRate))
+    {
+        counters.nacks++;
+        return false;
+    }
+
+    memset(_data, 0, _n);
+    switch (reg)
+    {
+    case 0:
+        if (_n)
+            _data[0] = tagAvailable;
+        break;
+
+    case 1:
+        memcpy(_data, &tagId, _n < sizeof(tagId) ? _n : sizeof(tagId));
+        tagId = 0;
+        tagAvailable = false;
+        if (intPin >= 0)
+            RfidHost::setPin(intPin, LOW);
+        break;
+
+    case 2:
+        memcpy(_data, &tagRaw, _n < sizeof(tagRaw) ? _n : sizeof(tagRaw));
+        tagRaw = 0;
+        break;
+    }
+    return true;
+}
+
+void RfidBreakout::tagEvent(void *_ctx)
+{
+    RfidBreakout *_self = (RfidBreakout *)_ctx;
+    if (_self->tags.empty())
+        return;
+
+    Tag _tag = _self->tags.begin()->second;
+    _self->tags.erase(_self->tags.begin());
+    _self->tagRead(_tag);
+}
+
+void RfidBreakout::pinEvent(void *_ctx)
+{
+    RfidBreakout *_self = (RfidBreakout *)_ctx;
+    if (_self->pinChanges.empty())
+        return;
+
+    PinChange _change = _self->pinChanges.begin()->second;
+    _self->pinChanges.erase(_self->pinChanges.begin());
+    RfidHost::setPin(_change.pin, _change.level);
+}
+
+/**
+ * @brief                   Decodes the received UART byte, sampling the middle of each data bit.
+ */
+void RfidBreakout::rxEvent(void *_ctx)
+{
+    RfidBreakout *_self = (RfidBreakout *)_ctx;
+    uint64_t _bit = _self->bitCycles();
+    uint8_t _byte = 0;
+    size_t _edge = 0;
+    bool _level = false;
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        uint64_t _sample = _self->rxStart + _bit * (2 * i + 3) / 2;
+        while (_edge < _self->rxEdges.size() && _self->rxEdges[_edge].first <= _sample)
+            _level = _self->rxEdges[_edge++].second;
+        _byte |= _level << i;
+    }
+
+    _self->rxBusy = false;
+    _self->rxEdges.clear();
+    _self->command((char)_byte);
+}
+
+void RfidBreakout::watchRx(uint8_t _pin, bool _level, uint64_t _cycle, void *_ctx)
+{
+    RfidBreakout *_self = (RfidBreakout *)_ctx;
+    if (_pin != _self->rxPin)
+        return;
+
+    if (_self->rxBusy)
+    {
+        _self->rxEdges.push_back(std::make_pair(_cycle, _level));
+    }
+    else if (!_level)
+    {
+        // Start bit, the byte is decoded in the middle of the stop bit.
+        _self->rxBusy = true;
+        _self->rxStart = _cycle;
+        _self->rxEdges.push_back(std::make_pair(_cycle, _level));
+        RfidHost::schedule(_cycle + _self->bitCycles() * 19 / 2, rxEvent, _self);
+    }
+}
+
+/**
+ * @brief                   Puts the tag out: into the registers on easyC or as the frame on UART.
+ *
+ * @param                   const Tag &_tag
+ *                          Tag that was read.
+ */
+void RfidBreakout::tagRead(const Tag &_tag)
+{
+    uint64_t _raw = Em4100::encode(_tag.version, _tag.id);
+    uint64_t _now = RfidHost::cycles();
+    counters.tags++;
+
+    if (mode == RFID_BREAKOUT_EASYC)
+    {
+        if (tagAvailable)
+            counters.overwritten++;
+
+        tagAvailable = true;
+        tagId = _tag.id;
+        tagRaw = _raw;
+        lastTag = _now;
+        if (intPin >= 0)
+            RfidHost::setPin(intPin, HIGH);
+    }
+    else if (mode == RFID_BREAKOUT_UART || mode == RFID_BREAKOUT_STREAM)
+    {
+        char _frame[40];
+        snprintf(_frame, sizeof(_frame), "$%lu&%016llX\r\n", (unsigned long)_tag.id, (unsigned long long)_raw);
+
+        lastTag = _now > txFreeCycle ? _now : txFreeCycle;
+        if (intPin >= 0)
+            setPinAt(lastTag, intPin, HIGH);
+        sendText(_frame, true, _now);
+        if (intPin >= 0)
+            setPinAt(txFreeCycle, intPin, LOW);
+    }
+}
+
+/**
+ * @brief                   Sends the text over UART, after the text that is being sent.
+ *
+ * @param                   const char *_text
+ *                          Text to send.
+ * @param                   bool _tagFrame
+ *                          True if it's a tag frame (for the counters).
+ * @param                   uint64_t _cycle
+ *                          Earliest time to start sending.
+ */
+void RfidBreakout::sendText(const char *_text, bool _tagFrame, uint64_t _cycle)
+{
+    uint64_t _bit = bitCycles();
+    uint64_t _start = _cycle > txFreeCycle ? _cycle : txFreeCycle;
+
+    for (; *_text; _text++, _start += 10 * _bit)
+    {
+        if (chance(byteDropRate))
+        {
+            counters.droppedBytes++;
+            continue;
+        }
+
+        if (mode == RFID_BREAKOUT_UART)
+        {
+            // Start bit, 8 data bits (LSB first) and the stop bit.
+            uint16_t _frame = ((uint16_t)(uint8_t)*_text << 1) | 0x200;
+            for (uint8_t i = 0; i < 10; i++)
+            {
+                bool _level = (_frame >> i) & 1;
+                if (chance(bitErrorRate))
+                {
+                    counters.bitErrors++;
+                    _level = !_level;
+                }
+
+                if (_level != txLevel)
+                {
+                    setPinAt(_start + i * _bit, txPin, _level);
+                    txLevel = _level;
+                }
+            }
+        }
+        else
+        {
+            uint8_t _byte = *_text;
+            for (uint8_t i = 0; i < 8; i++)
+            {
+                if (chance(bitErrorRate))
+                {
+                    counters.bitErrors++;
+                    _byte ^= 1 << i;
+                }
+            }
+
+            // Byte can be read once its stop bit is received.
+            streamBytes.push_back(std::make_pair(_start + 10 * _bit, _byte));
+        }
+    }
+
+    // Line goes back to idle if the last bit was flipped.
+    if (mode == RFID_BREAKOUT_UART && !txLevel)
+    {
+        setPinAt(_start, txPin, HIGH);
+        txLevel = true;
+    }
+
+    txFreeCycle = _start;
+    if (_tagFrame)
+        counters.frames++;
+}
+
+/**
+ * @brief                   Handles the byte received over UART, answers the ping when its line is complete.
+ *
+ * @param                   char _c
+ *                          Received byte.
+ */
+void RfidBreakout::command(char _c)
+{
+    if (_c != '\n')
+    {
+        if (rxLine.size() < 64)
+            rxLine.push_back(_c);
+        return;
+    }
+
+    if (rxLine.find("#rfping") != std::string::npos)
+    {
+        counters.pings++;
+        sendText("#hello\r\n", false, RfidHost::cycles() + latency());
+    }
+    rxLine.clear();
+}
+
+void RfidBreakout::setPinAt(uint64_t _cycle, uint8_t _pin, bool _level)
+{
+    uint64_t _now = RfidHost::cycles();
+    if (_cycle < _now)
+        _cycle = _now;
+
+    PinChange _change = {_pin, _level};
+    pinChanges.insert(std::make_pair(_cycle, _change));
+    RfidHost::schedule(_cycle, pinEvent, this);
+}
+
+void RfidBreakout::clearTag()
+{
+    tagAvailable = false;
+    tagId = 0;
+    tagRaw = 0;
+    if (intPin >= 0 && mode == RFID_BREAKOUT_EASYC)
+        RfidHost::setPin(intPin, LOW);
+}
+
+uint64_t RfidBreakout::latency()
+{
+    uint64_t _us = latencyUs;
+    if (jitterUs)
+        _us += random() % (jitterUs + 1);
+    return _us * RfidHost::CPU_MHZ;
+}
+
+bool RfidBreakout::chance(double _rate)
+{
+    return _rate > 0 && std::uniform_real_distribution<double>(0, 1)(random) < _rate;
+}
+
+uint64_t RfidBreakout::bitCycles()
+{
+    return RfidHost::CPU_MHZ * 1000000ULL / getBaud();
+}
@@ -0,0 +1,178 @@
+/**
+ **************************************************
+ *
+ * @file        RfidBreakout.h
+ * @brief       Virtual Soldered 125kHz RFID breakout for the host build. It speaks the UART protocol (on the virtual
+ *              pins or as a Stream) and the easyC register map, with configurable timing and faults and scripted tag
+ *              arrivals.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_BREAKOUT__
+#define __RFID_BREAKOUT__
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+
+// Interfaces of the breakout.
+#define RFID_BREAKOUT_NONE   0
+#define RFID_BREAKOUT_UART   1
+#define RFID_BREAKOUT_STREAM 2
+#define RFID_BREAKOUT_EASYC  3
+
+// Default easyC address (all DIP switches off).
+#define RFID_BREAKOUT_ADDRESS 0x30
+
+// Counters of the breakout.
+struct RfidBreakoutStats
+{
+    // Tags read from the antenna.
+    uint32_t tags;
+
+    // Tag frames sent over UART (not counting the dropped bytes).
+    uint32_t frames;
+
+    // Pings received and answered.
+    uint32_t pings;
+
+    // Bytes dropped and bits flipped on the UART.
+    uint32_t droppedBytes;
+    uint32_t bitErrors;
+
+    // I2C transactions NACKed and tags overwritten in the registers before they were read.
+    uint32_t nacks;
+    uint32_t overwritten;
+};
+
+/**
+ * Virtual RFID breakout. DIP switches select the UART baud rate (9600, 2400, 4800, 19200, 38400, 57600, 115200,
+ * 230400) or the easyC address (0x30 - 0x37), as printed on the board. The breakout is connected in one of three ways:
+ *
+ *      beginUart()     UART bits on the virtual pins, for Rfid(rxPin, txPin, baud) and its software serial.
+ *      beginStream()   The breakout is the Stream given to Rfid(Stream &), bytes arrive at the UART byte times.
+ *      beginEasyC()    Device on the virtual I2C bus, registers 0 (tag available), 1 (tag ID), 2 (RAW data) and 3
+ *                      (clear). Reading the ID clears it and the available flag, reading the RAW data clears
+ *                      the RAW data.
+ *
+ * Each tag read (added by addTag() or script()) comes out after the latency with a random jitter: as the
+ * "$<id>&<raw hex>" frame on UART, or in the registers on easyC. The INT pin, if set, goes high when the tag is ready
+ * and low when it's cleared (easyC) or sent (UART).
+ */
+class RfidBreakout : public TwoWireDevice, public Stream
+{
+  public:
+    RfidBreakout();
+    ~RfidBreakout();
+
+    void setSwitches(uint8_t _switches);
+    uint32_t getBaud();
+    uint8_t getAddress();
+
+    void beginUart(uint8_t _txPin, uint8_t _rxPin);
+    void beginStream();
+    void beginEasyC();
+    void end();
+    void setIntPin(uint8_t _pin);
+
+    void setLatency(uint32_t _latencyUs, uint32_t _jitterUs);
+    void setFaults(double _bitErrorRate, double _byteDropRate, double _nackRate);
+    void setSeed(uint32_t _seed);
+
+    void addTag(uint64_t _inUs, uint32_t _id, uint8_t _version = 0, uint32_t _count = 1, uint32_t _periodUs = 0);
+    bool script(const char *_text);
+    bool idle();
+    uint64_t lastTagCycle();
+    RfidBreakoutStats stats();
+
+    static uint32_t baudForSwitches(uint8_t _switches);
+    static uint8_t addressForSwitches(uint8_t _switches);
+
+    // Stream (beginStream()).
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t _c);
+    using Print::write;
+
+    // I2C device (beginEasyC()).
+    bool i2cWrite(uint8_t _address, const uint8_t *_data, size_t _n, uint8_t *_error);
+    bool i2cRead(uint8_t _address, uint8_t *_data, size_t _n);
+
+  private:
+    // Tag read waiting for its time.
+    struct Tag
+    {
+        uint32_t id;
+        uint8_t version;
+    };
+
+    // Pin change waiting for its time.
+    struct PinChange
+    {
+        uint8_t pin;
+        bool level;
+    };
+
+    static void tagEvent(void *_ctx);
+    static void pinEvent(void *_ctx);
+    static void rxEvent(void *_ctx);
+    static void watchRx(uint8_t _pin, bool _level, uint64_t _cycle, void *_ctx);
+
+    void tagRead(const Tag &_tag);
+    void sendText(const char *_text, bool _tagFrame, uint64_t _cycle);
+    void command(char _c);
+    void setPinAt(uint64_t _cycle, uint8_t _pin, bool _level);
+    void clearTag();
+    uint64_t latency();
+    bool chance(double _rate);
+    uint64_t bitCycles();
+
+    uint8_t mode = RFID_BREAKOUT_NONE;
+    uint8_t switches = 0;
+    int txPin = -1;
+    int rxPin = -1;
+    int intPin = -1;
+
+    uint32_t latencyUs = 0;
+    uint32_t jitterUs = 0;
+    double bitErrorRate = 0;
+    double byteDropRate = 0;
+    double nackRate = 0;
+    std::mt19937 random;
+
+    // Scheduled tag reads and pin changes, the earliest one is taken when its event runs.
+    std::multimap<uint64_t, Tag> tags;
+    std::multimap<uint64_t, PinChange> pinChanges;
+
+    // Time the UART transmitter is free again and the last level put on the TX line.
+    uint64_t txFreeCycle = 0;
+    bool txLevel = true;
+
+    // Bytes sent as the Stream with the time each one arrives.
+    std::deque<std::pair<uint64_t, uint8_t> > streamBytes;
+
+    // UART receiver: start of the frame being received, the line changes since then and the command line.
+    bool rxBusy = false;
+    uint64_t rxStart = 0;
+    std::deque<std::pair<uint64_t, bool> > rxEdges;
+    std::string rxLine;
+
+    // easyC registers.
+    uint8_t reg = 0;
+    bool tagAvailable = false;
+    uint32_t tagId = 0;
+    uint64_t tagRaw = 0;
+
+    uint64_t lastTag = 0;
+    RfidBreakoutStats counters = RfidBreakoutStats();
+};
+
+#endif
@@ -0,0 +1,488 @@
+/**
+ **************************************************
+ *
+ * @file        RfidReplay.cpp
+ * @brief       Reader traffic replay functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RfidReplay.h"
+
+/**
+ * @brief                   Closes the file.
+ */
+RfidCaptureFile::~RfidCaptureFile()
+{
+    close();
+}
+
+/**
+ * @brief                   Creates the file for the capture (overwrites the existing one).
+ *
+ * @param                   const char *_path
+ *                          Path of the file.
+ *
+ * @return                  bool - True if created.
+ */
+bool RfidCaptureFile::open(const char *_path)
+{
+    close();
+    file = fopen(_path, "wb");
+    return file != NULL;
+}
+
+/**
+ * @brief                   Writes out the buffered data and closes the file.
+ */
+void RfidCaptureFile::close()
+{
+    if (file)
+        fclose(file);
+    file = NULL;
+}
+
+size_t RfidCaptureFile::write(uint8_t _c)
+{
+    return write(&_c, 1);
+}
+
+size_t RfidCaptureFile::write(const uint8_t *_buffer, size_t _size)
+{
+    return file ? fwrite(_buffer, 1, _size, file) : 0;
+}
+
+/**
+ * @brief                   Stops the playback and cancels its scheduled events.
+ */
+RfidReplay::~RfidReplay()
+{
+    end();
+}
+
+/**
+ * @brief                   Loads the capture from the file.
+ *
+ * @param                   const char *_path
+ *                          Path of the capture.
+ *
+ * @return                  bool - True if the file is a capture.
+ */
+bool RfidReplay::load(const char *_path)
+{
+    FILE *_file = fopen(_path, "rb");
+    if (!_file)
+        return false;
+
+    std::vector<uint8_t> _data;
+    uint8_t _buffer[4096];
+    size_t _n;
+    while ((_n = fread(_buffer, 1, sizeof(_buffer), _file)) > 0)
+        _data.insert(_data.end(), _buffer, _buffer + _n);
+    fclose(_file);
+
+    return begin(_data.data(), _data.size());
+}
+
+/**
+ * @brief                   Uses the capture in memory (it's copied).
+ *
+ * @param                   const uint8_t *_data
+ *                          Capture, with the header.
+ * @param                   size_t _n
+ *                          Size of the capture in bytes.
+ *
+ * @return                  bool - True if the header is valid.
+ */
+bool RfidReplay::begin(const uint8_t *_data, size_t _n)
+{
+    end();
+    data.assign(_data, _data + _n);
+    if (!reader.begin(data.data(), data.size()))
+        return false;
+
+    parse();
+    return true;
+}
+
+/**
+ * @brief                   Gets the header of the capture.
+ *
+ * @return                  const RfidCaptureHeader & - Header.
+ */
+const RfidCaptureHeader &RfidReplay::header()
+{
+    return reader.header();
+}
+
+/**
+ * @brief                   Sets the replay speed, used by the next play call.
+ *
+ * @param                   uint8_t _speed
+ *                          RFID_REPLAY_ORIGINAL or RFID_REPLAY_MAX.
+ * @param                   uint32_t _maxGapUs
+ *                          Longest gap kept at RFID_REPLAY_MAX, in microseconds.
+ */
+void RfidReplay::setSpeed(uint8_t _speed, uint32_t _maxGapUs)
+{
+    speed = _speed;
+    maxGapUs = _maxGapUs;
+}
+
+/**
+ * @brief                   Plays the recorded RX bytes as the Stream given to Rfid(Stream &).
+ *
+ * @return                  bool - False if the capture has no UART traffic.
+ */
+bool RfidReplay::playStream()
+{
+    start(RFID_REPLAY_STREAM);
+    if (!(header().sources & RFID_CAPTURE_UART))
+        return false;
+
+    RfidCaptureRecord _record;
+    while (reader.next(&_record))
+    {
+        if (_record.type == RFID_CAPTURE_RX)
+            bytes.push_back(std::make_pair(toCycle(_record.time, 1), _record.data[0]));
+    }
+    return true;
+}
+
+/**
+ * @brief                   Plays the recorded RX bytes as UART frames on the pin. The bytes were recorded when the
+ *                          reader read them, so each frame is sent to end by its recorded time and the bytes read
+ *                          together are sent back to back before it.
+ *
+ * @param                   uint8_t _pin
+ *                          Pin to drive (the RX pin of the reader).
+ *
+ * @return                  bool - False if the capture has no UART traffic or no baud rate.
+ */
+bool RfidReplay::playUart(uint8_t _pin)
+{
+    start(RFID_REPLAY_UART);
+    if (!(header().sources & RFID_CAPTURE_UART) || !header().baud)
+        return false;
+
+    std::vector<std::pair<uint64_t, uint8_t> > _bytes;
+    RfidCaptureRecord _record;
+    while (reader.next(&_record))
+    {
+        if (_record.type == RFID_CAPTURE_RX)
+            _bytes.push_back(std::make_pair(toCycle(_record.time, 1), _record.data[0]));
+    }
+
+    // Frame start times, going back from the last byte (8N1 frame is 10 bits).
+    const uint64_t _frame = 10ULL * RfidHost::CPU_MHZ * 1000000 / header().baud;
+    uint64_t _earliest = RfidHost::cycles() + _frame;
+    for (size_t i = _bytes.size(); i-- > 0;)
+    {
+        uint64_t _end = _bytes[i].first;
+        if (i + 1 < _bytes.size() && _end > _bytes[i + 1].first)
+            _end = _bytes[i + 1].first;
+        _bytes[i].first = _end > _earliest ? _end - _frame : _earliest - _frame;
+    }
+
+    pin = _pin;
+    wave.reset(new RfidUartWave(pin));
+    wave->setFormat(header().baud);
+    wave->begin();
+    for (size_t i = 0; i < _bytes.size(); i++)
+        wave->send(&_bytes[i].second, 1, _bytes[i].first);
+
+    return true;
+}
+
+/**
+ * @brief                   Plays the recorded software serial edges on the pin. The edges were timestamped by the ISR,
+ *                          so they come again after the ISR latency of the replay.
+ *
+ * @param                   uint8_t _pin
+ *                          Pin to drive (the RX pin of the reader).
+ *
+ * @return                  bool - False if the capture has no edges.
+ */
+bool RfidReplay::playEdges(uint8_t _pin)
+{
+    start(RFID_REPLAY_EDGES);
+    if (!(header().sources & RFID_CAPTURE_EDGES) || !header().cpuMhz)
+        return false;
+
+    pin = _pin;
+    RfidCaptureRecord _record;
+    while (reader.next(&_record))
+    {
+        if (_record.type != RFID_CAPTURE_EDGE)
+            continue;
+
+        // Line is at the other level until the first edge.
+        if (first)
+            RfidHost::setPin(pin, !_record.data[0]);
+
+        uint64_t _cycle = toCycle(_record.time, header().cpuMhz);
+        edges.insert(std::make_pair(_cycle, (bool)_record.data[0]));
+        RfidHost::schedule(_cycle, edgeEvent, this);
+    }
+    return true;
+}
+
+/**
+ * @brief                   Plays the tags the reader got from the easyC registers, as the device on the virtual I2C
+ *                          bus.
+ *
+ * @return                  bool - False if the capture has no easyC traffic.
+ */
+bool RfidReplay::playEasyC()
+{
+    start(RFID_REPLAY_EASYC);
+    if (!(header().sources & RFID_CAPTURE_EASYC))
+        return false;
+
+    // The tag comes at the first read of the available flag that was set, its ID and RAW data are taken from the
+    // register reads that follow.
+    RfidCaptureRecord _record;
+    uint8_t _reg = 0;
+    Tag *_tag = NULL;
+    while (reader.next(&_record))
+    {
+        if (_record.type == RFID_CAPTURE_I2C_WRITE && _record.length)
+        {
+            _reg = _record.data[0];
+        }
+        else if (_record.type == RFID_CAPTURE_I2C_READ && _record.length)
+        {
+            if (_reg == 0 && _record.data[0])
+            {
+                Tag _new = {0, 0};
+                uint64_t _cycle = toCycle(_record.time, 1);
+                _tag = &tags.insert(std::make_pair(_cycle, _new))->second;
+                RfidHost::schedule(_cycle, tagEvent, this);
+            }
+            else if (_reg == 1 && _tag && _record.length >= 4)
+            {
+                memcpy(&_tag->id, _record.data, 4);
+            }
+            else if (_reg == 2 && _tag && _record.length >= 8)
+            {
+                memcpy(&_tag->raw, _record.data, 8);
+            }
+        }
+    }
+
+    Wire.attach(this);
+    return true;
+}
+
+/**
+ * @brief                   Stops the playback. Traffic not played yet is dropped.
+ */
+void RfidReplay::end()
+{
+    if (mode == RFID_REPLAY_EASYC)
+        Wire.detach(this);
+
+    RfidHost::cancelEvents(this);
+    wave.reset();
+    bytes.clear();
+    edges.clear();
+    tags.clear();
+    reg = 0;
+    tagAvailable = false;
+    tagId = 0;
+    tagRaw = 0;
+    mode = RFID_REPLAY_NONE;
+}
+
+/**
+ * @brief                   Checks if all the traffic was played.
+ *
+ * @return                  bool - True if idle.
+ */
+bool RfidReplay::idle()
+{
+    return bytes.empty() && edges.empty() && tags.empty() && (!wave || wave->idle());
+}
+
+/**
+ * @brief                   Gets the time of the last played record.
+ *
+ * @return                  uint64_t - Time in cycles.
+ */
+uint64_t RfidReplay::endCycle()
+{
+    return lastCycle;
+}
+
+/**
+ * @brief                   Gets the tag IDs the reader returned when the capture was made, to compare them with the
+ *                          tags it returns from the replay.
+ *
+ * @return                  const std::vector<uint32_t> & - Tag IDs, in order.
+ */
+const std::vector<uint32_t> &RfidReplay::tagIds()
+{
+    return ids;
+}
+
+int RfidReplay::available()
+{
+    int _n = 0;
+    uint64_t _now = RfidHost::cycles();
+    for (size_t i = 0; i < bytes.size() && bytes[i].first <= _now; i++)
+        _n++;
+    return _n;
+}
+
+int RfidReplay::read()
+{
+    int _c = peek();
+    if (_c >= 0)
+        bytes.pop_front();
+    return _c;
+}
+
+int RfidReplay::peek()
+{
+    if (bytes.empty() || bytes.front().first > RfidHost::cycles())
+        return -1;
+    return bytes.front().second;
+}
+
+size_t RfidReplay::write(uint8_t _c)
+{
+    // Commands from the reader are not answered, the answers are in the capture.
+    (void)_c;
+    return mode == RFID_REPLAY_STREAM;
+}
+
+bool RfidReplay::i2cWrite(uint8_t _address, const uint8_t *_data, size_t _n, uint8_t *_error)
+{
+    if (mode != RFID_REPLAY_EASYC || _address != header().address)
+        return false;
+
+    *_error = 0;
+    if (_n)
+    {
+        reg = _data[0];
+        if (reg == 3)
+        {
+            tagAvailable = false;
+            tagId = 0;
+            tagRaw = 0;
+        }
+    }
+    return true;
+}
+
+bool RfidReplay::i2cRead(uint8_t _address, uint8_t *_data, size_t _n)
+{
+    if (mode != RFID_REPLAY_EASYC || _address != header().address)
+        return false;
+
+    memset(_data, 0, _n);
+    switch (reg)
+    {
+    case 0:
+        if (_n)
+            _data[0] = tagAvailable;
+        break;
+
+    case 1:
+        memcpy(_data, &tagId, _n < sizeof(tagId) ? _n : sizeof(tagId));
+        tagId = 0;
+        tagAvailable = false;
+        break;
+
+    case 2:
+        memcpy(_data, &tagRaw, _n < sizeof(tagRaw) ? _n : sizeof(tagRaw));
+        tagRaw = 0;
+        break;
+    }
+    return true;
+}
+
+void RfidReplay::edgeEvent(void *_ctx)
+{
+    RfidReplay *_self = (RfidReplay *)_ctx;
+    if (_self->edges.empty())
+        return;
+
+    bool _level = _self->edges.begin()->second;
+    _self->edges.erase(_self->edges.begin());
+    RfidHost::setPin(_self->pin, _level);
+}
+
+void RfidReplay::tagEvent(void *_ctx)
+{
+    RfidReplay *_self = (RfidReplay *)_ctx;
+    if (_self->tags.empty())
+        return;
+
+    Tag _tag = _self->tags.begin()->second;
+    _self->tags.erase(_self->tags.begin());
+    _self->tagAvailable = true;
+    _self->tagId = _tag.id;
+    _self->tagRaw = _tag.raw;
+}
+
+/**
+ * @brief                   Collects the tag IDs the reader returned when the capture was made.
+ */
+void RfidReplay::parse()
+{
+    ids.clear();
+
+    RfidCaptureRecord _record;
+    while (reader.next(&_record))
+    {
+        if (_record.type == RFID_CAPTURE_TAG)
+        {
+            uint32_t _id;
+            memcpy(&_id, _record.data, 4);
+            ids.push_back(_id);
+        }
+    }
+    reader.rewind();
+}
+
+/**
+ * @brief                   Stops the playback that is running and starts the new one from the first record.
+ *
+ * @param                   uint8_t _mode
+ *                          RFID_REPLAY_STREAM, RFID_REPLAY_UART, RFID_REPLAY_EDGES or RFID_REPLAY_EASYC.
+ */
+void RfidReplay::start(uint8_t _mode)
+{
+    end();
+    reader.rewind();
+    mode = _mode;
+    first = true;
+    lastTime = 0;
+    lastCycle = RfidHost::cycles();
+}
+
+/**
+ * @brief                   Maps the recorded time to the virtual clock. Records must be mapped in order, the first one
+ *                          comes 1 ms after the start of the playback.
+ *
+ * @param                   uint64_t _time
+ *                          Recorded time.
+ * @param                   uint32_t _clockMhz
+ *                          Clock of the recorded time in MHz (1 for microseconds).
+ *
+ * @return                  uint64_t - Time in cycles.
+ */
+uint64_t RfidReplay::toCycle(uint64_t _time, uint32_t _clockMhz)
+{
+    uint64_t _delta = first ? 1000ULL * RfidHost::CPU_MHZ : (_time - lastTime) * RfidHost::CPU_MHZ / _clockMhz;
+    if (!first && speed == RFID_REPLAY_MAX && _delta > (uint64_t)maxGapUs * RfidHost::CPU_MHZ)
+        _delta = (uint64_t)maxGapUs * RfidHost::CPU_MHZ;
+
+    first = false;
+    lastTime = _time;
+    lastCycle += _delta;
+    return lastCycle;
+}
@@ -0,0 +1,147 @@
+/**
+ **************************************************
+ *
+ * @file        RfidReplay.h
+ * @brief       Replay of the reader traffic captured by RfidCapture, for the host build. The capture is played back
+ *              into Rfid as the breakout would send it: bytes on the Stream, UART frames or the recorded edges on the
+ *              virtual pin, or the easyC registers.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_REPLAY__
+#define __RFID_REPLAY__
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "RFID-CAPTURE.h"
+#include "RfidUartWave.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <vector>
+
+// Playback of the replay.
+#define RFID_REPLAY_NONE   0
+#define RFID_REPLAY_STREAM 1
+#define RFID_REPLAY_UART   2
+#define RFID_REPLAY_EDGES  3
+#define RFID_REPLAY_EASYC  4
+
+// Replay speed.
+#define RFID_REPLAY_ORIGINAL 0
+#define RFID_REPLAY_MAX      1
+
+// Longest gap kept at RFID_REPLAY_MAX in microseconds, a little over SERIAL_TIMEOUT_MS so the frames stay apart.
+#define RFID_REPLAY_MAX_GAP_US 21000
+
+/**
+ * Capture output to a file on Linux.
+ */
+class RfidCaptureFile : public Print
+{
+  public:
+    ~RfidCaptureFile();
+    bool open(const char *_path);
+    void close();
+    size_t write(uint8_t _c);
+    size_t write(const uint8_t *_buffer, size_t _size);
+    using Print::write;
+
+  private:
+    FILE *file = NULL;
+};
+
+/**
+ * Plays the capture back into the reader. At RFID_REPLAY_ORIGINAL the traffic comes at its recorded times, at
+ * RFID_REPLAY_MAX the gaps longer than the maximum gap are shortened to it, so idle time is skipped but the frames
+ * keep their own timing. Playback is scheduled on the virtual clock when it starts:
+ *
+ *      playStream()    The replay is the Stream given to Rfid(Stream &), the recorded RX bytes arrive at their times.
+ *      playUart()      The recorded RX bytes are sent as UART frames on the pin, at the baud rate in the header.
+ *                      Frames are rebuilt from the times the reader read the bytes, so when the reader fell behind
+ *                      and the frames ran together, only playEdges() gives back the same bits.
+ *      playEdges()     The recorded edges are put on the pin (captures with RFID_CAPTURE_EDGES).
+ *      playEasyC()     Device on the virtual I2C bus at the recorded address. Each tag the reader got from the
+ *                      registers comes into the registers at the time it was first seen.
+ */
+class RfidReplay : public TwoWireDevice, public Stream
+{
+  public:
+    ~RfidReplay();
+
+    bool load(const char *_path);
+    bool begin(const uint8_t *_data, size_t _n);
+    const RfidCaptureHeader &header();
+    void setSpeed(uint8_t _speed, uint32_t _maxGapUs = RFID_REPLAY_MAX_GAP_US);
+
+    bool playStream();
+    bool playUart(uint8_t _pin);
+    bool playEdges(uint8_t _pin);
+    bool playEasyC();
+    void end();
+    bool idle();
+    uint64_t endCycle();
+    const std::vector<uint32_t> &tagIds();
+
+    // Stream (playStream()).
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t _c);
+    using Print::write;
+
+    // I2C device (playEasyC()).
+    bool i2cWrite(uint8_t _address, const uint8_t *_data, size_t _n, uint8_t *_error);
+    bool i2cRead(uint8_t _address, uint8_t *_data, size_t _n);
+
+  private:
+    // Tag seen in the easyC registers.
+    struct Tag
+    {
+        uint32_t id;
+        uint64_t raw;
+    };
+
+    static void edgeEvent(void *_ctx);
+    static void tagEvent(void *_ctx);
+
+    void parse();
+    void start(uint8_t _mode);
+    uint64_t toCycle(uint64_t _time, uint32_t _clockMhz);
+
+    std::vector<uint8_t> data;
+    RfidCaptureReader reader;
+    uint8_t speed = RFID_REPLAY_ORIGINAL;
+    uint32_t maxGapUs = RFID_REPLAY_MAX_GAP_US;
+
+    // Tag IDs the reader returned when the capture was made, in order.
+    std::vector<uint32_t> ids;
+
+    // Playback, the recorded time of the last record played and the time it was mapped to, in cycles.
+    uint8_t mode = RFID_REPLAY_NONE;
+    uint64_t lastTime = 0;
+    uint64_t lastCycle = 0;
+    bool first = true;
+
+    // Pin and the waveform generator (playUart()).
+    uint8_t pin = 0;
+    std::unique_ptr<RfidUartWave> wave;
+
+    // Recorded bytes with their times (playStream()), pin edges and easyC tags waiting for their times.
+    std::deque<std::pair<uint64_t, uint8_t> > bytes;
+    std::multimap<uint64_t, bool> edges;
+    std::multimap<uint64_t, Tag> tags;
+
+    // easyC registers.
+    uint8_t reg = 0;
+    bool tagAvailable = false;
+    uint32_t tagId = 0;
+    uint64_t tagRaw = 0;
+};
+
+#endif
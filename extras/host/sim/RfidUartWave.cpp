@@ -0,0 +1,269 @@
+/**
+ **************************************************
+ *
+ * @file        RfidUartWave.cpp
+ * @brief       UART waveform generator functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RfidUartWave.h"
+
+/**
+ * @brief                   Waveform generator constructor, 9600 baud 8N1, no skew, no glitches.
+ *
+ * @param                   uint8_t _pin
+ *                          Virtual pin to drive (the RX pin of the software serial).
+ */
+RfidUartWave::RfidUartWave(uint8_t _pin)
+{
+    pin = _pin;
+    random.seed(1);
+}
+
+/**
+ * @brief                   Cancels the edges that were not sent yet.
+ */
+RfidUartWave::~RfidUartWave()
+{
+    RfidHost::cancelEvents(this);
+}
+
+/**
+ * @brief                   Sets the frame format.
+ *
+ * @param                   uint32_t _baud
+ *                          Nominal baud rate.
+ * @param                   SoftwareSerialConfig _config
+ *                          Data bits, parity and stop bits, as given to SoftwareSerial::begin().
+ * @param                   bool _invert
+ *                          True for the inverted line (idle low).
+ */
+void RfidUartWave::setFormat(uint32_t _baud, SoftwareSerialConfig _config, bool _invert)
+{
+    baud = _baud;
+    config = _config;
+    invert = _invert;
+}
+
+/**
+ * @brief                   Sets the clock error of the transmitter.
+ *
+ * @param                   double _skew
+ *                          Relative bit time error, 0.05 makes the bits 5% longer (slower transmitter), -0.05 5% shorter.
+ */
+void RfidUartWave::setSkew(double _skew)
+{
+    skew = _skew;
+}
+
+/**
+ * @brief                   Sets the idle time between the frames.
+ *
+ * @param                   double _bits
+ *                          Idle time in bits (0 sends the frames back to back).
+ */
+void RfidUartWave::setGap(double _bits)
+{
+    gapBits = _bits;
+}
+
+/**
+ * @brief                   Sets the glitches: short pulses of the other level inside the bit.
+ *
+ * @param                   double _rate
+ *                          Probability of a glitch in each bit.
+ * @param                   double _minBits
+ *                          Shortest glitch, in bits.
+ * @param                   double _maxBits
+ *                          Longest glitch, in bits (less than one bit).
+ */
+void RfidUartWave::setGlitches(double _rate, double _minBits, double _maxBits)
+{
+    glitchRate = _rate;
+    glitchMin = _minBits;
+    glitchMax = _maxBits > _minBits ? _maxBits : _minBits;
+}
+
+/**
+ * @brief                   Seeds the random generator used for the glitches.
+ *
+ * @param                   uint32_t _seed
+ *                          Seed, the same seed gives the same waveform.
+ */
+void RfidUartWave::setSeed(uint32_t _seed)
+{
+    random.seed(_seed);
+}
+
+/**
+ * @brief                   Puts the line to idle (high, or low if inverted) right away.
+ */
+void RfidUartWave::begin()
+{
+    RfidHost::cancelEvents(this);
+    pending.clear();
+    lineLevel = !invert;
+    lineFree = RfidHost::cycles();
+    RfidHost::setPin(pin, lineLevel);
+}
+
+/**
+ * @brief                   Schedules the frames of the bytes, after the frames that are being sent.
+ *
+ * @param                   const uint8_t *_data
+ *                          Bytes to send.
+ * @param                   size_t _n
+ *                          Number of bytes.
+ * @param                   uint64_t _cycle
+ *                          Earliest start of the first frame (0 for now).
+ *
+ * @return                  uint64_t - Time the last frame ends, in cycles.
+ */
+uint64_t RfidUartWave::send(const uint8_t *_data, size_t _n, uint64_t _cycle)
+{
+    const double _bit = (double)RfidHost::CPU_MHZ * 1000000.0 / baud * (1 + skew);
+    std::uniform_real_distribution<double> _uniform(0, 1);
+
+    double _t = lineFree;
+    if (_t < RfidHost::cycles())
+        _t = RfidHost::cycles();
+    if (_t < _cycle)
+        _t = _cycle;
+
+    for (size_t i = 0; i < _n; i++)
+    {
+        bool _bits[12];
+        uint8_t _length = frame(_data[i], config, _bits);
+
+        for (uint8_t b = 0; b < _length; b++)
+        {
+            bool _level = _bits[b] != invert;
+            double _start = _t + b * _bit;
+            if (_level != lineLevel)
+                addEdge(_start, _level);
+            lineLevel = _level;
+
+            if (glitchRate > 0 && _uniform(random) < glitchRate)
+            {
+                // Pulse of the other level, fully inside the bit.
+                double _width = (glitchMin + (glitchMax - glitchMin) * _uniform(random)) * _bit;
+                if (_width > 0.9 * _bit)
+                    _width = 0.9 * _bit;
+                double _at = _start + 0.05 * _bit + (0.95 * _bit - _width) * _uniform(random);
+                if (_width >= 1)
+                {
+                    addEdge(_at, !_level);
+                    addEdge(_at + _width, _level);
+                    glitchCount++;
+                }
+            }
+        }
+        _t += (_length + gapBits) * _bit;
+    }
+
+    lineFree = _t;
+    return (uint64_t)_t;
+}
+
+/**
+ * @brief                   Checks if all edges were sent.
+ *
+ * @return                  bool - True if idle.
+ */
+bool RfidUartWave::idle()
+{
+    return pending.empty();
+}
+
+/**
+ * @brief                   Gets the number of edges scheduled since the constructor.
+ *
+ * @return                  uint32_t - Edges, with the glitch edges.
+ */
+uint32_t RfidUartWave::edges()
+{
+    return edgeCount;
+}
+
+/**
+ * @brief                   Gets the number of glitches scheduled since the constructor.
+ *
+ * @return                  uint32_t - Glitches.
+ */
+uint32_t RfidUartWave::glitches()
+{
+    return glitchCount;
+}
+
+/**
+ * @brief                   Makes the logical bits of the frame: start bit, data bits (LSB first), parity bit and stop
+ *                          bits, in the format SoftwareSerial decodes.
+ *
+ * @param                   uint8_t _byte
+ *                          Byte to send (only the data bits are used).
+ * @param                   SoftwareSerialConfig _config
+ *                          Frame format.
+ * @param                   bool *_bits
+ *                          Frame bits (up to 12).
+ *
+ * @return                  uint8_t - Number of bits in the frame.
+ */
+uint8_t RfidUartWave::frame(uint8_t _byte, SoftwareSerialConfig _config, bool *_bits)
+{
+    uint8_t _dataBits = 5 + (_config & 07);
+    uint8_t _parity = _config & 070;
+    uint8_t _stopBits = (_config & 0300) ? 2 : 1;
+    uint8_t _n = 0;
+    uint8_t _ones = 0;
+
+    _bits[_n++] = false;
+    for (uint8_t i = 0; i < _dataBits; i++)
+    {
+        bool _bit = (_byte >> i) & 1;
+        _ones += _bit;
+        _bits[_n++] = _bit;
+    }
+
+    switch (_parity)
+    {
+    case SWSERIAL_PARITY_EVEN:
+        _bits[_n++] = _ones & 1;
+        break;
+    case SWSERIAL_PARITY_ODD:
+        _bits[_n++] = !(_ones & 1);
+        break;
+    case SWSERIAL_PARITY_MARK:
+        _bits[_n++] = true;
+        break;
+    case SWSERIAL_PARITY_SPACE:
+        _bits[_n++] = false;
+        break;
+    }
+
+    for (uint8_t i = 0; i < _stopBits; i++)
+        _bits[_n++] = true;
+
+    return _n;
+}
+
+void RfidUartWave::edgeEvent(void *_ctx)
+{
+    RfidUartWave *_self = (RfidUartWave *)_ctx;
+    if (_self->pending.empty())
+        return;
+
+    bool _level = _self->pending.begin()->second;
+    _self->pending.erase(_self->pending.begin());
+    RfidHost::setPin(_self->pin, _level);
+}
+
+void RfidUartWave::addEdge(double _cycle, bool _level)
+{
+    uint64_t _at = (uint64_t)(_cycle + 0.5);
+    pending.insert(std::make_pair(_at, _level));
+    RfidHost::schedule(_at, edgeEvent, this);
+    edgeCount++;
+}
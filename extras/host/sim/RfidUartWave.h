@@ -0,0 +1,74 @@
+/**
+ **************************************************
+ *
+ * @file        RfidUartWave.h
+ * @brief       UART waveform generator for the host build. It drives the virtual pin with cycle exact edges, so the
+ *              software serial ISRs run as they would from the GPIO interrupt.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_UART_WAVE__
+#define __RFID_UART_WAVE__
+
+#include "Arduino.h"
+#include "ESPSoftwareSerial.h"
+
+#include <map>
+#include <random>
+
+/**
+ * Generates the UART frames on the virtual pin: any baud rate, the frame formats of SoftwareSerial (5 - 8 data bits,
+ * parity, 1 or 2 stop bits), inverted line, transmitter clock skew and glitches (short pulses of the other level
+ * inside the bits). Edges are scheduled on the virtual clock at their exact cycle and go through setPin(), so the
+ * pin interrupt runs after the ISR latency set by RfidHost::setIsrLatency(), with its jitter.
+ */
+class RfidUartWave
+{
+  public:
+    RfidUartWave(uint8_t _pin);
+    ~RfidUartWave();
+
+    void setFormat(uint32_t _baud, SoftwareSerialConfig _config = SWSERIAL_8N1, bool _invert = false);
+    void setSkew(double _skew);
+    void setGap(double _bits);
+    void setGlitches(double _rate, double _minBits, double _maxBits);
+    void setSeed(uint32_t _seed);
+
+    void begin();
+    uint64_t send(const uint8_t *_data, size_t _n, uint64_t _cycle = 0);
+    bool idle();
+    uint32_t edges();
+    uint32_t glitches();
+
+    static uint8_t frame(uint8_t _byte, SoftwareSerialConfig _config, bool *_bits);
+
+  private:
+    static void edgeEvent(void *_ctx);
+    void addEdge(double _cycle, bool _level);
+
+    uint8_t pin;
+    uint32_t baud = 9600;
+    SoftwareSerialConfig config = SWSERIAL_8N1;
+    bool invert = false;
+    double skew = 0;
+    double gapBits = 0;
+    double glitchRate = 0;
+    double glitchMin = 0;
+    double glitchMax = 0;
+    std::mt19937 random;
+
+    // Scheduled edges (physical line level), the earliest one is taken when its event runs.
+    std::multimap<uint64_t, bool> pending;
+
+    // Time the last frame ends and the physical line level at that time.
+    double lineFree = 0;
+    bool lineLevel = true;
+
+    uint32_t edgeCount = 0;
+    uint32_t glitchCount = 0;
+};
+
+#endif
@@ -0,0 +1,181 @@
+/*
+uart_ber.cpp - Bit error rate and CPU cost of the software serial receiver (ESPSoftwareSerial rxBitISR / rxBitSyncISR
+and rxBits) at each baud rate and transmitter clock skew. Random bytes are sent as cycle exact UART waveforms on the
+virtual RX pin, the pin interrupt calls the ISR after the ISR latency (with its jitter) and the received bytes are
+compared with the sent ones.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host
+    ./build-host/uart_ber [config=8N1] [invert=0] [bytes=2000] [gap=0] [glitch=0] [glitchmin=0.05] [glitchmax=0.3]
+                          [latency=480] [jitter=0] [seed=1] [csv=0]
+
+gap is the idle time between the frames in bits, glitch the probability of a glitch in each bit (its width from
+glitchmin to glitchmax bits), latency and jitter the ISR latency range in cycles (240 cycles is 1 us).
+
+Columns:
+    ber             Wrong data bits per data bit sent (a lost or extra byte counts as all its bits wrong).
+    byte_err        Wrong, lost or extra bytes per byte sent.
+    isr_cycles      Virtual CPU cycles spent in the ISR per byte (the sync ISR busy waits through the whole frame).
+    isr_busy        Share of the time spent in the ISR.
+    decode_ns       Host time per byte in available() / read(), where rxBits() decodes the ISR timestamps.
+*/
+
+#include "ESPSoftwareSerial.h"
+#include "RfidUartWave.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+static const uint8_t RX_PIN = 4;
+
+// Bytes sent in one go, the line goes idle for a few frames after each chunk so a lost frame can't shift the rest.
+static const size_t CHUNK = 32;
+
+static bool parseConfig(const char *text, SoftwareSerialConfig *config)
+{
+    const char *parities = "NEOMS";
+    const uint8_t parityBits[] = {SWSERIAL_PARITY_NONE, SWSERIAL_PARITY_EVEN, SWSERIAL_PARITY_ODD,
+                                  SWSERIAL_PARITY_MARK, SWSERIAL_PARITY_SPACE};
+    const char *parity = text[0] ? strchr(parities, text[1]) : NULL;
+    if (strlen(text) != 3 || text[0] < '5' || text[0] > '8' || !parity || (text[2] != '1' && text[2] != '2'))
+        return false;
+
+    *config = (SoftwareSerialConfig)((text[0] - '5') | parityBits[parity - parities] | (text[2] == '2' ? 0200 : 0));
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    std::string configText = "8N1";
+    unsigned long bytes = 2000, latency = RfidHost::ISR_LATENCY, jitter = 0, seed = 1;
+    double gap = 0, glitch = 0, glitchMin = 0.05, glitchMax = 0.3;
+    bool invert = false, csv = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        const char *value = eq == std::string::npos ? "" : argv[i] + eq + 1;
+
+        if (key == "config")
+            configText = value;
+        else if (key == "invert")
+            invert = atoi(value);
+        else if (key == "bytes")
+            bytes = strtoul(value, NULL, 0);
+        else if (key == "gap")
+            gap = atof(value);
+        else if (key == "glitch")
+            glitch = atof(value);
+        else if (key == "glitchmin")
+            glitchMin = atof(value);
+        else if (key == "glitchmax")
+            glitchMax = atof(value);
+        else if (key == "latency")
+            latency = strtoul(value, NULL, 0);
+        else if (key == "jitter")
+            jitter = strtoul(value, NULL, 0);
+        else if (key == "seed")
+            seed = strtoul(value, NULL, 0);
+        else if (key == "csv")
+            csv = atoi(value);
+        else
+        {
+            fprintf(stderr, "Unknown argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    SoftwareSerialConfig config;
+    if (!parseConfig(configText.c_str(), &config))
+    {
+        fprintf(stderr, "Bad config %s (use 8N1, 7E2, ...)\n", configText.c_str());
+        return 2;
+    }
+    const uint8_t dataBits = 5 + (config & 07);
+    const uint8_t dataMask = (1 << dataBits) - 1;
+
+    const uint32_t bauds[] = {2400, 4800, 9600, 19200, 38400, 57600, 74880, 115200, 230400};
+    const double skews[] = {-0.05, -0.025, 0, 0.025, 0.05};
+
+    if (csv)
+        printf("config,invert,baud,skew,ber,byte_err,isr_cycles,isr_busy,decode_ns\n");
+    else
+        printf("%s%s, %lu bytes, gap %.1f bits, glitch %g, ISR latency %lu + 0..%lu cycles\n\n%8s %7s %10s %10s %11s "
+               "%9s %10s\n",
+               configText.c_str(), invert ? " inverted" : "", bytes, gap, glitch, latency, jitter, "baud", "skew",
+               "ber", "byte_err", "isr_cycles", "isr_busy", "decode_ns");
+
+    for (uint32_t baud : bauds)
+    {
+        for (double skew : skews)
+        {
+            RfidHost::reset();
+            RfidHost::setIsrLatency(latency, latency + jitter, seed);
+
+            RfidUartWave wave(RX_PIN);
+            wave.setFormat(baud, config, invert);
+            wave.setSkew(skew);
+            wave.setGap(gap);
+            wave.setGlitches(glitch, glitchMin, glitchMax);
+            wave.setSeed(seed);
+            wave.begin();
+
+            SoftwareSerial serial(RX_PIN, -1, invert);
+            serial.begin(baud, config);
+            RfidHost::advanceMicros(100);
+
+            std::mt19937 random(seed);
+            unsigned long bitErrors = 0, byteErrors = 0;
+            double decodeNs = 0;
+            uint64_t startCycle = RfidHost::cycles();
+            const uint64_t frameCycles = (uint64_t)RfidHost::CPU_MHZ * 1000000 / baud * 13;
+
+            for (unsigned long sent = 0; sent < bytes; sent += CHUNK)
+            {
+                size_t n = bytes - sent < CHUNK ? bytes - sent : CHUNK;
+                std::vector<uint8_t> data(n);
+                for (size_t i = 0; i < n; i++)
+                    data[i] = random() & dataMask;
+
+                uint64_t end = wave.send(data.data(), n);
+                RfidHost::runUntil(end + 3 * frameCycles);
+
+                std::vector<uint8_t> received;
+                auto start = std::chrono::steady_clock::now();
+                while (serial.available())
+                    received.push_back(serial.read());
+                decodeNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+                // Position by position, the bytes that are missing or extra count as all bits wrong.
+                size_t common = received.size() < n ? received.size() : n;
+                for (size_t i = 0; i < common; i++)
+                {
+                    uint8_t diff = (received[i] ^ data[i]) & dataMask;
+                    bitErrors += __builtin_popcount(diff);
+                    byteErrors += diff != 0;
+                }
+                size_t extra = received.size() > n ? received.size() - n : n - received.size();
+                bitErrors += extra * dataBits;
+                byteErrors += extra;
+            }
+
+            double totalCycles = (double)(RfidHost::cycles() - startCycle);
+            double ber = bytes ? (double)bitErrors / (bytes * dataBits) : 0;
+            double byteErr = bytes ? (double)byteErrors / bytes : 0;
+            double isrCycles = bytes ? (double)RfidHost::isrCycles() / bytes : 0;
+            double isrBusy = totalCycles > 0 ? RfidHost::isrCycles() / totalCycles : 0;
+
+            if (csv)
+                printf("%s,%d,%lu,%.3f,%.6f,%.6f,%.1f,%.4f,%.1f\n", configText.c_str(), invert, (unsigned long)baud,
+                       skew, ber, byteErr, isrCycles, isrBusy, bytes ? decodeNs / bytes : 0);
+            else
+                printf("%8lu %+6.1f%% %10.2e %10.2e %11.1f %8.1f%% %10.1f\n", (unsigned long)baud, skew * 100, ber,
+                       byteErr, isrCycles, isrBusy * 100, bytes ? decodeNs / bytes : 0);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+wiegand_trace.cpp - Runs RfidWiegand on the virtual ESP32 with update() called from a busy loop and from the hardware
+timer (beginTimer()), records the D0 and D1 lines and checks the frame bits against RfidWiegand::encode() and the
+pulse width, the bit period and the gap between frames against the timing set. Exits with 1 if the trace is wrong.
+
+Build and run on Linux (see CMakeLists.txt):
+    cmake -S extras/host -B build-host && cmake --build build-host && ./build-host/wiegand_trace
+*/
+
+#include "RFID-WIEGAND.h"
+
+#include <vector>
+
+static const uint8_t D0_PIN = 25;
+static const uint8_t D1_PIN = 26;
+
+// Output of the application on the same port, the transmitter must leave it alone.
+static const uint8_t OTHER_PIN = 27;
+
+// Low pulse on one of the lines.
+struct Pulse
+{
+    uint8_t pin;
+    uint64_t fall;
+    uint64_t rise;
+};
+
+static std::vector<Pulse> pulses;
+
+static void record(uint8_t pin, bool level, uint64_t cycle, void *ctx)
+{
+    (void)ctx;
+    if (pin != D0_PIN && pin != D1_PIN)
+        return;
+
+    if (!level)
+        pulses.push_back({pin, cycle, 0});
+    else if (!pulses.empty() && pulses.back().pin == pin && !pulses.back().rise)
+        pulses.back().rise = cycle;
+}
+
+static double toMicros(uint64_t cycles)
+{
+    return (double)cycles / RfidHost::CPU_MHZ;
+}
+
+// Sends two frames and checks the trace. With the timer, loop() only sleeps, the timer ISR moves the lines.
+static int trace(bool timer)
+{
+    const uint16_t pulseUs = 50;
+    const uint16_t periodUs = 1000;
+    const uint32_t gapUs = 20000;
+    const uint32_t ids[] = {0x00A1B2C3, 0xDEADBEEF};
+    const uint8_t formats[] = {RFID_WIEGAND_26, RFID_WIEGAND_34};
+    const char *mode = timer ? "timer" : "loop";
+
+    RfidHost::reset();
+    RfidHost::watchPins(record, NULL);
+    pulses.clear();
+
+    pinMode(OTHER_PIN, OUTPUT);
+    digitalWrite(OTHER_PIN, HIGH);
+
+    RfidWiegand wiegand(D0_PIN, D1_PIN);
+    wiegand.setTiming(pulseUs, periodUs, gapUs);
+    wiegand.begin();
+    if (timer && !wiegand.beginTimer(RFID_WIEGAND_TICK_US))
+    {
+        printf("%s: no timer  FAIL\n", mode);
+        return 1;
+    }
+    for (uint8_t i = 0; i < 2; i++)
+        wiegand.send(ids[i], formats[i]);
+
+    while (wiegand.busy())
+    {
+        if (timer)
+            RfidHost::advanceMicros(1000);
+        else
+            wiegand.update();
+    }
+
+    int failures = 0;
+    size_t index = 0;
+    for (uint8_t f = 0; f < 2; f++)
+    {
+        const uint64_t expected = RfidWiegand::encode(ids[f], formats[f]);
+        const size_t first = index;
+        uint64_t bits = 0;
+        double minWidth = 1e9, maxWidth = 0, minPeriod = 1e9, maxPeriod = 0;
+
+        for (uint8_t b = 0; b < formats[f] && index < pulses.size(); b++, index++)
+        {
+            const Pulse &p = pulses[index];
+            bits = (bits << 1) | (p.pin == D1_PIN);
+
+            double width = toMicros(p.rise - p.fall);
+            minWidth = width < minWidth ? width : minWidth;
+            maxWidth = width > maxWidth ? width : maxWidth;
+            if (b)
+            {
+                double period = toMicros(p.fall - pulses[index - 1].fall);
+                minPeriod = period < minPeriod ? period : minPeriod;
+                maxPeriod = period > maxPeriod ? period : maxPeriod;
+            }
+        }
+
+        // Busy loop reads the time every 1 us, so the edges may come up to 2 us late. Timer edges come on the ticks.
+        bool ok = index - first == formats[f] && bits == expected && minWidth >= pulseUs &&
+                  maxWidth <= pulseUs + 2 && minPeriod >= periodUs && maxPeriod <= periodUs + 2;
+        printf("%s: Wiegand %u: %010llX (expected %010llX), pulse %.1f - %.1f us, period %.1f - %.1f us  %s\n", mode,
+               formats[f], (unsigned long long)bits, (unsigned long long)expected, minWidth, maxWidth, minPeriod,
+               maxPeriod, ok ? "ok" : "FAIL");
+        failures += !ok;
+
+        if (f && index - first == formats[f])
+        {
+            double gap = toMicros(pulses[first].fall - pulses[first - 1].fall) - periodUs;
+            bool gapOk = gap >= gapUs;
+            printf("%s: Gap between frames: %.1f us  %s\n", mode, gap, gapOk ? "ok" : "FAIL");
+            failures += !gapOk;
+        }
+    }
+
+    bool idle = digitalRead(D0_PIN) == HIGH && digitalRead(D1_PIN) == HIGH && index == pulses.size();
+    printf("%s: Lines idle high after the frames: %s\n", mode, idle ? "ok" : "FAIL");
+    failures += !idle;
+
+    bool untouched = digitalRead(OTHER_PIN) == HIGH;
+    printf("%s: Other pin of the port untouched: %s\n", mode, untouched ? "ok" : "FAIL");
+    failures += !untouched;
+
+    if (timer)
+    {
+        wiegand.endTimer();
+        bool stopped = !RfidHost::pendingEvents();
+        printf("%s: Timer stopped by endTimer(): %s\n", mode, stopped ? "ok" : "FAIL");
+        failures += !stopped;
+    }
+
+    return failures;
+}
+
+int main()
+{
+    int failures = trace(false) + trace(true);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""
+allowlist_compile.py - Compiles a CSV file of tag IDs into the allowlist image used by RfidAllowlist.
+
+The first column of every row is the tag ID, in decimal or in hex with the 0x prefix. Rows that do not start with a
+number (a header, comments) are skipped. Duplicates are removed.
+
+Usage:
+    allowlist_compile.py badges.csv allowlist.bin              Binary image, e.g. for a memory-mapped file on Linux.
+    allowlist_compile.py badges.csv allowlist.h [--name NAME]  Header with the image as a PROGMEM array for a sketch.
+    --sorted                                                    Sorted layout instead of the Eytzinger layout.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = 0x4C414652
+VERSION = 1
+LAYOUT_SORTED = 0
+LAYOUT_EYTZINGER = 1
+
+
+def read_ids(path):
+    ids = set()
+    with open(path, newline="") as f:
+        for row in csv.reader(f):
+            if not row:
+                continue
+            cell = row[0].strip()
+            try:
+                value = int(cell, 0)
+            except ValueError:
+                continue
+            if not 0 < value <= 0xFFFFFFFF:
+                sys.exit("tag ID out of range: %s" % cell)
+            ids.add(value)
+    return sorted(ids)
+
+
+def eytzinger(sorted_ids):
+    out = [0] * len(sorted_ids)
+    it = iter(sorted_ids)
+
+    def fill(k):
+        if k <= len(sorted_ids):
+            fill(2 * k)
+            out[k - 1] = next(it)
+            fill(2 * k + 1)
+
+    sys.setrecursionlimit(max(1000, 4 * len(sorted_ids).bit_length() + 100))
+    fill(1)
+    return out
+
+
+def image(ids, layout):
+    data = struct.pack("<IHHI", MAGIC, VERSION, layout, len(ids))
+    return data + struct.pack("<%dI" % len(ids), *ids)
+
+
+def header(data, name, count):
+    words = struct.unpack("<%dI" % (len(data) // 4), data)
+    lines = ["// Generated by allowlist_compile.py, %d tag IDs." % count,
+             "#include <Arduino.h>",
+             "",
+             "const uint32_t %s[%d] PROGMEM = {" % (name, len(words))]
+    for i in range(0, len(words), 6):
+        lines.append("    " + ", ".join("0x%08X" % w for w in words[i:i + 6]) + ",")
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile a CSV file of tag IDs into an RfidAllowlist image.")
+    parser.add_argument("csv")
+    parser.add_argument("output")
+    parser.add_argument("--name", default="allowlistImage", help="array name for the .h output")
+    parser.add_argument("--sorted", action="store_true", help="use the sorted layout")
+    args = parser.parse_args()
+
+    ids = read_ids(args.csv)
+    layout = LAYOUT_SORTED if args.sorted else LAYOUT_EYTZINGER
+    data = image(ids if args.sorted else eytzinger(ids), layout)
+
+    if args.output.endswith(".h"):
+        with open(args.output, "w") as f:
+            f.write(header(data, args.name, len(ids)))
+    else:
+        with open(args.output, "wb") as f:
+            f.write(data)
+    print("%d tag IDs, %d bytes" % (len(ids), len(data)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,217 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-ALLOWLIST.cpp
+ * @brief       Flash-resident tag ID allowlist functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-ALLOWLIST.h"
+
+/**
+ * @brief                   Uses the allowlist image made by extras/tools/allowlist_compile.py.
+ *
+ * @param                   const void *_image
+ *                          Pointer to the allowlist image (must be 4 byte aligned).
+ * @param                   size_t _size
+ *                          Size of the image in bytes (sizeof() of the generated array, or the file size).
+ * @param                   bool _progmem
+ *                          True if the image is in PROGMEM (only matters on AVR).
+ *
+ * @return                  bool - True if the image is valid, false if not (also if its tag IDs don't fit into the
+ *                          size).
+ */
+bool RfidAllowlist::begin(const void *_image, size_t _size, bool _progmem)
+{
+    const uint32_t *_words = (const uint32_t *)_image;
+
+    if (_size < sizeof(RfidAllowlistHeader))
+        return false;
+
+    // Read the header the same way as the IDs, it can also be in the flash.
+    RfidAllowlistHeader _header;
+    uint32_t _versionLayout;
+    _header.magic = _progmem ? pgm_read_dword(&_words[0]) : _words[0];
+    _versionLayout = _progmem ? pgm_read_dword(&_words[1]) : _words[1];
+    _header.version = _versionLayout & 0xFFFF;
+    _header.layout = _versionLayout >> 16;
+    _header.count = _progmem ? pgm_read_dword(&_words[2]) : _words[2];
+
+    if (_header.magic != RFID_ALLOWLIST_MAGIC || _header.version != RFID_ALLOWLIST_VERSION)
+        return false;
+
+    // Truncated or corrupted image, the tag IDs would be read past its end.
+    if (_header.count > (_size - sizeof(RfidAllowlistHeader)) / sizeof(uint32_t))
+        return false;
+
+    return begin(_words + (sizeof(RfidAllowlistHeader) / sizeof(uint32_t)), _header.count, _header.layout, _progmem);
+}
+
+/**
+ * @brief                   Uses the array of tag IDs.
+ *
+ * @param                   const uint32_t *_ids
+ *                          Pointer to the unique tag IDs.
+ * @param                   uint32_t _count
+ *                          Number of tag IDs.
+ * @param                   uint8_t _layout
+ *                          RFID_ALLOWLIST_SORTED or RFID_ALLOWLIST_EYTZINGER.
+ * @param                   bool _progmem
+ *                          True if the tag IDs are in PROGMEM (only matters on AVR).
+ *
+ * @return                  bool - True if the layout is known, false if not.
+ */
+bool RfidAllowlist::begin(const uint32_t *_ids, uint32_t _count, uint8_t _layout, bool _progmem)
+{
+    if (_layout != RFID_ALLOWLIST_SORTED && _layout != RFID_ALLOWLIST_EYTZINGER)
+        return false;
+
+    ids = _ids;
+    count = _count;
+    layout = _layout;
+#if defined(__AVR__)
+    progmem = _progmem;
+#else
+    // Flash is memory mapped everywhere else.
+    (void)_progmem;
+    progmem = false;
+#endif
+
+    return true;
+}
+
+/**
+ * @brief                   Checks if the tag ID is in the allowlist.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID (as returned by Rfid::getId()).
+ *
+ * @return                  bool - True if the tag ID is allowed, false if not.
+ */
+bool RfidAllowlist::contains(uint32_t _id)
+{
+    if (!count)
+        return false;
+
+    return layout == RFID_ALLOWLIST_EYTZINGER ? containsEytzinger(_id) : containsSorted(_id);
+}
+
+/**
+ * @brief                   Gets the number of tag IDs in the allowlist.
+ *
+ * @return                  uint32_t - Number of tag IDs.
+ */
+uint32_t RfidAllowlist::size()
+{
+    return count;
+}
+
+/**
+ * @brief                   Reorders the sorted tag IDs into the Eytzinger order (used to build the allowlist in RAM).
+ *
+ * @param                   const uint32_t *_sorted
+ *                          Sorted unique tag IDs.
+ * @param                   uint32_t *_out
+ *                          Array for the reordered tag IDs, must hold _count tag IDs.
+ * @param                   uint32_t _count
+ *                          Number of tag IDs.
+ */
+void RfidAllowlist::eytzinger(const uint32_t *_sorted, uint32_t *_out, uint32_t _count)
+{
+    // In-order walk of the implicit tree (node k has children 2k and 2k + 1) visits the nodes in the sorted order.
+    uint32_t _k = 1;
+    uint32_t _i = 0;
+
+    // Start at the leftmost node.
+    while (2 * _k <= _count)
+        _k *= 2;
+
+    while (_i < _count)
+    {
+        _out[_k - 1] = _sorted[_i++];
+
+        if (2 * _k + 1 <= _count)
+        {
+            // Go to the leftmost node of the right subtree.
+            _k = 2 * _k + 1;
+            while (2 * _k <= _count)
+                _k *= 2;
+        }
+        else
+        {
+            // Go up while coming from the right child.
+            while (_k & 1)
+                _k >>= 1;
+            _k >>= 1;
+        }
+    }
+}
+
+/**
+ * @brief                   Reads the tag ID at the index from RAM or from PROGMEM.
+ *
+ * @param                   uint32_t _index
+ *                          Index of the tag ID.
+ *
+ * @return                  uint32_t - Tag ID.
+ */
+uint32_t RfidAllowlist::read(uint32_t _index)
+{
+    return progmem ? pgm_read_dword(&ids[_index]) : ids[_index];
+}
+
+/**
+ * @brief                   Binary search over the sorted tag IDs, without branching on the comparison result.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ *
+ * @return                  bool - True if found, false if not.
+ */
+bool RfidAllowlist::containsSorted(uint32_t _id)
+{
+    uint32_t _base = 0;
+    uint32_t _n = count;
+
+    while (_n > 1)
+    {
+        uint32_t _half = _n / 2;
+        _base = (read(_base + _half) <= _id) ? _base + _half : _base;
+        _n -= _half;
+    }
+
+    return read(_base) == _id;
+}
+
+/**
+ * @brief                   Search over the tag IDs in the Eytzinger order. Each step goes one level down the tree and
+ *                          the top levels share the same cache lines (or flash cache lines on ESP32) for all lookups.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ *
+ * @return                  bool - True if found, false if not.
+ */
+bool RfidAllowlist::containsEytzinger(uint32_t _id)
+{
+    uint32_t _k = 1;
+
+    while (_k <= count)
+    {
+#if !defined(__AVR__)
+        // Four levels down are 16 consecutive tag IDs, fetch them while this level is compared. Only while they start
+        // inside the list, a pointer past its end would be undefined behaviour.
+        if (_k <= (count - 1) / 16)
+            __builtin_prefetch(ids + 16 * _k);
+#endif
+        _k = 2 * _k + (read(_k - 1) < _id);
+    }
+
+    // Undo the right turns made after the last left turn, that node is the first one not less than the tag ID.
+    _k >>= __builtin_ffsl(~(unsigned long)_k);
+
+    return _k && read(_k - 1) == _id;
+}
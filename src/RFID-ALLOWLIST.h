@@ -0,0 +1,72 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-ALLOWLIST.h
+ * @brief       Header file for the flash-resident tag ID allowlist.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_ALLOWLIST__
+#define __RFID_ALLOWLIST__
+
+#include "Arduino.h"
+
+// Allowlist image magic ("RFAL" in little endian) and format version.
+#define RFID_ALLOWLIST_MAGIC   0x4C414652UL
+#define RFID_ALLOWLIST_VERSION 1
+
+// Order of the tag IDs in the allowlist image.
+#define RFID_ALLOWLIST_SORTED     0
+#define RFID_ALLOWLIST_EYTZINGER  1
+
+/**
+ * Allowlist image, as made by extras/tools/allowlist_compile.py from the CSV file. All fields are little endian.
+ *
+ *      uint32_t magic          RFID_ALLOWLIST_MAGIC
+ *      uint16_t version        RFID_ALLOWLIST_VERSION
+ *      uint16_t layout         RFID_ALLOWLIST_SORTED or RFID_ALLOWLIST_EYTZINGER
+ *      uint32_t count          Number of tag IDs
+ *      uint32_t ids[count]     Unique tag IDs, sorted or in Eytzinger (BFS of the balanced search tree) order
+ */
+struct RfidAllowlistHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t layout;
+    uint32_t count;
+};
+
+/**
+ * Read-only set of allowed tag IDs for offline access control. The IDs are never copied, so the image can stay in the
+ * flash (PROGMEM on AVR, const data on ESP32) or in a memory-mapped file on Linux.
+ */
+class RfidAllowlist
+{
+  public:
+    bool begin(const void *_image, size_t _size, bool _progmem = true);
+    bool begin(const uint32_t *_ids, uint32_t _count, uint8_t _layout, bool _progmem = true);
+    bool contains(uint32_t _id);
+    uint32_t size();
+
+    static void eytzinger(const uint32_t *_sorted, uint32_t *_out, uint32_t _count);
+
+  private:
+    uint32_t read(uint32_t _index);
+    bool containsSorted(uint32_t _id);
+    bool containsEytzinger(uint32_t _id);
+
+    // Tag IDs and their number.
+    const uint32_t *ids = NULL;
+    uint32_t count = 0;
+
+    // Order of the tag IDs.
+    uint8_t layout = RFID_ALLOWLIST_SORTED;
+
+    // True if the tag IDs must be read with pgm_read_dword() (AVR flash).
+    bool progmem = false;
+};
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-BLOOM.cpp
+ * @brief       Bloom filter prefilter of revoked tag IDs functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-BLOOM.h"
+#include <math.h>
+#include <string.h>
+
+// Highest number of hash functions, more never pays off for false positive rates that make sense.
+#define RFID_BLOOM_MAX_HASHES 16
+
+/**
+ * @brief                   Creates an empty filter inside the blob, sized for the number of tag IDs and the false
+ *                          positive rate.
+ *
+ * @param                   uint8_t *_blob
+ *                          Buffer for the filter blob, at least blobSizeFor() bytes.
+ * @param                   uint32_t _blobSize
+ *                          Size of the buffer in bytes.
+ * @param                   uint32_t _expectedIds
+ *                          Number of revoked tag IDs the filter is sized for.
+ * @param                   float _falsePositiveRate
+ *                          False positive rate at the expected number of tag IDs (for example 0.01 for 1%).
+ *
+ * @return                  bool - True if the buffer is big enough, false if not.
+ */
+bool RfidBloomFilter::begin(uint8_t *_blob, uint32_t _blobSize, uint32_t _expectedIds, float _falsePositiveRate)
+{
+    uint32_t _bits = bitsFor(_expectedIds, _falsePositiveRate);
+    if (!_blob || _blobSize < blobSizeFor(_expectedIds, _falsePositiveRate))
+        return false;
+
+    // Optimal number of hash functions is bits per tag ID times ln(2).
+    float _k = (float)_bits / (_expectedIds ? _expectedIds : 1) * 0.6931472f + 0.5f;
+
+    RfidBloomHeader _header;
+    _header.magic = RFID_BLOOM_MAGIC;
+    _header.version = RFID_BLOOM_VERSION;
+    _header.hashes = _k < 1 ? 1 : (_k > RFID_BLOOM_MAX_HASHES ? RFID_BLOOM_MAX_HASHES : (uint8_t)_k);
+    _header.reserved = 0;
+    _header.bits = _bits;
+    memcpy(_blob, &_header, sizeof(_header));
+
+    if (!load(_blob, _blobSize))
+        return false;
+
+    clear();
+    return true;
+}
+
+/**
+ * @brief                   Uses the filter blob as it is (for example received from the backend). The blob is not
+ *                          copied, it must stay valid while the filter is used.
+ *
+ * @param                   uint8_t *_blob
+ *                          Filter blob.
+ * @param                   uint32_t _blobSize
+ *                          Size of the blob in bytes.
+ *
+ * @return                  bool - True if the blob is valid, false if not.
+ */
+bool RfidBloomFilter::load(uint8_t *_blob, uint32_t _blobSize)
+{
+    RfidBloomHeader _header;
+    if (!_blob || _blobSize < sizeof(_header))
+        return false;
+
+    memcpy(&_header, _blob, sizeof(_header));
+    if (_header.magic != RFID_BLOOM_MAGIC || _header.version != RFID_BLOOM_VERSION || !_header.hashes ||
+        _header.hashes > RFID_BLOOM_MAX_HASHES || !_header.bits ||
+        _blobSize < sizeof(_header) + (_header.bits + 7) / 8)
+        return false;
+
+    data = _blob;
+    bits = _blob + sizeof(_header);
+    numBits = _header.bits;
+    hashes = _header.hashes;
+
+    return true;
+}
+
+/**
+ * @brief                   Adds the revoked tag ID to the filter.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ */
+void RfidBloomFilter::add(uint32_t _id)
+{
+    if (!bits)
+        return;
+
+    // Double hashing, the i-th hash function is h1 + i * h2.
+    uint32_t _h = mix(_id);
+    uint32_t _step = mix(_h ^ 0x9E3779B9UL) | 1;
+
+    for (uint8_t i = 0; i < hashes; i++)
+    {
+        // Map the hash onto the filter without division.
+        uint32_t _bit = ((uint64_t)_h * numBits) >> 32;
+        bits[_bit >> 3] |= 1 << (_bit & 7);
+        _h += _step;
+    }
+}
+
+/**
+ * @brief                   Checks if the tag ID may be revoked.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID (as returned by Rfid::getId()).
+ *
+ * @return                  bool - False if the tag is surely not revoked, true if it may be revoked (check it against
+ *                          the full denylist).
+ */
+bool RfidBloomFilter::mayContain(uint32_t _id)
+{
+    if (!bits)
+        return false;
+
+    uint32_t _h = mix(_id);
+    uint32_t _step = mix(_h ^ 0x9E3779B9UL) | 1;
+
+    for (uint8_t i = 0; i < hashes; i++)
+    {
+        uint32_t _bit = ((uint64_t)_h * numBits) >> 32;
+        if (!(bits[_bit >> 3] & (1 << (_bit & 7))))
+            return false;
+        _h += _step;
+    }
+
+    return true;
+}
+
+/**
+ * @brief                   Removes all tag IDs from the filter.
+ */
+void RfidBloomFilter::clear()
+{
+    if (bits)
+        memset(bits, 0, (numBits + 7) / 8);
+}
+
+/**
+ * @brief                   Gets the filter blob (serialized filter) that can be shipped or stored as it is.
+ *
+ * @return                  const uint8_t * - Pointer to the filter blob, NULL if the filter is not initialized.
+ */
+const uint8_t *RfidBloomFilter::blob()
+{
+    return data;
+}
+
+/**
+ * @brief                   Gets the size of the filter blob.
+ *
+ * @return                  uint32_t - Size of the filter blob in bytes.
+ */
+uint32_t RfidBloomFilter::blobSize()
+{
+    return data ? sizeof(RfidBloomHeader) + (numBits + 7) / 8 : 0;
+}
+
+/**
+ * @brief                   Calculates the number of filter bits for the number of tag IDs and the false positive
+ *                          rate.
+ *
+ * @param                   uint32_t _expectedIds
+ *                          Number of revoked tag IDs.
+ * @param                   float _falsePositiveRate
+ *                          False positive rate (for example 0.01 for 1%).
+ *
+ * @return                  uint32_t - Number of bits.
+ */
+uint32_t RfidBloomFilter::bitsFor(uint32_t _expectedIds, float _falsePositiveRate)
+{
+    if (_falsePositiveRate <= 0 || _falsePositiveRate >= 1)
+        _falsePositiveRate = 0.01f;
+    if (!_expectedIds)
+        _expectedIds = 1;
+
+    // m = -n * ln(p) / ln(2)^2
+    return (uint32_t)ceil(-(float)_expectedIds * log(_falsePositiveRate) / 0.480453f);
+}
+
+/**
+ * @brief                   Calculates the size of the filter blob for the number of tag IDs and the false positive
+ *                          rate.
+ *
+ * @param                   uint32_t _expectedIds
+ *                          Number of revoked tag IDs.
+ * @param                   float _falsePositiveRate
+ *                          False positive rate (for example 0.01 for 1%).
+ *
+ * @return                  uint32_t - Size of the blob in bytes.
+ */
+uint32_t RfidBloomFilter::blobSizeFor(uint32_t _expectedIds, float _falsePositiveRate)
+{
+    return sizeof(RfidBloomHeader) + (bitsFor(_expectedIds, _falsePositiveRate) + 7) / 8;
+}
+
+/**
+ * @brief                   Mixes the bits of the tag ID, so similar tag IDs land on unrelated bits (MurmurHash3
+ *                          finalizer).
+ *
+ * @param                   uint32_t _x
+ *                          Value to mix.
+ *
+ * @return                  uint32_t - Mixed value.
+ */
+uint32_t RfidBloomFilter::mix(uint32_t _x)
+{
+    _x ^= _x >> 16;
+    _x *= 0x85EBCA6BUL;
+    _x ^= _x >> 13;
+    _x *= 0xC2B2AE35UL;
+    _x ^= _x >> 16;
+    return _x;
+}
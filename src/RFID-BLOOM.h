@@ -0,0 +1,77 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-BLOOM.h
+ * @brief       Header file for the Bloom filter prefilter of revoked tag IDs.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_BLOOM__
+#define __RFID_BLOOM__
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+// Bloom filter blob magic ("RFBF" in little endian) and format version.
+#define RFID_BLOOM_MAGIC   0x46424652UL
+#define RFID_BLOOM_VERSION 1
+
+/**
+ * Bloom filter blob. The filter always lives inside its blob, so the blob is the serialized filter and it can be
+ * shipped, stored or loaded without any conversion.
+ *
+ *      uint32_t magic          RFID_BLOOM_MAGIC
+ *      uint16_t version        RFID_BLOOM_VERSION
+ *      uint8_t  hashes         Number of hash functions
+ *      uint8_t  reserved
+ *      uint32_t bits           Number of bits in the filter
+ *      uint8_t  data[]         Filter bits, (bits + 7) / 8 bytes
+ */
+struct RfidBloomHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint8_t hashes;
+    uint8_t reserved;
+    uint32_t bits;
+};
+
+/**
+ * Compact set of revoked tag IDs. mayContain() never misses a revoked tag, and for a tag that is not revoked it returns
+ * true only with the configured false positive rate, so only those few reads must be checked against the full
+ * denylist. Tags can be added at any time, but not removed (rebuild the filter for that).
+ */
+class RfidBloomFilter
+{
+  public:
+    bool begin(uint8_t *_blob, uint32_t _blobSize, uint32_t _expectedIds, float _falsePositiveRate);
+    bool load(uint8_t *_blob, uint32_t _blobSize);
+    void add(uint32_t _id);
+    bool mayContain(uint32_t _id);
+    void clear();
+    const uint8_t *blob();
+    uint32_t blobSize();
+
+    static uint32_t bitsFor(uint32_t _expectedIds, float _falsePositiveRate);
+    static uint32_t blobSizeFor(uint32_t _expectedIds, float _falsePositiveRate);
+
+  private:
+    static uint32_t mix(uint32_t _x);
+
+    // Filter blob (header and bits), filter bits inside the blob and the number of bits.
+    uint8_t *data = NULL;
+    uint8_t *bits = NULL;
+    uint32_t numBits = 0;
+
+    // Number of hash functions.
+    uint8_t hashes = 0;
+};
+
+#endif
@@ -0,0 +1,469 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-CAPTURE.cpp
+ * @brief       Reader traffic capture functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-CAPTURE.h"
+
+/**
+ * @brief                   Starts the capture. The header is written by the reader when the capture is attached to it
+ *                          (Rfid::setCapture()).
+ *
+ * @param                   Print &_out
+ *                          Output of the capture (Serial, SD card file, ...).
+ * @param                   uint8_t _sources
+ *                          Traffic to capture, RFID_CAPTURE_UART, RFID_CAPTURE_EASYC and RFID_CAPTURE_EDGES.
+ */
+void RfidCapture::begin(Print &_out, uint8_t _sources)
+{
+    out = &_out;
+    sources = _sources;
+    lastMicros = micros();
+    lastEdge = 0;
+    recordCount = 0;
+    byteCount = 0;
+    errorCount = 0;
+}
+
+/**
+ * @brief                   Stops the capture, nothing is written after it.
+ */
+void RfidCapture::end()
+{
+    out = NULL;
+}
+
+/**
+ * @brief                   Checks if the traffic is captured.
+ *
+ * @param                   uint8_t _source
+ *                          RFID_CAPTURE_UART, RFID_CAPTURE_EASYC or RFID_CAPTURE_EDGES.
+ *
+ * @return                  bool - True if captured.
+ */
+bool RfidCapture::capturing(uint8_t _source)
+{
+    return out && (sources & _source);
+}
+
+/**
+ * @brief                   Writes the capture header (called by Rfid::setCapture()).
+ *
+ * @param                   bool _native
+ *                          True for UART, false for easyC.
+ * @param                   uint32_t _baud
+ *                          UART baud rate, 0 if not known.
+ * @param                   uint8_t _address
+ *                          easyC address.
+ * @param                   uint16_t _cpuMhz
+ *                          Clock of the edge timestamps in MHz, 0 if there are no edges.
+ */
+void RfidCapture::header(bool _native, uint32_t _baud, uint8_t _address, uint16_t _cpuMhz)
+{
+    if (!out)
+        return;
+
+    RfidCaptureHeader _header;
+    _header.magic = RFID_CAPTURE_MAGIC;
+    _header.version = RFID_CAPTURE_VERSION;
+    _header.sources = sources;
+    _header.native = _native;
+    _header.address = _address;
+    _header.baud = _baud;
+    _header.cpuMhz = _cpuMhz;
+    _header.reserved = 0;
+
+    // Both the Arduino boards and Linux are little endian, so the header is written as it is.
+    put((const uint8_t *)&_header, sizeof(_header));
+    lastMicros = micros();
+}
+
+/**
+ * @brief                   Records the byte read from the UART.
+ *
+ * @param                   uint8_t _byte
+ *                          Byte read.
+ */
+void RfidCapture::rx(uint8_t _byte)
+{
+    if (!capturing(RFID_CAPTURE_UART))
+        return;
+
+    uint8_t _buffer[8];
+    uint8_t _n = stamp(_buffer, RFID_CAPTURE_RX);
+    _buffer[_n++] = _byte;
+    put(_buffer, _n);
+}
+
+/**
+ * @brief                   Records the bytes written to the UART.
+ *
+ * @param                   const uint8_t *_data
+ *                          Bytes written.
+ * @param                   size_t _n
+ *                          Number of bytes.
+ */
+void RfidCapture::tx(const uint8_t *_data, size_t _n)
+{
+    if (!capturing(RFID_CAPTURE_UART))
+        return;
+
+    while (_n)
+    {
+        uint8_t _chunk = _n < RFID_CAPTURE_MAX_DATA ? _n : RFID_CAPTURE_MAX_DATA;
+        uint8_t _buffer[8 + RFID_CAPTURE_MAX_DATA];
+        uint8_t _length = stamp(_buffer, RFID_CAPTURE_TX);
+
+        _buffer[_length++] = _chunk;
+        memcpy(_buffer + _length, _data, _chunk);
+        put(_buffer, _length + _chunk);
+
+        _data += _chunk;
+        _n -= _chunk;
+    }
+}
+
+/**
+ * @brief                   Records the write to the easyC address.
+ *
+ * @param                   const uint8_t *_data
+ *                          Bytes written (the register address), NULL for the ping.
+ * @param                   uint8_t _n
+ *                          Number of bytes (up to RFID_CAPTURE_MAX_DATA).
+ * @param                   uint8_t _error
+ *                          Result of Wire.endTransmission().
+ */
+void RfidCapture::i2cWrite(const uint8_t *_data, uint8_t _n, uint8_t _error)
+{
+    if (!capturing(RFID_CAPTURE_EASYC))
+        return;
+
+    if (_n > RFID_CAPTURE_MAX_DATA)
+        _n = RFID_CAPTURE_MAX_DATA;
+
+    uint8_t _buffer[9 + RFID_CAPTURE_MAX_DATA];
+    uint8_t _length = stamp(_buffer, RFID_CAPTURE_I2C_WRITE);
+    _buffer[_length++] = _n;
+    if (_n)
+        memcpy(_buffer + _length, _data, _n);
+    _length += _n;
+    _buffer[_length++] = _error;
+    put(_buffer, _length);
+}
+
+/**
+ * @brief                   Records the bytes read from the easyC address.
+ *
+ * @param                   const uint8_t *_data
+ *                          Bytes read.
+ * @param                   uint8_t _n
+ *                          Number of bytes (up to RFID_CAPTURE_MAX_DATA).
+ */
+void RfidCapture::i2cRead(const uint8_t *_data, uint8_t _n)
+{
+    if (!capturing(RFID_CAPTURE_EASYC))
+        return;
+
+    if (_n > RFID_CAPTURE_MAX_DATA)
+        _n = RFID_CAPTURE_MAX_DATA;
+
+    uint8_t _buffer[8 + RFID_CAPTURE_MAX_DATA];
+    uint8_t _length = stamp(_buffer, RFID_CAPTURE_I2C_READ);
+    _buffer[_length++] = _n;
+    memcpy(_buffer + _length, _data, _n);
+    put(_buffer, _length + _n);
+}
+
+/**
+ * @brief                   Records the edge on the software serial RX pin.
+ *
+ * @param                   uint32_t _isrCycle
+ *                          ISR timestamp in CPU cycles, the level after the edge in bit 0 (as stored by the software
+ *                          serial ISR).
+ */
+void RfidCapture::edge(uint32_t _isrCycle)
+{
+    if (!capturing(RFID_CAPTURE_EDGES))
+        return;
+
+    uint8_t _buffer[8];
+    uint8_t _n = start(_buffer, RFID_CAPTURE_EDGE, _isrCycle - lastEdge);
+    lastEdge = _isrCycle;
+    put(_buffer, _n);
+}
+
+/**
+ * @brief                   Records the tag ID returned by the reader, so the replay can be checked against it.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ */
+void RfidCapture::tag(uint32_t _id)
+{
+    if (!out)
+        return;
+
+    uint8_t _buffer[10];
+    uint8_t _n = stamp(_buffer, RFID_CAPTURE_TAG);
+    memcpy(_buffer + _n, &_id, 4);
+    put(_buffer, _n + 4);
+}
+
+/**
+ * @brief                   Gets the number of records written since begin().
+ *
+ * @return                  uint32_t - Records.
+ */
+uint32_t RfidCapture::records()
+{
+    return recordCount;
+}
+
+/**
+ * @brief                   Gets the number of bytes written since begin(), with the header.
+ *
+ * @return                  uint32_t - Bytes.
+ */
+uint32_t RfidCapture::bytes()
+{
+    return byteCount;
+}
+
+/**
+ * @brief                   Gets the number of records the Print did not take completely (the capture is corrupted
+ *                          from the first one on).
+ *
+ * @return                  uint32_t - Records not written.
+ */
+uint32_t RfidCapture::errors()
+{
+    return errorCount;
+}
+
+/**
+ * @brief                   Encodes the first byte of the record and the time delta.
+ *
+ * @param                   uint8_t *_buffer
+ *                          Buffer for the record, at least 6 bytes.
+ * @param                   uint8_t _type
+ *                          Record type.
+ * @param                   uint32_t _delta
+ *                          Time delta.
+ *
+ * @return                  uint8_t - Number of bytes used.
+ */
+uint8_t RfidCapture::start(uint8_t *_buffer, uint8_t _type, uint32_t _delta)
+{
+    uint8_t _n = 0;
+    uint32_t _rest = _delta >> 4;
+
+    _buffer[_n++] = _type | ((_delta & 0x0F) << 4) | (_rest ? 0x08 : 0);
+    while (_rest)
+    {
+        _buffer[_n++] = (_rest & 0x7F) | (_rest > 0x7F ? 0x80 : 0);
+        _rest >>= 7;
+    }
+
+    return _n;
+}
+
+/**
+ * @brief                   Encodes the first byte of the record with the time from the previous record.
+ *
+ * @param                   uint8_t *_buffer
+ *                          Buffer for the record, at least 6 bytes.
+ * @param                   uint8_t _type
+ *                          Record type.
+ *
+ * @return                  uint8_t - Number of bytes used.
+ */
+uint8_t RfidCapture::stamp(uint8_t *_buffer, uint8_t _type)
+{
+    uint32_t _now = micros();
+    uint32_t _delta = _now - lastMicros;
+    lastMicros = _now;
+
+    return start(_buffer, _type, _delta);
+}
+
+/**
+ * @brief                   Writes the record to the output.
+ *
+ * @param                   const uint8_t *_buffer
+ *                          Record.
+ * @param                   uint8_t _n
+ *                          Size of the record.
+ */
+void RfidCapture::put(const uint8_t *_buffer, uint8_t _n)
+{
+    size_t _written = out->write(_buffer, _n);
+
+    byteCount += _written;
+    recordCount++;
+    if (_written != _n)
+        errorCount++;
+}
+
+/**
+ * @brief                   Starts reading the capture.
+ *
+ * @param                   const uint8_t *_data
+ *                          Capture, with the header.
+ * @param                   size_t _n
+ *                          Size of the capture in bytes.
+ *
+ * @return                  bool - True if the header is valid.
+ */
+bool RfidCaptureReader::begin(const uint8_t *_data, size_t _n)
+{
+    data = NULL;
+    size = 0;
+
+    if (!_data || _n < sizeof(RfidCaptureHeader))
+        return false;
+
+    memcpy(&head, _data, sizeof(head));
+    if (head.magic != RFID_CAPTURE_MAGIC || head.version != RFID_CAPTURE_VERSION)
+        return false;
+
+    data = _data;
+    size = _n;
+    rewind();
+
+    return true;
+}
+
+/**
+ * @brief                   Gets the header of the capture.
+ *
+ * @return                  const RfidCaptureHeader & - Header (valid after begin() returned true).
+ */
+const RfidCaptureHeader &RfidCaptureReader::header()
+{
+    return head;
+}
+
+/**
+ * @brief                   Reads the next record.
+ *
+ * @param                   RfidCaptureRecord *_record
+ *                          Record read.
+ *
+ * @return                  bool - True if read, false at the end of the capture or if the last record is cut off.
+ */
+bool RfidCaptureReader::next(RfidCaptureRecord *_record)
+{
+    uint8_t _first;
+    if (!getByte(&_first))
+        return false;
+
+    // Time delta, the low 4 bits in the first byte, the rest in LEB128.
+    uint32_t _delta = _first >> 4;
+    if (_first & 0x08)
+    {
+        uint8_t _byte;
+        uint8_t _shift = 4;
+        do
+        {
+            if (_shift > 25 || !getByte(&_byte))
+                return false;
+            _delta |= (uint32_t)(_byte & 0x7F) << _shift;
+            _shift += 7;
+        } while (_byte & 0x80);
+    }
+
+    _record->type = _first & 0x07;
+    _record->length = 0;
+    _record->error = 0;
+
+    switch (_record->type)
+    {
+    case RFID_CAPTURE_RX:
+        time += _delta;
+        _record->length = 1;
+        if (!getByte(&_record->data[0]))
+            return false;
+        break;
+
+    case RFID_CAPTURE_TAG:
+        time += _delta;
+        _record->length = 4;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            if (!getByte(&_record->data[i]))
+                return false;
+        }
+        break;
+
+    case RFID_CAPTURE_TX:
+    case RFID_CAPTURE_I2C_WRITE:
+    case RFID_CAPTURE_I2C_READ:
+        time += _delta;
+        if (!getByte(&_record->length) || _record->length > RFID_CAPTURE_MAX_DATA)
+            return false;
+        for (uint8_t i = 0; i < _record->length; i++)
+        {
+            if (!getByte(&_record->data[i]))
+                return false;
+        }
+        if (_record->type == RFID_CAPTURE_I2C_WRITE && !getByte(&_record->error))
+            return false;
+        break;
+
+    case RFID_CAPTURE_EDGE:
+    {
+        // Edge times start at the first edge, bit 0 of the timestamp is the level, not the time.
+        uint32_t _isrCycle = lastEdge + _delta;
+        if (!firstEdge)
+            edgeTime += (uint32_t)((_isrCycle | 1) - (lastEdge | 1));
+        firstEdge = false;
+        lastEdge = _isrCycle;
+
+        _record->time = edgeTime;
+        _record->length = 1;
+        _record->data[0] = _isrCycle & 1;
+        return true;
+    }
+
+    default:
+        return false;
+    }
+
+    _record->time = time;
+    return true;
+}
+
+/**
+ * @brief                   Goes back to the first record.
+ */
+void RfidCaptureReader::rewind()
+{
+    position = sizeof(RfidCaptureHeader);
+    time = 0;
+    edgeTime = 0;
+    lastEdge = 0;
+    firstEdge = true;
+}
+
+/**
+ * @brief                   Gets the next byte of the capture.
+ *
+ * @param                   uint8_t *_byte
+ *                          Byte read.
+ *
+ * @return                  bool - False at the end of the capture.
+ */
+bool RfidCaptureReader::getByte(uint8_t *_byte)
+{
+    if (!data || position >= size)
+        return false;
+
+    *_byte = data[position++];
+    return true;
+}
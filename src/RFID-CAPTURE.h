@@ -0,0 +1,160 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-CAPTURE.h
+ * @brief       Header file for the capture of the reader traffic (UART bytes, easyC transactions and software serial
+ *              edges) in a compact binary format, to replay it later.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_CAPTURE__
+#define __RFID_CAPTURE__
+
+#include "Arduino.h"
+
+// Capture magic ("RFCP" in little endian) and format version.
+#define RFID_CAPTURE_MAGIC   0x50434652UL
+#define RFID_CAPTURE_VERSION 1
+
+// Traffic to capture (sources in the header).
+#define RFID_CAPTURE_UART  0x01
+#define RFID_CAPTURE_EASYC 0x02
+#define RFID_CAPTURE_EDGES 0x04
+#define RFID_CAPTURE_ALL   0x07
+
+// Record types.
+#define RFID_CAPTURE_RX        1
+#define RFID_CAPTURE_TX        2
+#define RFID_CAPTURE_I2C_WRITE 3
+#define RFID_CAPTURE_I2C_READ  4
+#define RFID_CAPTURE_EDGE      5
+#define RFID_CAPTURE_TAG       6
+
+// Longest data of one record, longer TX data is split into more records.
+#define RFID_CAPTURE_MAX_DATA 16
+
+/**
+ * Capture header, written once at the start. All fields are little endian.
+ *
+ *      uint32_t magic          RFID_CAPTURE_MAGIC
+ *      uint8_t version         RFID_CAPTURE_VERSION
+ *      uint8_t sources         RFID_CAPTURE_UART, RFID_CAPTURE_EASYC and RFID_CAPTURE_EDGES that were captured
+ *      uint8_t native          1 for UART, 0 for easyC
+ *      uint8_t address         easyC address
+ *      uint32_t baud           UART baud rate (0 if not known, for the Stream given to the reader)
+ *      uint16_t cpuMhz         Clock of the edge timestamps in MHz (0 if there are no edges)
+ *      uint16_t reserved       0
+ *
+ * Header is followed by the records. The first byte of the record holds the type in bits 0 - 2 and the low 4 bits of
+ * the time delta in bits 4 - 7. If bit 3 is set, the rest of the delta follows as LEB128 (7 bits per byte, low bits
+ * first, bit 7 set if more bytes follow). Delta is the time from the previous record in microseconds, or for the edge
+ * records the difference of the ISR timestamps in CPU cycles (modulo 2^32). Then comes the data of the record:
+ *
+ *      RFID_CAPTURE_RX         uint8_t byte                    Byte read from the UART
+ *      RFID_CAPTURE_TX         uint8_t n, uint8_t data[n]      Bytes written to the UART
+ *      RFID_CAPTURE_I2C_WRITE  uint8_t n, uint8_t data[n]      Write to the easyC address (n is 0 for the ping and
+ *                              uint8_t error                   1 for the register address), endTransmission() result
+ *      RFID_CAPTURE_I2C_READ   uint8_t n, uint8_t data[n]      Bytes read from the easyC address
+ *      RFID_CAPTURE_EDGE       -                               The level after the edge is bit 0 of the timestamp
+ *      RFID_CAPTURE_TAG        uint32_t id                     Tag ID returned by Rfid::getId() (always recorded)
+ */
+struct __attribute__((packed)) RfidCaptureHeader
+{
+    uint32_t magic;
+    uint8_t version;
+    uint8_t sources;
+    uint8_t native;
+    uint8_t address;
+    uint32_t baud;
+    uint16_t cpuMhz;
+    uint16_t reserved;
+};
+
+// One record, as returned by RfidCaptureReader.
+struct RfidCaptureRecord
+{
+    // RFID_CAPTURE_RX, RFID_CAPTURE_TX, ...
+    uint8_t type;
+
+    // Time from the start of the capture, in microseconds (in CPU cycles for the edges).
+    uint64_t time;
+
+    // Data of the record (the byte for RX, the level for the edge, the tag ID for the tag).
+    uint8_t length;
+    uint8_t data[RFID_CAPTURE_MAX_DATA];
+
+    // endTransmission() result of the I2C write.
+    uint8_t error;
+};
+
+/**
+ * Capture of the reader traffic. Attach it to the reader with Rfid::setCapture(), the records are written to the Print
+ * as they happen: to Serial, to a file on the SD card (File is a Print) or to a file on Linux. Edges are the ISR
+ * timestamps of the software serial on ESP32, taken as the serial decodes them.
+ */
+class RfidCapture
+{
+  public:
+    void begin(Print &_out, uint8_t _sources = RFID_CAPTURE_UART | RFID_CAPTURE_EASYC);
+    void end();
+    bool capturing(uint8_t _source);
+    void header(bool _native, uint32_t _baud, uint8_t _address, uint16_t _cpuMhz);
+    void rx(uint8_t _byte);
+    void tx(const uint8_t *_data, size_t _n);
+    void i2cWrite(const uint8_t *_data, uint8_t _n, uint8_t _error);
+    void i2cRead(const uint8_t *_data, uint8_t _n);
+    void edge(uint32_t _isrCycle);
+    void tag(uint32_t _id);
+    uint32_t records();
+    uint32_t bytes();
+    uint32_t errors();
+
+  private:
+    uint8_t start(uint8_t *_buffer, uint8_t _type, uint32_t _delta);
+    uint8_t stamp(uint8_t *_buffer, uint8_t _type);
+    void put(const uint8_t *_buffer, uint8_t _n);
+
+    // Output of the records, NULL if not capturing.
+    Print *out = NULL;
+    uint8_t sources = 0;
+
+    // Time of the last record (micros()) and the last edge timestamp (CPU cycles).
+    uint32_t lastMicros = 0;
+    uint32_t lastEdge = 0;
+
+    // Records and bytes written, and the records that did not fit into the Print.
+    uint32_t recordCount = 0;
+    uint32_t byteCount = 0;
+    uint32_t errorCount = 0;
+};
+
+/**
+ * Reads the records of the capture in memory (for example a file loaded on Linux, or a capture in the flash).
+ */
+class RfidCaptureReader
+{
+  public:
+    bool begin(const uint8_t *_data, size_t _n);
+    const RfidCaptureHeader &header();
+    bool next(RfidCaptureRecord *_record);
+    void rewind();
+
+  private:
+    bool getByte(uint8_t *_byte);
+
+    const uint8_t *data = NULL;
+    size_t size = 0;
+    size_t position = 0;
+    RfidCaptureHeader head = RfidCaptureHeader();
+
+    // Time of the last record (microseconds) and the last edge (CPU cycles) from the start of the capture.
+    uint64_t time = 0;
+    uint64_t edgeTime = 0;
+    uint32_t lastEdge = 0;
+    bool firstEdge = true;
+};
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-DEDUP.cpp
+ * @brief       Time-windowed duplicate tag suppression cache functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-DEDUP.h"
+
+/**
+ * @brief                   Duplicate suppression cache constructor.
+ *
+ * @param                   RfidDedupEntry *_entries
+ *                          Storage for the cache entries.
+ * @param                   uint8_t _size
+ *                          Number of entries, must be power of 2.
+ */
+RfidDedup::RfidDedup(RfidDedupEntry *_entries, uint8_t _size)
+{
+    entries = _entries;
+    mask = _size - 1;
+    clear();
+}
+
+/**
+ * @brief                   Sets the hold-off and re-arm windows.
+ *
+ * @param                   uint32_t _holdOffMs
+ *                          Time in milliseconds after the last report after which the tag that stays on the antenna
+ *                          is reported again. 0 means it's never reported again while it stays on the antenna.
+ * @param                   uint32_t _rearmMs
+ *                          Time in milliseconds without seeing the tag after which it's reported again as a new read.
+ */
+void RfidDedup::setWindows(uint32_t _holdOffMs, uint32_t _rearmMs)
+{
+    holdOffMs = _holdOffMs;
+    rearmMs = _rearmMs;
+}
+
+/**
+ * @brief                   Records the tag read and checks if it should be reported.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ * @param                   uint32_t _now
+ *                          Current time in milliseconds (millis()).
+ *
+ * @return                  bool - True if the read should be reported, false if it's a duplicate.
+ */
+bool RfidDedup::check(uint32_t _id, uint32_t _now)
+{
+    // Entry that will be used if the tag is not in the cache.
+    RfidDedupEntry *_victim = NULL;
+
+    uint8_t _index = hash(_id);
+    for (uint8_t i = 0; i < RFID_DEDUP_MAX_PROBE && i <= mask; i++)
+    {
+        RfidDedupEntry *_entry = &entries[(_index + i) & mask];
+
+        if (_entry->id == _id)
+        {
+            // Tag is in the cache. Report it if it's been away long enough or if the hold-off window passed.
+            bool _report = ((uint32_t)(_now - _entry->lastSeen) >= rearmMs) ||
+                           (holdOffMs && (uint32_t)(_now - _entry->lastReported) >= holdOffMs);
+
+            _entry->lastSeen = _now;
+            if (_report)
+                _entry->lastReported = _now;
+
+            return _report;
+        }
+
+        // Keep the first empty entry, otherwise the entry seen the longest time ago (expired entries are always older
+        // than the live ones).
+        if (!_victim || (_victim->id && (!_entry->id || (uint32_t)(_now - _entry->lastSeen) >
+                                                             (uint32_t)(_now - _victim->lastSeen))))
+            _victim = _entry;
+    }
+
+    // New tag (or the one that was evicted), always report it.
+    _victim->id = _id;
+    _victim->lastSeen = _now;
+    _victim->lastReported = _now;
+
+    return true;
+}
+
+/**
+ * @brief                   Removes all tags from the cache.
+ */
+void RfidDedup::clear()
+{
+    for (uint16_t i = 0; i <= mask; i++)
+    {
+        entries[i].id = 0;
+    }
+}
+
+/**
+ * @brief                   Calculates the cache index for the tag ID (multiplicative hash).
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ *
+ * @return                  uint8_t - Index of the first entry to search.
+ */
+uint8_t RfidDedup::hash(uint32_t _id)
+{
+    // 32 bit product on every platform, so the tag takes the same place everywhere.
+    return (uint8_t)((uint32_t)(_id * 2654435761UL) >> 24) & mask;
+}
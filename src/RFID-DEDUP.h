@@ -0,0 +1,73 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-DEDUP.h
+ * @brief       Header file for the time-windowed duplicate tag suppression cache.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_DEDUP__
+#define __RFID_DEDUP__
+
+#include "Arduino.h"
+
+// How many slots from the hashed position are searched for the tag. Keeps the lookup O(1) for any cache size.
+#define RFID_DEDUP_MAX_PROBE 4
+
+// One cache entry. Tag ID 0 marks an empty entry (tag ID 0 is never reported by Rfid).
+struct RfidDedupEntry
+{
+    uint32_t id;
+    uint32_t lastSeen;
+    uint32_t lastReported;
+};
+
+/**
+ * Fixed size, open-addressed cache of recently seen tag IDs. Use RfidDedupCache<N> to get the cache with the storage.
+ *
+ * A tag is reported when it is not in the cache, when it was not seen for the re-arm window (it left the antenna and
+ * came back), or, if hold-off window is not 0, when the hold-off window passed since it was last reported while it
+ * stays on the antenna. All other reads of the same tag are dropped.
+ */
+class RfidDedup
+{
+  public:
+    RfidDedup(RfidDedupEntry *_entries, uint8_t _size);
+    void setWindows(uint32_t _holdOffMs, uint32_t _rearmMs);
+    bool check(uint32_t _id, uint32_t _now);
+    void clear();
+
+  private:
+    uint8_t hash(uint32_t _id);
+
+    // Cache entries and the mask for the index (size of the cache is power of 2).
+    RfidDedupEntry *entries;
+    uint8_t mask;
+
+    // Time after the last report after which the tag present on the antenna is reported again. 0 means never.
+    uint32_t holdOffMs = 0;
+
+    // Time without seeing the tag after which it's reported again as a new read.
+    uint32_t rearmMs = 1000;
+};
+
+/**
+ * Duplicate suppression cache with the storage for N tags. N must be power of 2, up to 128.
+ */
+template <uint8_t N> class RfidDedupCache : public RfidDedup
+{
+    static_assert(N && !(N & (N - 1)) && N <= 128, "RfidDedupCache size must be power of 2, up to 128");
+
+  public:
+    RfidDedupCache() : RfidDedup(storage, N)
+    {
+    }
+
+  private:
+    RfidDedupEntry storage[N];
+};
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-EM4100.cpp
+ * @brief       EM4100 frame decoder and validator functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-EM4100.h"
+
+// Header of the EM4100 frame, nine 1s in the bits 63..55.
+#define EM4100_HEADER      0x1FF
+#define EM4100_HEADER_SHIFT 55
+
+// Parity lookup table for the 5 bit rows (4 data bits and a parity bit). Bit n is set if n has an odd number of
+// ones, so a row with a valid even parity always looks up a 0.
+#define EM4100_ROW_PARITY_TABLE 0x96696996UL
+
+/**
+ * @brief                   Decodes and validates the EM4100 frame.
+ *
+ * @param                   uint64_t _raw
+ *                          64 bit RAW RFID data (the same as returned by Rfid::getRaw()).
+ * @param                   uint8_t *_version
+ *                          Pointer to the variable for the version / customer byte. Can be NULL.
+ * @param                   uint32_t *_id
+ *                          Pointer to the variable for the 32 bit tag ID. Can be NULL.
+ *
+ * @return                  bool - True if header, all row and column parities and the stop bit are valid, false if
+ *                          not.
+ */
+bool Em4100::decode(uint64_t _raw, uint8_t *_version, uint32_t *_id)
+{
+    // Check the header and the stop bit first, it rejects most of the garbage.
+    if ((uint16_t)(_raw >> EM4100_HEADER_SHIFT) != EM4100_HEADER || (_raw & 1))
+        return false;
+
+    // Column parity bits, every data nibble is XOR-ed into it, so it must end up at zero.
+    uint8_t _columns = (_raw >> 1) & 0x0F;
+
+    // Drop the column parity and the stop bit, so the last row is at the bottom.
+    uint64_t _rows = _raw >> 5;
+
+    // Go trough the rows from the last one to the first one, one 5 bit row at the time.
+    uint32_t _tagId = 0;
+    uint8_t _tagVersion = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        uint8_t _row = _rows & 0x1F;
+        _rows >>= 5;
+
+        // Look up the row parity.
+        if ((EM4100_ROW_PARITY_TABLE >> _row) & 1)
+            return false;
+
+        uint8_t _nibble = _row >> 1;
+        _columns ^= _nibble;
+
+        // Rows 9 to 2 (first 8 rows from the bottom) are tag ID, rows 1 and 0 are the version / customer byte.
+        if (i < 8)
+            _tagId |= (uint32_t)_nibble << (4 * i);
+        else
+            _tagVersion |= _nibble << (4 * (i - 8));
+    }
+
+    // Check the column parity.
+    if (_columns)
+        return false;
+
+    if (_version)
+        *_version = _tagVersion;
+    if (_id)
+        *_id = _tagId;
+
+    return true;
+}
+
+/**
+ * @brief                   Validates the EM4100 frame and checks if it holds the expected tag ID.
+ *
+ * @param                   uint64_t _raw
+ *                          64 bit RAW RFID data.
+ * @param                   uint32_t _id
+ *                          Tag ID reported by the breakout.
+ *
+ * @return                  bool - True if the frame is valid and it holds the same tag ID, false if not.
+ */
+bool Em4100::validate(uint64_t _raw, uint32_t _id)
+{
+    uint32_t _decodedId;
+    return decode(_raw, NULL, &_decodedId) && (_decodedId == _id);
+}
+
+/**
+ * @brief                   Builds the EM4100 frame with the header, all parity bits and the stop bit.
+ *
+ * @param                   uint8_t _version
+ *                          Version / customer byte.
+ * @param                   uint32_t _id
+ *                          32 bit tag ID.
+ *
+ * @return                  uint64_t - 64 bit EM4100 frame.
+ */
+uint64_t Em4100::encode(uint8_t _version, uint32_t _id)
+{
+    // Start with the header.
+    uint64_t _raw = EM4100_HEADER;
+    uint8_t _columns = 0;
+
+    // Append the rows from the first one (version high nibble) to the last one (tag ID low nibble).
+    for (int i = 0; i < 10; i++)
+    {
+        uint8_t _nibble = (i < 2) ? (_version >> (4 * (1 - i))) & 0x0F : (_id >> (4 * (9 - i))) & 0x0F;
+        _columns ^= _nibble;
+        _raw = (_raw << 5) | (_nibble << 1) | ((EM4100_ROW_PARITY_TABLE >> (_nibble << 1)) & 1);
+    }
+
+    // Append the column parity and the stop bit.
+    return (_raw << 5) | (_columns << 1);
+}
@@ -0,0 +1,34 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-EM4100.h
+ * @brief       Header file for the EM4100 frame decoder and validator.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_EM4100__
+#define __RFID_EM4100__
+
+#include "Arduino.h"
+
+/**
+ * EM4100 64 bit frame, MSB first, as returned by Rfid::getRaw():
+ *
+ *      bits 63..55     Header, nine 1s.
+ *      bits 54..5      10 rows of 4 data bits (MSB first) followed by an even row parity bit.
+ *                      Rows 0 and 1 hold the version / customer byte, rows 2 to 9 the 32 bit tag ID.
+ *      bits 4..1       Even column parity over the data bits of all 10 rows.
+ *      bit 0           Stop bit, always 0.
+ */
+class Em4100
+{
+  public:
+    static bool decode(uint64_t _raw, uint8_t *_version, uint32_t *_id);
+    static bool validate(uint64_t _raw, uint32_t _id);
+    static uint64_t encode(uint8_t _version, uint32_t _id);
+};
+
+#endif
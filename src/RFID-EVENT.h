@@ -0,0 +1,41 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-EVENT.h
+ * @brief       Tag read event shared by the RFID library components.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_EVENT__
+#define __RFID_EVENT__
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+// One tag read.
+struct TagEvent
+{
+    // Tag ID (as returned by Rfid::getId()).
+    uint32_t id;
+
+    // Time of the read in milliseconds (millis()).
+    uint32_t timestamp;
+
+    // RAW RFID data (as returned by Rfid::getRaw()).
+    uint64_t raw;
+
+    // Index of the reader that read the tag, for the applications with more than one reader.
+    uint8_t reader;
+
+    // Application specific flags (for example access granted / denied).
+    uint8_t flags;
+};
+
+#endif
@@ -0,0 +1,260 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-FORMAT.cpp
+ * @brief       Allocation-free tag ID formatter functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-FORMAT.h"
+
+// Two ASCII digits for each number from 0 to 99.
+static const char digitPairs[200] PROGMEM = {
+    '0', '0', '0', '1', '0', '2', '0', '3', '0', '4', '0', '5', '0', '6', '0', '7', '0', '8', '0', '9',
+    '1', '0', '1', '1', '1', '2', '1', '3', '1', '4', '1', '5', '1', '6', '1', '7', '1', '8', '1', '9',
+    '2', '0', '2', '1', '2', '2', '2', '3', '2', '4', '2', '5', '2', '6', '2', '7', '2', '8', '2', '9',
+    '3', '0', '3', '1', '3', '2', '3', '3', '3', '4', '3', '5', '3', '6', '3', '7', '3', '8', '3', '9',
+    '4', '0', '4', '1', '4', '2', '4', '3', '4', '4', '4', '5', '4', '6', '4', '7', '4', '8', '4', '9',
+    '5', '0', '5', '1', '5', '2', '5', '3', '5', '4', '5', '5', '5', '6', '5', '7', '5', '8', '5', '9',
+    '6', '0', '6', '1', '6', '2', '6', '3', '6', '4', '6', '5', '6', '6', '6', '7', '6', '8', '6', '9',
+    '7', '0', '7', '1', '7', '2', '7', '3', '7', '4', '7', '5', '7', '6', '7', '7', '7', '8', '7', '9',
+    '8', '0', '8', '1', '8', '2', '8', '3', '8', '4', '8', '5', '8', '6', '8', '7', '8', '8', '8', '9',
+    '9', '0', '9', '1', '9', '2', '9', '3', '9', '4', '9', '5', '9', '6', '9', '7', '9', '8', '9', '9',
+};
+
+// HEX digit for each nibble.
+static const char hexDigits[16] PROGMEM = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                           '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+
+/**
+ * @brief                   Formats the number as zero-padded HEX.
+ *
+ * @param                   uint64_t _value
+ *                          Number to format (for example RFID RAW data).
+ * @param                   char *_buf
+ *                          Buffer for _digits chars and the null-terminating char (RFID_FORMAT_HEX64_SIZE is enough).
+ * @param                   uint8_t _digits
+ *                          Number of HEX digits (1 - 16), higher digits are cut off.
+ *
+ * @return                  uint8_t - Number of chars written (without the null-terminating char).
+ */
+uint8_t RfidFormat::hex64(uint64_t _value, char *_buf, uint8_t _digits)
+{
+    if (_digits > 16)
+        _digits = 16;
+
+    // Low half first, so 32 bit MCUs shift 64 bit number only once.
+    uint32_t _part = (uint32_t)_value;
+    for (uint8_t i = 0; i < _digits; i++)
+    {
+        if (i == 8)
+            _part = (uint32_t)(_value >> 32);
+
+        _buf[_digits - 1 - i] = pgm_read_byte(&hexDigits[_part & 0x0F]);
+        _part >>= 4;
+    }
+    _buf[_digits] = '\0';
+
+    return _digits;
+}
+
+/**
+ * @brief                   Formats the number as decimal (Arduino Print can't print 64 bit numbers).
+ *
+ * @param                   uint64_t _value
+ *                          Number to format.
+ * @param                   char *_buf
+ *                          Buffer of at least RFID_FORMAT_DECIMAL64_SIZE chars.
+ *
+ * @return                  uint8_t - Number of chars written (without the null-terminating char).
+ */
+uint8_t RfidFormat::decimal64(uint64_t _value, char *_buf)
+{
+    // Digits are made from the end.
+    char _temp[20];
+    uint8_t _pos = sizeof(_temp);
+
+    // Only the 8 digit chunks need the 64 bit division (at most twice), the rest is done in 32 bits.
+    while (_value >= 100000000ULL)
+    {
+        uint64_t _q = _value / 100000000ULL;
+        uint32_t _chunk = (uint32_t)(_value - _q * 100000000ULL);
+        _value = _q;
+
+        _pos -= 8;
+        padded(_chunk, &_temp[_pos], 8);
+    }
+
+    uint32_t _rest = (uint32_t)_value;
+    while (_rest >= 100)
+    {
+        _pos -= 2;
+        pair(_rest % 100, &_temp[_pos]);
+        _rest /= 100;
+    }
+
+    if (_rest >= 10)
+    {
+        _pos -= 2;
+        pair(_rest, &_temp[_pos]);
+    }
+    else
+    {
+        _temp[--_pos] = '0' + _rest;
+    }
+
+    uint8_t _len = sizeof(_temp) - _pos;
+    for (uint8_t i = 0; i < _len; i++)
+        _buf[i] = _temp[_pos + i];
+    _buf[_len] = '\0';
+
+    return _len;
+}
+
+/**
+ * @brief                   Formats the Wiegand 26 fields of the tag ID as "FFF,CCCCC" (facility code, card number).
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID (as returned by Rfid::getId()).
+ * @param                   char *_buf
+ *                          Buffer of at least RFID_FORMAT_WIEGAND_SIZE chars.
+ *
+ * @return                  uint8_t - Number of chars written (without the null-terminating char).
+ */
+uint8_t RfidFormat::wiegand26(uint32_t _id, char *_buf)
+{
+    padded((_id >> 16) & 0xFF, _buf, 3);
+    _buf[3] = ',';
+    padded(_id & 0xFFFF, &_buf[4], 5);
+    _buf[9] = '\0';
+
+    return 9;
+}
+
+/**
+ * @brief                   Formats the Wiegand 34 fields of the tag ID as "FFFFF,CCCCC" (facility code, card number).
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID (as returned by Rfid::getId()).
+ * @param                   char *_buf
+ *                          Buffer of at least RFID_FORMAT_WIEGAND_SIZE chars.
+ *
+ * @return                  uint8_t - Number of chars written (without the null-terminating char).
+ */
+uint8_t RfidFormat::wiegand34(uint32_t _id, char *_buf)
+{
+    padded(_id >> 16, _buf, 5);
+    _buf[5] = ',';
+    padded(_id & 0xFFFF, &_buf[6], 5);
+    _buf[11] = '\0';
+
+    return 11;
+}
+
+#ifdef ARDUINO
+/**
+ * @brief                   Prints the number as zero-padded HEX.
+ *
+ * @param                   Print &_out
+ *                          Where to print (for example Serial).
+ * @param                   uint64_t _value
+ *                          Number to print.
+ * @param                   uint8_t _digits
+ *                          Number of HEX digits (1 - 16).
+ *
+ * @return                  size_t - Number of bytes printed.
+ */
+size_t RfidFormat::printHex64(Print &_out, uint64_t _value, uint8_t _digits)
+{
+    char _buf[RFID_FORMAT_HEX64_SIZE];
+    return _out.write((const uint8_t *)_buf, hex64(_value, _buf, _digits));
+}
+
+/**
+ * @brief                   Prints the number as decimal.
+ *
+ * @param                   Print &_out
+ *                          Where to print (for example Serial).
+ * @param                   uint64_t _value
+ *                          Number to print.
+ *
+ * @return                  size_t - Number of bytes printed.
+ */
+size_t RfidFormat::printDecimal64(Print &_out, uint64_t _value)
+{
+    char _buf[RFID_FORMAT_DECIMAL64_SIZE];
+    return _out.write((const uint8_t *)_buf, decimal64(_value, _buf));
+}
+
+/**
+ * @brief                   Prints the Wiegand 26 fields of the tag ID.
+ *
+ * @param                   Print &_out
+ *                          Where to print (for example Serial).
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ *
+ * @return                  size_t - Number of bytes printed.
+ */
+size_t RfidFormat::printWiegand26(Print &_out, uint32_t _id)
+{
+    char _buf[RFID_FORMAT_WIEGAND_SIZE];
+    return _out.write((const uint8_t *)_buf, wiegand26(_id, _buf));
+}
+
+/**
+ * @brief                   Prints the Wiegand 34 fields of the tag ID.
+ *
+ * @param                   Print &_out
+ *                          Where to print (for example Serial).
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ *
+ * @return                  size_t - Number of bytes printed.
+ */
+size_t RfidFormat::printWiegand34(Print &_out, uint32_t _id)
+{
+    char _buf[RFID_FORMAT_WIEGAND_SIZE];
+    return _out.write((const uint8_t *)_buf, wiegand34(_id, _buf));
+}
+#endif
+
+/**
+ * @brief                   Writes two decimal digits.
+ *
+ * @param                   uint8_t _n
+ *                          Number from 0 to 99.
+ * @param                   char *_out
+ *                          Where to write the two digits.
+ */
+void RfidFormat::pair(uint8_t _n, char *_out)
+{
+    _out[0] = pgm_read_byte(&digitPairs[2 * _n]);
+    _out[1] = pgm_read_byte(&digitPairs[2 * _n + 1]);
+}
+
+/**
+ * @brief                   Writes the number as zero-padded decimal, higher digits are cut off.
+ *
+ * @param                   uint32_t _value
+ *                          Number to write.
+ * @param                   char *_out
+ *                          Where to write the digits.
+ * @param                   uint8_t _digits
+ *                          Number of digits.
+ */
+void RfidFormat::padded(uint32_t _value, char *_out, uint8_t _digits)
+{
+    while (_digits >= 2)
+    {
+        _digits -= 2;
+        pair(_value % 100, &_out[_digits]);
+        _value /= 100;
+    }
+
+    if (_digits)
+        _out[0] = '0' + _value % 10;
+}
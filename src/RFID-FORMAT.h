@@ -0,0 +1,55 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-FORMAT.h
+ * @brief       Header file for the allocation-free tag ID formatter.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_FORMAT__
+#define __RFID_FORMAT__
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include <stddef.h>
+#include <stdint.h>
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
+
+// Buffer sizes (with the null-terminating char) needed for each format.
+#define RFID_FORMAT_HEX64_SIZE      17
+#define RFID_FORMAT_DECIMAL64_SIZE  21
+#define RFID_FORMAT_WIEGAND_SIZE    12
+
+/**
+ * Formats tag IDs and RAW data into the caller's buffer or into any Print (Serial, network client...). Nothing is
+ * allocated, numbers are converted two decimal digits at a time from the precomputed digit pair table.
+ *
+ * Wiegand fields are taken from the low bits of the tag ID: 8 bit facility code and 16 bit card number for Wiegand 26
+ * ("123,45678"), 16 bit facility code and 16 bit card number for Wiegand 34 ("01234,45678").
+ */
+class RfidFormat
+{
+  public:
+    static uint8_t hex64(uint64_t _value, char *_buf, uint8_t _digits = 16);
+    static uint8_t decimal64(uint64_t _value, char *_buf);
+    static uint8_t wiegand26(uint32_t _id, char *_buf);
+    static uint8_t wiegand34(uint32_t _id, char *_buf);
+#ifdef ARDUINO
+    static size_t printHex64(Print &_out, uint64_t _value, uint8_t _digits = 16);
+    static size_t printDecimal64(Print &_out, uint64_t _value);
+    static size_t printWiegand26(Print &_out, uint32_t _id);
+    static size_t printWiegand34(Print &_out, uint32_t _id);
+#endif
+
+  private:
+    static void pair(uint8_t _n, char *_out);
+    static void padded(uint32_t _value, char *_out, uint8_t _digits);
+};
+
+#endif
@@ -0,0 +1,235 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-LATENCY.cpp
+ * @brief       Tag read latency histograms functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-LATENCY.h"
+
+// markEdge() is called from the INT pin ISR, placed into IRAM on ESP32, other boards don't need it.
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+/**
+ * @brief                   Latency stats constructor.
+ */
+RfidLatencyStats::RfidLatencyStats()
+{
+    reset();
+}
+
+/**
+ * @brief                   Marks the INT pin edge, call it from the INT pin ISR.
+ */
+void IRAM_ATTR RfidLatencyStats::markEdge()
+{
+    edgeMicros = micros();
+    edgePending = true;
+}
+
+/**
+ * @brief                   Starts the measurement of the read (called by Rfid when the first byte is seen).
+ *
+ * @param                   uint32_t _nowMicros
+ *                          Current time in microseconds (micros()).
+ */
+void RfidLatencyStats::begin(uint32_t _nowMicros)
+{
+    // Take the edge with the interrupts off, the ISR could change it halfway through the read (4 byte reads are not
+    // atomic on AVR) or mark a new edge between the read and the clear.
+    noInterrupts();
+    uint32_t _edge = edgeMicros;
+    bool _edgePending = edgePending;
+    edgePending = false;
+    interrupts();
+
+    // Use the INT edge as the start if there is a recent one.
+    hasEdge = _edgePending && (uint32_t)(_nowMicros - _edge) < RFID_LATENCY_EDGE_MAX_US;
+
+    startMicros = hasEdge ? _edge : _nowMicros;
+    firstByteMicros = _nowMicros;
+    inFlight = true;
+}
+
+/**
+ * @brief                   Records the stage of the read in progress (called by Rfid).
+ *
+ * @param                   uint8_t _stage
+ *                          RFID_LATENCY_FRAME, RFID_LATENCY_DECODE or RFID_LATENCY_DELIVERED.
+ * @param                   uint32_t _nowMicros
+ *                          Current time in microseconds (micros()).
+ */
+void RfidLatencyStats::stamp(uint8_t _stage, uint32_t _nowMicros)
+{
+    if (!inFlight || _stage >= RFID_LATENCY_STAGES)
+        return;
+
+    // First byte is recorded with the first stage, so the reads that never complete a frame (for example the ping
+    // response) are not counted.
+    if (_stage == RFID_LATENCY_FRAME && hasEdge)
+        record(RFID_LATENCY_FIRST_BYTE, firstByteMicros - startMicros);
+
+    record(_stage, _nowMicros - startMicros);
+}
+
+/**
+ * @brief                   Ends the read in progress (called by Rfid when the tag is delivered or dropped).
+ */
+void RfidLatencyStats::end()
+{
+    inFlight = false;
+}
+
+/**
+ * @brief                   Gets the summary of the stage.
+ *
+ * @param                   uint8_t _stage
+ *                          RFID_LATENCY_FIRST_BYTE, RFID_LATENCY_FRAME, RFID_LATENCY_DECODE or RFID_LATENCY_DELIVERED.
+ * @param                   RfidLatencySummary *_summary
+ *                          Pointer to the summary to fill.
+ *
+ * @return                  bool - True if the stage has samples, false if not.
+ */
+bool RfidLatencyStats::summary(uint8_t _stage, RfidLatencySummary *_summary)
+{
+    if (_stage >= RFID_LATENCY_STAGES || !_summary)
+        return false;
+
+    _summary->count = count[_stage];
+    _summary->p50 = percentile(_stage, 50);
+    _summary->p95 = percentile(_stage, 95);
+    _summary->p99 = percentile(_stage, 99);
+    _summary->max = max[_stage];
+
+    return count[_stage] != 0;
+}
+
+/**
+ * @brief                   Estimates the percentile of the stage, interpolated inside the log2 bucket.
+ *
+ * @param                   uint8_t _stage
+ *                          Stage.
+ * @param                   uint8_t _percent
+ *                          Percentile (0 - 100).
+ *
+ * @return                  uint32_t - Latency in microseconds, 0 if there are no samples.
+ */
+uint32_t RfidLatencyStats::percentile(uint8_t _stage, uint8_t _percent)
+{
+    if (_stage >= RFID_LATENCY_STAGES || !count[_stage])
+        return 0;
+
+    // Rank of the sample, rounded up.
+    uint32_t _rank = (uint32_t)(((uint64_t)count[_stage] * _percent + 99) / 100);
+    if (!_rank)
+        _rank = 1;
+
+    uint32_t _below = 0;
+    for (uint8_t b = 0; b < RFID_LATENCY_BUCKETS; b++)
+    {
+        uint32_t _n = buckets[_stage][b];
+        if (_below + _n >= _rank)
+        {
+            uint32_t _low = b ? 1UL << (b - 1) : 0;
+            uint32_t _high = b ? _low * 2 : 1;
+            uint32_t _us = _low + (uint32_t)((uint64_t)(_high - _low) * (_rank - _below) / _n);
+
+            return _us < max[_stage] ? _us : max[_stage];
+        }
+        _below += _n;
+    }
+
+    return max[_stage];
+}
+
+/**
+ * @brief                   Gets the number of samples in one bucket of the stage histogram, for example to export the
+ *                          whole histogram.
+ *
+ * @param                   uint8_t _stage
+ *                          Stage.
+ * @param                   uint8_t _bucket
+ *                          Bucket, 0 for 0 us, b for [2^(b - 1), 2^b) us, the last one also holds everything longer.
+ *
+ * @return                  uint32_t - Number of samples, 0 for the invalid stage or bucket.
+ */
+uint32_t RfidLatencyStats::bucket(uint8_t _stage, uint8_t _bucket)
+{
+    if (_stage >= RFID_LATENCY_STAGES || _bucket >= RFID_LATENCY_BUCKETS)
+        return 0;
+
+    return buckets[_stage][_bucket];
+}
+
+/**
+ * @brief                   Clears all histograms.
+ */
+void RfidLatencyStats::reset()
+{
+    for (uint8_t s = 0; s < RFID_LATENCY_STAGES; s++)
+    {
+        for (uint8_t b = 0; b < RFID_LATENCY_BUCKETS; b++)
+        {
+            buckets[s][b] = 0;
+        }
+        count[s] = 0;
+        max[s] = 0;
+    }
+}
+
+/**
+ * @brief                   Prints p50, p95, p99 and max of all stages.
+ *
+ * @param                   Print &_out
+ *                          Where to print (for example Serial).
+ */
+void RfidLatencyStats::print(Print &_out)
+{
+    static const char *const _names[RFID_LATENCY_STAGES] = {"first byte", "frame", "decode", "delivered"};
+
+    for (uint8_t s = 0; s < RFID_LATENCY_STAGES; s++)
+    {
+        RfidLatencySummary _s;
+        summary(s, &_s);
+
+        _out.print(_names[s]);
+        _out.print(": n=");
+        _out.print(_s.count);
+        _out.print(" p50=");
+        _out.print(_s.p50);
+        _out.print("us p95=");
+        _out.print(_s.p95);
+        _out.print("us p99=");
+        _out.print(_s.p99);
+        _out.print("us max=");
+        _out.print(_s.max);
+        _out.println("us");
+    }
+}
+
+/**
+ * @brief                   Adds the sample to the stage histogram.
+ *
+ * @param                   uint8_t _stage
+ *                          Stage.
+ * @param                   uint32_t _us
+ *                          Latency in microseconds.
+ */
+void RfidLatencyStats::record(uint8_t _stage, uint32_t _us)
+{
+    // Bucket is the number of significant bits.
+    uint8_t _b = _us ? sizeof(unsigned long) * 8 - __builtin_clzl(_us) : 0;
+    if (_b >= RFID_LATENCY_BUCKETS)
+        _b = RFID_LATENCY_BUCKETS - 1;
+
+    buckets[_stage][_b]++;
+    count[_stage]++;
+    if (_us > max[_stage])
+        max[_stage] = _us;
+}
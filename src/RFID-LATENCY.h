@@ -0,0 +1,78 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-LATENCY.h
+ * @brief       Header file for the tag read latency histograms.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_LATENCY__
+#define __RFID_LATENCY__
+
+#include "Arduino.h"
+
+// Stages of the tag read. Each stage histogram holds the time from the start of the read (INT edge if marked,
+// otherwise the first byte) to that stage.
+#define RFID_LATENCY_FIRST_BYTE 0
+#define RFID_LATENCY_FRAME      1
+#define RFID_LATENCY_DECODE     2
+#define RFID_LATENCY_DELIVERED  3
+#define RFID_LATENCY_STAGES     4
+
+// Number of log2 buckets, bucket b holds [2^(b - 1), 2^b) microseconds, the last one holds everything longer.
+#define RFID_LATENCY_BUCKETS 24
+
+// INT edge older than this (in microseconds) is not related to the read.
+#define RFID_LATENCY_EDGE_MAX_US 1000000UL
+
+// Summary of one stage, all times in microseconds.
+struct RfidLatencySummary
+{
+    uint32_t count;
+    uint32_t p50;
+    uint32_t p95;
+    uint32_t p99;
+    uint32_t max;
+};
+
+/**
+ * Latency histograms of one reader. Attach it with Rfid::setLatencyStats(), use one object per reader. Recording is a
+ * few additions per stage, so it can stay enabled in production.
+ */
+class RfidLatencyStats
+{
+  public:
+    RfidLatencyStats();
+    void markEdge();
+    void begin(uint32_t _nowMicros);
+    void stamp(uint8_t _stage, uint32_t _nowMicros);
+    void end();
+    bool summary(uint8_t _stage, RfidLatencySummary *_summary);
+    uint32_t percentile(uint8_t _stage, uint8_t _percent);
+    uint32_t bucket(uint8_t _stage, uint8_t _bucket);
+    void reset();
+    void print(Print &_out);
+
+  private:
+    void record(uint8_t _stage, uint32_t _us);
+
+    // Histogram buckets, number of samples and the longest sample for each stage.
+    uint32_t buckets[RFID_LATENCY_STAGES][RFID_LATENCY_BUCKETS];
+    uint32_t count[RFID_LATENCY_STAGES];
+    uint32_t max[RFID_LATENCY_STAGES];
+
+    // INT edge time, set from the ISR.
+    volatile uint32_t edgeMicros = 0;
+    volatile bool edgePending = false;
+
+    // Read in progress, its start (INT edge or the first byte) and the time of the first byte.
+    bool inFlight = false;
+    bool hasEdge = false;
+    uint32_t startMicros = 0;
+    uint32_t firstByteMicros = 0;
+};
+
+#endif
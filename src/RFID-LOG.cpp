@@ -0,0 +1,544 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-LOG.cpp
+ * @brief       Append-only persistent tag event log functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-LOG.h"
+#include <string.h>
+
+#if defined(__AVR__)
+#include <EEPROM.h>
+#endif
+
+/**
+ * @brief                   Log constructor.
+ *
+ * @param                   RfidLogRecord *_buffers
+ *                          Two RAM buffers of _batch records each (2 * _batch records).
+ * @param                   uint16_t _batch
+ *                          Number of events written to the storage at once.
+ */
+RfidEventLogBase::RfidEventLogBase(RfidLogRecord *_buffers, uint16_t _batch)
+{
+    buffers = _buffers;
+    batch = _batch ? _batch : 1;
+}
+
+/**
+ * @brief                   Opens the log on the storage and recovers the write position. Empty (or foreign) storage
+ *                          is formatted.
+ *
+ * @param                   RfidLogStorage *_storage
+ *                          Storage backend, at least two sectors.
+ *
+ * @return                  bool - True if the log is ready, false if the storage is too small or it failed.
+ */
+bool RfidEventLogBase::begin(RfidLogStorage *_storage)
+{
+    if (!_storage || !_storage->sectorSize())
+        return false;
+
+    storage = _storage;
+    slotsPerSegment = storage->sectorSize() / sizeof(RfidLogRecord);
+    segments = storage->size() / storage->sectorSize();
+    if (segments < 2 || slotsPerSegment < 2)
+        return false;
+
+    // Newest segment is the one with the highest sequence number (in the wrap around sense).
+    bool _found = false;
+    uint16_t _newest = 0;
+    uint32_t _newestSequence = 0;
+    for (uint16_t i = 0; i < segments; i++)
+    {
+        uint32_t _sequence;
+        if (readHeader(i, &_sequence) && (!_found || (int32_t)(_sequence - _newestSequence) > 0))
+        {
+            _found = true;
+            _newest = i;
+            _newestSequence = _sequence;
+        }
+    }
+
+    if (!_found)
+        return openSegment(0, 1);
+
+    segment = _newest;
+    sequence = _newestSequence;
+
+    // Records are written in order, so the written slots are followed only by the erased ones. Binary search for the
+    // first erased slot, only a few storage reads are needed no matter how full the segment is.
+    uint16_t _low = 1;
+    uint16_t _high = slotsPerSegment;
+    while (_low < _high)
+    {
+        uint16_t _mid = _low + (_high - _low) / 2;
+        RfidLogRecord _record;
+        if (!readSlot(segment, _mid, &_record))
+            return false;
+
+        if (isErased(&_record))
+            _high = _mid;
+        else
+            _low = _mid + 1;
+    }
+    slot = _low;
+
+    return true;
+}
+
+/**
+ * @brief                   Adds the event to the log. It only copies the event into the RAM buffer, so it never waits
+ *                          for the storage, call performWork() to write the buffered events.
+ *
+ * @param                   const TagEvent &_event
+ *                          Tag event.
+ *
+ * @return                  bool - True if the event is buffered, false if it's dropped because both buffers are full.
+ */
+bool RfidEventLogBase::append(const TagEvent &_event)
+{
+    uint8_t _b = active;
+    if (full[_b])
+    {
+        droppedEvents++;
+        return false;
+    }
+
+    RfidLogRecord *_record = &buffers[_b * batch + count[_b]];
+    _record->raw = _event.raw;
+    _record->id = _event.id;
+    _record->timestamp = _event.timestamp;
+    _record->reader = _event.reader;
+    _record->flags = _event.flags;
+    seal(_record);
+
+    if (++count[_b] == batch)
+    {
+        // Buffer is ready to be written, new events go into the other one.
+        full[_b] = true;
+        if (!full[_b ^ 1])
+            active = _b ^ 1;
+    }
+
+    return true;
+}
+
+/**
+ * @brief                   Does one step of writing the full batches to the storage: writes the records of the oldest
+ *                          full batch that fit into the current segment or, when the segment is full, erases and opens
+ *                          the next one. Call it often (for example from loop()), a batch takes one call, or more at
+ *                          the segment ends. The erase step blocks for the sector erase, see RfidEventLogBase.
+ *
+ * @return                  bool - True if a step was done, false if there was nothing to write or the storage failed
+ *                          (the batch is dropped then).
+ */
+bool RfidEventLogBase::performWork()
+{
+    if (!storage)
+        return false;
+
+    // If both buffers are full, the one that is not active was filled first.
+    uint8_t _b = full[active ^ 1] ? active ^ 1 : active;
+    if (!full[_b])
+        return false;
+
+    bool _ret;
+    if (slot >= slotsPerSegment)
+    {
+        // Segment is full, only the next one is opened now, the records are written by the next call.
+        _ret = openSegment((segment + 1) % segments, sequence + 1);
+        if (_ret)
+            return true;
+    }
+    else
+    {
+        uint16_t _n = count[_b] - written;
+        if (_n > slotsPerSegment - slot)
+            _n = slotsPerSegment - slot;
+
+        uint32_t _address = (uint32_t)segment * storage->sectorSize() + (uint32_t)slot * sizeof(RfidLogRecord);
+        _ret = storage->write(_address, &buffers[_b * batch + written], _n * sizeof(RfidLogRecord));
+        if (_ret)
+        {
+            slot += _n;
+            written += _n;
+            if (written < count[_b])
+                return true;
+        }
+    }
+
+    // Batch is written (or dropped because the storage failed), the buffer takes new events again.
+    written = 0;
+    count[_b] = 0;
+    full[_b] = false;
+    if (full[active])
+        active = _b;
+
+    return _ret;
+}
+
+/**
+ * @brief                   Writes all buffered events to the storage, including the partly filled batch (for example
+ *                          before going to sleep). It does all the steps of performWork() at once.
+ *
+ * @return                  bool - True if all events were written, false if not.
+ */
+bool RfidEventLogBase::flush()
+{
+    if (!storage)
+        return false;
+
+    // Partly filled batch is written after the full ones.
+    if (count[active])
+        full[active] = true;
+
+    bool _ret = true;
+    while (full[0] || full[1])
+        _ret &= performWork();
+
+    return _ret;
+}
+
+/**
+ * @brief                   Gets the number of events in RAM that are not written to the storage yet.
+ *
+ * @return                  uint16_t - Number of buffered events.
+ */
+uint16_t RfidEventLogBase::pending()
+{
+    return count[0] + count[1];
+}
+
+/**
+ * @brief                   Gets the number of events dropped because both buffers were full.
+ *
+ * @return                  uint32_t - Number of dropped events.
+ */
+uint32_t RfidEventLogBase::dropped()
+{
+    return droppedEvents;
+}
+
+/**
+ * @brief                   Sets the cursor to the oldest event in the storage (buffered events are not read, call
+ *                          flush() first to include them).
+ *
+ * @param                   RfidLogCursor *_cursor
+ *                          Cursor to set.
+ *
+ * @return                  bool - True if the log is open, false if not.
+ */
+bool RfidEventLogBase::first(RfidLogCursor *_cursor)
+{
+    if (!storage || !_cursor)
+        return false;
+
+    // Segment after the current one is the oldest one (or an erased one when the log is not full yet).
+    _cursor->segment = (segment + 1) % segments;
+    _cursor->slot = 0;
+    _cursor->segmentsLeft = segments;
+
+    return true;
+}
+
+/**
+ * @brief                   Reads the event at the cursor and moves the cursor to the next one. Records with the wrong
+ *                          CRC (for example interrupted by the power loss) are skipped.
+ *
+ * @param                   RfidLogCursor *_cursor
+ *                          Cursor set by first().
+ * @param                   TagEvent *_event
+ *                          Pointer to the event to fill.
+ *
+ * @return                  bool - True if the event is read, false at the end of the log.
+ */
+bool RfidEventLogBase::next(RfidLogCursor *_cursor, TagEvent *_event)
+{
+    if (!storage || !_cursor || !_event)
+        return false;
+
+    while (_cursor->segmentsLeft)
+    {
+        bool _endOfSegment = false;
+        RfidLogRecord _record;
+
+        if (_cursor->slot == 0)
+        {
+            // Skip the segments that are erased or were not completely opened.
+            uint32_t _sequence;
+            if (readHeader(_cursor->segment, &_sequence))
+                _cursor->slot = 1;
+            else
+                _endOfSegment = true;
+        }
+        else if (_cursor->slot >= slotsPerSegment || (_cursor->segment == segment && _cursor->slot >= slot) ||
+                 !readSlot(_cursor->segment, _cursor->slot, &_record) || isErased(&_record))
+        {
+            _endOfSegment = true;
+        }
+        else
+        {
+            _cursor->slot++;
+            if (checkCrc(&_record) && _record.flags != RFID_LOG_FLAG_HEADER)
+            {
+                _event->raw = _record.raw;
+                _event->id = _record.id;
+                _event->timestamp = _record.timestamp;
+                _event->reader = _record.reader;
+                _event->flags = _record.flags;
+                return true;
+            }
+        }
+
+        if (_endOfSegment)
+        {
+            _cursor->segment = (_cursor->segment + 1) % segments;
+            _cursor->slot = 0;
+            _cursor->segmentsLeft--;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief                   Erases the segment (dropping the oldest events in it) and writes its header.
+ *
+ * @param                   uint16_t _segment
+ *                          Segment index.
+ * @param                   uint32_t _sequence
+ *                          Sequence number of the segment.
+ *
+ * @return                  bool - True if opened, false if the storage failed.
+ */
+bool RfidEventLogBase::openSegment(uint16_t _segment, uint32_t _sequence)
+{
+    uint32_t _address = (uint32_t)_segment * storage->sectorSize();
+    if (!storage->erase(_address))
+        return false;
+
+    RfidLogRecord _header;
+    _header.raw = 0;
+    _header.id = RFID_LOG_MAGIC;
+    _header.timestamp = _sequence;
+    _header.reader = 0;
+    _header.flags = RFID_LOG_FLAG_HEADER;
+    seal(&_header);
+    if (!storage->write(_address, &_header, sizeof(_header)))
+        return false;
+
+    segment = _segment;
+    sequence = _sequence;
+    slot = 1;
+
+    return true;
+}
+
+/**
+ * @brief                   Reads one record slot of the segment.
+ *
+ * @param                   uint16_t _segment
+ *                          Segment index.
+ * @param                   uint16_t _slot
+ *                          Slot index in the segment.
+ * @param                   RfidLogRecord *_record
+ *                          Pointer to the record to fill.
+ *
+ * @return                  bool - True if read, false if the storage failed.
+ */
+bool RfidEventLogBase::readSlot(uint16_t _segment, uint16_t _slot, RfidLogRecord *_record)
+{
+    uint32_t _address = (uint32_t)_segment * storage->sectorSize() + (uint32_t)_slot * sizeof(RfidLogRecord);
+    return storage->read(_address, _record, sizeof(RfidLogRecord));
+}
+
+/**
+ * @brief                   Reads the header of the segment.
+ *
+ * @param                   uint16_t _segment
+ *                          Segment index.
+ * @param                   uint32_t *_sequence
+ *                          Pointer to the sequence number to fill.
+ *
+ * @return                  bool - True if the segment has a valid header, false if not.
+ */
+bool RfidEventLogBase::readHeader(uint16_t _segment, uint32_t *_sequence)
+{
+    RfidLogRecord _header;
+    if (!readSlot(_segment, 0, &_header) || !checkCrc(&_header) || _header.id != RFID_LOG_MAGIC ||
+        _header.flags != RFID_LOG_FLAG_HEADER)
+        return false;
+
+    *_sequence = _header.timestamp;
+    return true;
+}
+
+/**
+ * @brief                   Checks if the record slot is erased (free).
+ *
+ * @param                   const RfidLogRecord *_record
+ *                          Record read from the storage.
+ *
+ * @return                  bool - True if all bytes are 0xFF, false if not.
+ */
+bool RfidEventLogBase::isErased(const RfidLogRecord *_record)
+{
+    const uint8_t *_bytes = (const uint8_t *)_record;
+    for (uint8_t i = 0; i < sizeof(RfidLogRecord); i++)
+    {
+        if (_bytes[i] != 0xFF)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief                   Calculates and stores the CRC of the record.
+ *
+ * @param                   RfidLogRecord *_record
+ *                          Record to seal.
+ */
+void RfidEventLogBase::seal(RfidLogRecord *_record)
+{
+    _record->crc = crc16((const uint8_t *)_record, offsetof(RfidLogRecord, crc));
+}
+
+/**
+ * @brief                   Checks the CRC of the record.
+ *
+ * @param                   const RfidLogRecord *_record
+ *                          Record read from the storage.
+ *
+ * @return                  bool - True if the CRC matches, false if not.
+ */
+bool RfidEventLogBase::checkCrc(const RfidLogRecord *_record)
+{
+    return _record->crc == crc16((const uint8_t *)_record, offsetof(RfidLogRecord, crc));
+}
+
+/**
+ * @brief                   CRC-16/CCITT-FALSE of the data.
+ *
+ * @param                   const uint8_t *_data
+ *                          Data.
+ * @param                   uint16_t _n
+ *                          Number of bytes.
+ *
+ * @return                  uint16_t - CRC.
+ */
+uint16_t RfidEventLogBase::crc16(const uint8_t *_data, uint16_t _n)
+{
+    uint16_t _crc = 0xFFFF;
+    while (_n--)
+    {
+        _crc ^= (uint16_t)(*_data++) << 8;
+        for (uint8_t i = 0; i < 8; i++)
+            _crc = (_crc & 0x8000) ? (_crc << 1) ^ 0x1021 : _crc << 1;
+    }
+
+    return _crc;
+}
+
+#if defined(ESP32)
+/**
+ * @brief                   Finds the data partition for the log.
+ *
+ * @param                   const char *_label
+ *                          Label of the partition in the partition table.
+ *
+ * @return                  bool - True if found, false if not.
+ */
+bool RfidLogPartition::begin(const char *_label)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, _label);
+    return partition != NULL;
+}
+
+uint32_t RfidLogPartition::size()
+{
+    return partition ? partition->size : 0;
+}
+
+uint32_t RfidLogPartition::sectorSize()
+{
+    return SPI_FLASH_SEC_SIZE;
+}
+
+bool RfidLogPartition::read(uint32_t _address, void *_data, uint32_t _length)
+{
+    return partition && esp_partition_read(partition, _address, _data, _length) == ESP_OK;
+}
+
+bool RfidLogPartition::write(uint32_t _address, const void *_data, uint32_t _length)
+{
+    return partition && esp_partition_write(partition, _address, _data, _length) == ESP_OK;
+}
+
+bool RfidLogPartition::erase(uint32_t _address)
+{
+    return partition && esp_partition_erase_range(partition, _address, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
+#endif
+
+#if defined(__AVR__)
+/**
+ * @brief                   EEPROM log storage constructor.
+ *
+ * @param                   uint16_t _start
+ *                          First EEPROM address used by the log.
+ * @param                   uint16_t _length
+ *                          Number of EEPROM bytes used by the log.
+ * @param                   uint16_t _sectorSize
+ *                          Size of the virtual sector (segment) in bytes, multiple of 20 bytes wastes nothing.
+ */
+RfidLogEeprom::RfidLogEeprom(uint16_t _start, uint16_t _length, uint16_t _sectorSize)
+{
+    start = _start;
+    length = _length;
+    sector = _sectorSize;
+}
+
+uint32_t RfidLogEeprom::size()
+{
+    return sector ? length - length % sector : 0;
+}
+
+uint32_t RfidLogEeprom::sectorSize()
+{
+    return sector;
+}
+
+bool RfidLogEeprom::read(uint32_t _address, void *_data, uint32_t _length)
+{
+    uint8_t *_bytes = (uint8_t *)_data;
+    for (uint32_t i = 0; i < _length; i++)
+        _bytes[i] = EEPROM.read(start + _address + i);
+
+    return true;
+}
+
+bool RfidLogEeprom::write(uint32_t _address, const void *_data, uint32_t _length)
+{
+    const uint8_t *_bytes = (const uint8_t *)_data;
+    for (uint32_t i = 0; i < _length; i++)
+        EEPROM.update(start + _address + i, _bytes[i]);
+
+    return true;
+}
+
+bool RfidLogEeprom::erase(uint32_t _address)
+{
+    // Bytes that are already erased are not written, so erasing does not wear the EEPROM needlessly.
+    for (uint16_t i = 0; i < sector; i++)
+        EEPROM.update(start + _address + i, 0xFF);
+
+    return true;
+}
+#endif
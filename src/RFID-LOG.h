@@ -0,0 +1,178 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-LOG.h
+ * @brief       Header file for the append-only persistent tag event log.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_LOG__
+#define __RFID_LOG__
+
+#include "RFID-EVENT.h"
+
+#if defined(ESP32)
+#include <esp_partition.h>
+#endif
+
+// Magic of the segment header record ("RFLG" in little endian).
+#define RFID_LOG_MAGIC 0x474C4652UL
+
+// Flags of the segment header record (never used by the tag event records).
+#define RFID_LOG_FLAG_HEADER 0xFE
+
+/**
+ * Record as stored in the log, one per tag event. Erased storage reads as 0xFF, so the record that is all 0xFF is the
+ * free space. Each segment (storage sector) starts with a header record, that holds the magic in the id field and the
+ * segment sequence number in the timestamp field.
+ */
+struct __attribute__((packed)) RfidLogRecord
+{
+    uint64_t raw;
+    uint32_t id;
+    uint32_t timestamp;
+    uint8_t reader;
+    uint8_t flags;
+    uint16_t crc;
+};
+
+/**
+ * Storage backend for the log. The storage is split into sectors, which are erased to 0xFF as a whole and then written
+ * in any order.
+ */
+class RfidLogStorage
+{
+  public:
+    virtual ~RfidLogStorage()
+    {
+    }
+    virtual uint32_t size() = 0;
+    virtual uint32_t sectorSize() = 0;
+    virtual bool read(uint32_t _address, void *_data, uint32_t _length) = 0;
+    virtual bool write(uint32_t _address, const void *_data, uint32_t _length) = 0;
+    virtual bool erase(uint32_t _address) = 0;
+};
+
+#if defined(ESP32)
+/**
+ * Log storage in the ESP32 flash data partition (add it to the partition table, for example "rfidlog, data, 0x99,
+ * , 64K").
+ */
+class RfidLogPartition : public RfidLogStorage
+{
+  public:
+    bool begin(const char *_label);
+    uint32_t size();
+    uint32_t sectorSize();
+    bool read(uint32_t _address, void *_data, uint32_t _length);
+    bool write(uint32_t _address, const void *_data, uint32_t _length);
+    bool erase(uint32_t _address);
+
+  private:
+    const esp_partition_t *partition = NULL;
+};
+#endif
+
+#if defined(__AVR__)
+/**
+ * Log storage in the AVR EEPROM. Sectors are virtual, erasing only rewrites the bytes that are not already 0xFF.
+ */
+class RfidLogEeprom : public RfidLogStorage
+{
+  public:
+    RfidLogEeprom(uint16_t _start, uint16_t _length, uint16_t _sectorSize = 100);
+    uint32_t size();
+    uint32_t sectorSize();
+    bool read(uint32_t _address, void *_data, uint32_t _length);
+    bool write(uint32_t _address, const void *_data, uint32_t _length);
+    bool erase(uint32_t _address);
+
+  private:
+    uint16_t start;
+    uint16_t length;
+    uint16_t sector;
+};
+#endif
+
+// Position in the log used to read the stored tag events, from the oldest one to the newest one.
+struct RfidLogCursor
+{
+    uint16_t segment;
+    uint16_t slot;
+    uint16_t segmentsLeft;
+};
+
+/**
+ * Append-only tag event log. Events are buffered in RAM and written to the storage a batch at a time into the rotating
+ * segments (storage sectors), so the storage wears evenly and the oldest segment is erased only when the log is full.
+ * On begin(), the write position is recovered from the segment headers and a binary search for the free space of the
+ * newest segment. Use RfidEventLog<N> to get the log with the buffers for batches of N events.
+ *
+ * append() never touches the storage. performWork() does the storage work in steps, one step per call: either the
+ * write of the batch records that fit into the current segment, or, when the segment is full, the erase of the next
+ * one and the write of its header. The erase is the long step: one flash sector erase on ESP32 (tens of milliseconds,
+ * the flash cache is disabled meanwhile) or rewriting the virtual sector on AVR (about 3.3 ms per EEPROM byte that is
+ * not erased yet). It blocks the caller, so call performWork() where that is acceptable.
+ */
+class RfidEventLogBase
+{
+  public:
+    RfidEventLogBase(RfidLogRecord *_buffers, uint16_t _batch);
+    bool begin(RfidLogStorage *_storage);
+    bool append(const TagEvent &_event);
+    bool performWork();
+    bool flush();
+    uint16_t pending();
+    uint32_t dropped();
+    bool first(RfidLogCursor *_cursor);
+    bool next(RfidLogCursor *_cursor, TagEvent *_event);
+
+  private:
+    bool openSegment(uint16_t _segment, uint32_t _sequence);
+    bool readSlot(uint16_t _segment, uint16_t _slot, RfidLogRecord *_record);
+    bool readHeader(uint16_t _segment, uint32_t *_sequence);
+    bool isErased(const RfidLogRecord *_record);
+    static void seal(RfidLogRecord *_record);
+    static bool checkCrc(const RfidLogRecord *_record);
+    static uint16_t crc16(const uint8_t *_data, uint16_t _n);
+
+    // Storage and its layout.
+    RfidLogStorage *storage = NULL;
+    uint16_t segments = 0;
+    uint16_t slotsPerSegment = 0;
+
+    // Current segment, its sequence number and the next free slot in it.
+    uint16_t segment = 0;
+    uint32_t sequence = 0;
+    uint16_t slot = 0;
+
+    // Two RAM buffers of batch records each. New events go into the active buffer, the other one can wait to be
+    // written to the storage.
+    RfidLogRecord *buffers;
+    uint16_t batch;
+    uint8_t active = 0;
+    uint16_t count[2] = {0, 0};
+    bool full[2] = {false, false};
+
+    // Records of the oldest full buffer already written to the storage.
+    uint16_t written = 0;
+
+    // Number of events dropped because both buffers were full.
+    uint32_t droppedEvents = 0;
+};
+
+template <uint16_t N> class RfidEventLog : public RfidEventLogBase
+{
+  public:
+    RfidEventLog() : RfidEventLogBase(records, N)
+    {
+    }
+
+  private:
+    RfidLogRecord records[2 * N];
+};
+
+#endif
@@ -0,0 +1,343 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-METRICS.cpp
+ * @brief       Metrics registry functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-METRICS.h"
+#include "RFID-FORMAT.h"
+
+/**
+ * @brief                   Metrics registry constructor.
+ */
+RfidMetrics::RfidMetrics()
+{
+    for (uint8_t i = 0; i < RFID_METRICS_MAX; i++)
+        values[i] = 0;
+}
+
+/**
+ * @brief                   Registers a block of metrics (called by Rfid for itself, its easyC bus and its software
+ *                          serial). The values start at zero, counters first, then the gauges.
+ *
+ * @param                   const char *_group
+ *                          Group of the metrics ("rfid", "easyc", "serial").
+ * @param                   const char *_source
+ *                          Name of the reader the metrics belong to.
+ * @param                   const char *const *_names
+ *                          Names of the counters and the gauges.
+ * @param                   uint8_t _counters
+ *                          Number of counters.
+ * @param                   uint8_t _gauges
+ *                          Number of gauges.
+ *
+ * @return                  volatile uint32_t * - Values of the block, NULL if the registry is full.
+ */
+volatile uint32_t *RfidMetrics::add(const char *_group, const char *_source, const char *const *_names,
+                                    uint8_t _counters, uint8_t _gauges)
+{
+    uint8_t _n = _counters + _gauges;
+    if (!_n || blockCount >= RFID_METRICS_BLOCKS)
+        return NULL;
+
+    // First gap that fits, blocks are kept in the order of their values.
+    uint8_t _index = 0;
+    uint8_t _first = 0;
+    while (_index < blockCount && blocks[_index].first - _first < _n)
+    {
+        _first = blocks[_index].first + blocks[_index].counters + blocks[_index].gauges;
+        _index++;
+    }
+    if (RFID_METRICS_MAX - _first < _n)
+        return NULL;
+
+    for (uint8_t i = blockCount; i > _index; i--)
+        blocks[i] = blocks[i - 1];
+    blocks[_index] = {_group, _source, _names, _first, _counters, _gauges};
+    blockCount++;
+
+    for (uint8_t i = 0; i < _n; i++)
+        values[_first + i] = 0;
+
+    return &values[_first];
+}
+
+/**
+ * @brief                   Removes the block of metrics, its values are not valid after it.
+ *
+ * @param                   volatile uint32_t *_values
+ *                          Values returned by add(). NULL is ignored.
+ */
+void RfidMetrics::remove(volatile uint32_t *_values)
+{
+    for (uint8_t i = 0; i < blockCount; i++)
+    {
+        if (&values[blocks[i].first] == _values)
+        {
+            blockCount--;
+            for (uint8_t j = i; j < blockCount; j++)
+                blocks[j] = blocks[j + 1];
+            return;
+        }
+    }
+}
+
+/**
+ * @brief                   Gets the number of registered values.
+ *
+ * @return                  uint8_t - Number of counters and gauges.
+ */
+uint8_t RfidMetrics::size()
+{
+    uint8_t _size = 0;
+    for (uint8_t i = 0; i < blockCount; i++)
+        _size += blocks[i].counters + blocks[i].gauges;
+
+    return _size;
+}
+
+/**
+ * @brief                   Gets the hash of the schema (groups, sources, names and types of the values in their
+ *                          order), it changes when a block is added or removed.
+ *
+ * @return                  uint32_t - FNV-1a hash of the schema.
+ */
+uint32_t RfidMetrics::schemaHash()
+{
+    uint32_t _hash = 2166136261UL;
+    for (uint8_t i = 0; i < blockCount; i++)
+    {
+        for (uint8_t j = 0; j < blocks[i].counters + blocks[i].gauges; j++)
+        {
+            _hash = hash(_hash, blocks[i].group);
+            _hash = hash(_hash, blocks[i].source);
+            _hash = hash(_hash, blocks[i].names[j]);
+            _hash = hash(_hash, j < blocks[i].counters ? "c" : "g");
+        }
+    }
+
+    return _hash;
+}
+
+/**
+ * @brief                   Serializes all the values into the buffer. Nothing is allocated, use
+ *                          RFID_METRICS_BINARY_MAX for the size of the binary snapshot.
+ *
+ * @param                   uint8_t *_buffer
+ *                          Buffer for the snapshot.
+ * @param                   size_t _size
+ *                          Size of the buffer.
+ * @param                   uint8_t _format
+ *                          RFID_METRICS_BINARY, RFID_METRICS_LINE or RFID_METRICS_SCHEMA.
+ *
+ * @return                  size_t - Length of the snapshot, 0 if it does not fit into the buffer.
+ */
+size_t RfidMetrics::snapshot(uint8_t *_buffer, size_t _size, uint8_t _format)
+{
+    Output _out = {_buffer, _size, NULL, 0, false};
+    return write(_out, _format);
+}
+
+/**
+ * @brief                   Serializes all the values into the Print (Serial, network client...).
+ *
+ * @param                   Print &_out
+ *                          Where to print.
+ * @param                   uint8_t _format
+ *                          RFID_METRICS_BINARY, RFID_METRICS_LINE or RFID_METRICS_SCHEMA.
+ *
+ * @return                  size_t - Number of bytes printed.
+ */
+size_t RfidMetrics::snapshot(Print &_out, uint8_t _format)
+{
+    Output _output = {NULL, 0, &_out, 0, false};
+    return write(_output, _format);
+}
+
+/**
+ * @brief                   Serializes all the values in the format.
+ *
+ * @param                   Output &_out
+ *                          Where to put the snapshot.
+ * @param                   uint8_t _format
+ *                          RFID_METRICS_BINARY, RFID_METRICS_LINE or RFID_METRICS_SCHEMA.
+ *
+ * @return                  size_t - Length of the snapshot, 0 if it did not fit into the buffer.
+ */
+size_t RfidMetrics::write(Output &_out, uint8_t _format)
+{
+    if (_format == RFID_METRICS_BINARY)
+    {
+        uint8_t _header[4] = {'R', 'M', RFID_METRICS_VERSION, size()};
+        put(_out, _header, sizeof(_header));
+        putUint32(_out, schemaHash());
+        putUint32(_out, millis());
+
+        for (uint8_t i = 0; i < blockCount; i++)
+            for (uint8_t j = 0; j < blocks[i].counters + blocks[i].gauges; j++)
+                putVarint(_out, values[blocks[i].first + j]);
+    }
+    else if (_format == RFID_METRICS_LINE)
+    {
+        for (uint8_t i = 0; i < blockCount; i++)
+        {
+            putText(_out, blocks[i].group);
+            putText(_out, ",source=");
+            putText(_out, blocks[i].source);
+            for (uint8_t j = 0; j < blocks[i].counters + blocks[i].gauges; j++)
+            {
+                putText(_out, j ? "," : " ");
+                putText(_out, blocks[i].names[j]);
+                putText(_out, "=");
+                putNumber(_out, values[blocks[i].first + j]);
+                putText(_out, "i");
+            }
+            putText(_out, "\n");
+        }
+    }
+    else if (_format == RFID_METRICS_SCHEMA)
+    {
+        putText(_out, "schema ");
+        putNumber(_out, schemaHash());
+        putText(_out, "\n");
+
+        uint8_t _index = 0;
+        for (uint8_t i = 0; i < blockCount; i++)
+        {
+            for (uint8_t j = 0; j < blocks[i].counters + blocks[i].gauges; j++)
+            {
+                putNumber(_out, _index++);
+                putText(_out, " ");
+                putText(_out, blocks[i].group);
+                putText(_out, " ");
+                putText(_out, blocks[i].source);
+                putText(_out, " ");
+                putText(_out, blocks[i].names[j]);
+                putText(_out, j < blocks[i].counters ? " counter\n" : " gauge\n");
+            }
+        }
+    }
+    else
+    {
+        return 0;
+    }
+
+    return _out.full ? 0 : _out.length;
+}
+
+/**
+ * @brief                   Puts the bytes into the output. Buffer that is too small is marked as full.
+ *
+ * @param                   Output &_out
+ *                          Where to put the bytes.
+ * @param                   const void *_data
+ *                          Bytes.
+ * @param                   size_t _n
+ *                          Number of bytes.
+ */
+void RfidMetrics::put(Output &_out, const void *_data, size_t _n)
+{
+    if (_out.print)
+    {
+        _out.length += _out.print->write((const uint8_t *)_data, _n);
+        return;
+    }
+
+    if (_out.full || _out.size - _out.length < _n)
+    {
+        _out.full = true;
+        return;
+    }
+
+    memcpy(_out.buffer + _out.length, _data, _n);
+    _out.length += _n;
+}
+
+/**
+ * @brief                   Puts the text (without the null-terminating char) into the output.
+ *
+ * @param                   Output &_out
+ *                          Where to put the text.
+ * @param                   const char *_text
+ *                          Null-terminated text.
+ */
+void RfidMetrics::putText(Output &_out, const char *_text)
+{
+    put(_out, _text, strlen(_text));
+}
+
+/**
+ * @brief                   Puts the number as decimal text into the output.
+ *
+ * @param                   Output &_out
+ *                          Where to put the number.
+ * @param                   uint32_t _value
+ *                          Number.
+ */
+void RfidMetrics::putNumber(Output &_out, uint32_t _value)
+{
+    char _buf[RFID_FORMAT_DECIMAL64_SIZE];
+    put(_out, _buf, RfidFormat::decimal64(_value, _buf));
+}
+
+/**
+ * @brief                   Puts the number as LEB128 varint (7 bits per byte, low bits first) into the output.
+ *
+ * @param                   Output &_out
+ *                          Where to put the number.
+ * @param                   uint32_t _value
+ *                          Number.
+ */
+void RfidMetrics::putVarint(Output &_out, uint32_t _value)
+{
+    uint8_t _buf[5];
+    uint8_t _n = 0;
+    while (_value >= 0x80)
+    {
+        _buf[_n++] = (_value & 0x7F) | 0x80;
+        _value >>= 7;
+    }
+    _buf[_n++] = _value;
+
+    put(_out, _buf, _n);
+}
+
+/**
+ * @brief                   Puts the number as 4 bytes, little endian, into the output.
+ *
+ * @param                   Output &_out
+ *                          Where to put the number.
+ * @param                   uint32_t _value
+ *                          Number.
+ */
+void RfidMetrics::putUint32(Output &_out, uint32_t _value)
+{
+    uint8_t _buf[4] = {(uint8_t)_value, (uint8_t)(_value >> 8), (uint8_t)(_value >> 16), (uint8_t)(_value >> 24)};
+    put(_out, _buf, sizeof(_buf));
+}
+
+/**
+ * @brief                   Adds the text (with its null-terminating char, so the names don't run together) to the
+ *                          FNV-1a hash.
+ *
+ * @param                   uint32_t _hash
+ *                          Hash so far.
+ * @param                   const char *_text
+ *                          Null-terminated text.
+ *
+ * @return                  uint32_t - New hash.
+ */
+uint32_t RfidMetrics::hash(uint32_t _hash, const char *_text)
+{
+    do
+    {
+        _hash = (_hash ^ (uint8_t)*_text) * 16777619UL;
+    } while (*_text++);
+
+    return _hash;
+}
@@ -0,0 +1,137 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-METRICS.h
+ * @brief       Header file for the metrics registry of the reader (Rfid, EasyC and SoftwareSerial counters and
+ *              gauges).
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_METRICS__
+#define __RFID_METRICS__
+
+#include "Arduino.h"
+
+// Number of metric values and of the blocks (Rfid registers one for itself, its easyC bus and its software serial).
+#ifndef RFID_METRICS_MAX
+#if defined(ESP32)
+#define RFID_METRICS_MAX 64
+#else
+#define RFID_METRICS_MAX 24
+#endif
+#endif
+
+#ifndef RFID_METRICS_BLOCKS
+#if defined(ESP32)
+#define RFID_METRICS_BLOCKS 12
+#else
+#define RFID_METRICS_BLOCKS 4
+#endif
+#endif
+
+// Snapshot formats, see RfidMetrics::snapshot().
+#define RFID_METRICS_BINARY 0
+#define RFID_METRICS_LINE   1
+#define RFID_METRICS_SCHEMA 2
+
+// Binary snapshot header: "RM", version, number of values, schema hash and millis() (both little endian).
+#define RFID_METRICS_VERSION     1
+#define RFID_METRICS_HEADER_SIZE 12
+
+// Longest binary snapshot in bytes (each value is a LEB128 varint of up to 5 bytes).
+#define RFID_METRICS_BINARY_MAX (RFID_METRICS_HEADER_SIZE + 5 * RFID_METRICS_MAX)
+
+// Metrics of Rfid (group "rfid"): counters of the tags passed to the application, the frames that failed decoding or
+// validation, the dropped repeated reads, the UART bytes dropped because the frame did not fit, the easyC checks, the
+// time spent in the easyC transactions (microseconds) and the tags that did not fit into the queue of the reader task,
+// and the gauge of the adaptive polling interval (microseconds).
+#define RFID_METRIC_TAGS          0
+#define RFID_METRIC_INVALID       1
+#define RFID_METRIC_DUPLICATES    2
+#define RFID_METRIC_RX_DROPPED    3
+#define RFID_METRIC_BUS_CHECKS    4
+#define RFID_METRIC_BUS_MICROS    5
+#define RFID_METRIC_TASK_DROPPED  6
+#define RFID_METRIC_POLL_INTERVAL 7
+
+// Metrics of the easyC bus of Rfid (group "easyc"): counters of the I2C writes, the reads and the failed ones, and the
+// gauge of the last Wire.endTransmission() error.
+#define RFID_METRIC_EASYC_WRITES     0
+#define RFID_METRIC_EASYC_READS      1
+#define RFID_METRIC_EASYC_ERRORS     2
+#define RFID_METRIC_EASYC_LAST_ERROR 3
+
+// Metrics of the ESP32 SoftwareSerial of Rfid (group "serial"): counters of the bytes received and sent, the bytes
+// dropped because the RX buffer was full, the ISR edge buffer overflows and the words dropped for the missing stop bit.
+#define RFID_METRIC_SERIAL_RX_BYTES       0
+#define RFID_METRIC_SERIAL_TX_BYTES       1
+#define RFID_METRIC_SERIAL_OVERFLOWS      2
+#define RFID_METRIC_SERIAL_ISR_OVERFLOWS  3
+#define RFID_METRIC_SERIAL_FRAMING_ERRORS 4
+
+/**
+ * Registry of the reader health metrics. Rfid::setMetrics() registers the counters and gauges of the reader, of its
+ * easyC bus and of its software serial, each as a block of 32 bit values in the registry. Owners update their values
+ * in place (one addition), nothing is allocated, and snapshot() serializes all of them at once for the monitoring:
+ *
+ *      RFID_METRICS_BINARY     Header (RFID_METRICS_HEADER_SIZE bytes) and each value as a LEB128 varint, in the
+ *                              order of the schema. Schema hash in the header tells the collector if its copy of the
+ *                              schema is still valid.
+ *      RFID_METRICS_LINE       InfluxDB line protocol, one line per block: "<group>,source=<source> name=<value>i,..."
+ *                              without the timestamp (the collector adds it).
+ *      RFID_METRICS_SCHEMA     Text with the hash and one line per value: "<index> <group> <source> <name> <type>".
+ *
+ * Group, source and metric names are not copied, they must stay valid while registered (string literals). Sources
+ * should not contain spaces, commas or equal signs.
+ */
+class RfidMetrics
+{
+  public:
+    RfidMetrics();
+    volatile uint32_t *add(const char *_group, const char *_source, const char *const *_names, uint8_t _counters,
+                           uint8_t _gauges);
+    void remove(volatile uint32_t *_values);
+    uint8_t size();
+    uint32_t schemaHash();
+    size_t snapshot(uint8_t *_buffer, size_t _size, uint8_t _format);
+    size_t snapshot(Print &_out, uint8_t _format);
+
+  private:
+    // Registered block of values.
+    struct Block
+    {
+        const char *group;
+        const char *source;
+        const char *const *names;
+        uint8_t first;
+        uint8_t counters;
+        uint8_t gauges;
+    };
+
+    // Output of the snapshot, the caller's buffer or a Print.
+    struct Output
+    {
+        uint8_t *buffer;
+        size_t size;
+        Print *print;
+        size_t length;
+        bool full;
+    };
+
+    size_t write(Output &_out, uint8_t _format);
+    void put(Output &_out, const void *_data, size_t _n);
+    void putText(Output &_out, const char *_text);
+    void putNumber(Output &_out, uint32_t _value);
+    void putVarint(Output &_out, uint32_t _value);
+    void putUint32(Output &_out, uint32_t _value);
+    static uint32_t hash(uint32_t _hash, const char *_text);
+
+    volatile uint32_t values[RFID_METRICS_MAX];
+    Block blocks[RFID_METRICS_BLOCKS];
+    uint8_t blockCount = 0;
+};
+
+#endif
@@ -0,0 +1,258 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-PRESENCE.cpp
+ * @brief       Tag presence tracker functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-PRESENCE.h"
+
+/**
+ * @brief                   Presence tracker constructor.
+ *
+ * @param                   RfidPresenceEntry *_entries
+ *                          Storage for the state table.
+ * @param                   uint8_t _size
+ *                          Number of entries.
+ */
+RfidPresenceTracker::RfidPresenceTracker(RfidPresenceEntry *_entries, uint8_t _size)
+{
+    entries = _entries;
+    size = _size;
+    clear();
+}
+
+/**
+ * @brief                   Sets the arrive and depart thresholds.
+ *
+ * @param                   uint8_t _arriveReads
+ *                          Number of reads needed for the tag to arrive (1 means the first read).
+ * @param                   uint32_t _departMs
+ *                          Time in milliseconds without reads after which the tag departs. Must be longer than the
+ *                          time between two reads of the tag resting on the antenna.
+ */
+void RfidPresenceTracker::setThresholds(uint8_t _arriveReads, uint32_t _departMs)
+{
+    arriveReads = _arriveReads ? _arriveReads : 1;
+    departMs = _departMs;
+}
+
+/**
+ * @brief                   Sets the function called for each event. Without it, events are queued for getEvent().
+ *
+ * @param                   void (*_callback)(const RfidPresenceEvent &_event)
+ *                          Event callback, NULL to queue the events.
+ */
+void RfidPresenceTracker::onEvent(void (*_callback)(const RfidPresenceEvent &_event))
+{
+    callback = _callback;
+}
+
+/**
+ * @brief                   Records the tag read.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID (as returned by Rfid::getId()).
+ * @param                   uint8_t _reader
+ *                          Index of the reader that read the tag.
+ * @param                   uint32_t _now
+ *                          Current time in milliseconds (millis()).
+ *
+ * @return                  bool - True if the tag is tracked, false if the table is full of present tags.
+ */
+bool RfidPresenceTracker::seen(uint32_t _id, uint8_t _reader, uint32_t _now)
+{
+    // Entry that will be used if the tag is not in the table.
+    RfidPresenceEntry *_victim = NULL;
+
+    for (uint8_t i = 0; i < size; i++)
+    {
+        RfidPresenceEntry *_entry = &entries[i];
+
+        if (_entry->state != RFID_PRESENCE_EMPTY && _entry->id == _id && _entry->reader == _reader)
+        {
+            if ((uint32_t)(_now - _entry->lastSeen) >= departMs)
+            {
+                // Gap is too long, update() was not called in time. Finish the old visit and start a new one.
+                if (_entry->state == RFID_PRESENCE_PRESENT)
+                    emit(RFID_PRESENCE_DEPARTED, _entry, _now);
+
+                _entry->state = RFID_PRESENCE_PENDING;
+                _entry->firstSeen = _now;
+                _entry->reads = 0;
+            }
+
+            _entry->lastSeen = _now;
+            if (_entry->state == RFID_PRESENCE_PENDING && ++_entry->reads >= arriveReads)
+            {
+                _entry->state = RFID_PRESENCE_PRESENT;
+                emit(RFID_PRESENCE_ARRIVED, _entry, _now);
+            }
+
+            return true;
+        }
+
+        // Keep the first empty entry, otherwise the pending entry seen the longest time ago. Present tags are never
+        // evicted, they would depart without the event.
+        if (_entry->state == RFID_PRESENCE_EMPTY)
+        {
+            if (!_victim || _victim->state != RFID_PRESENCE_EMPTY)
+                _victim = _entry;
+        }
+        else if (_entry->state == RFID_PRESENCE_PENDING &&
+                 (!_victim || (_victim->state == RFID_PRESENCE_PENDING &&
+                               (uint32_t)(_now - _entry->lastSeen) > (uint32_t)(_now - _victim->lastSeen))))
+        {
+            _victim = _entry;
+        }
+    }
+
+    if (!_victim)
+        return false;
+
+    _victim->id = _id;
+    _victim->reader = _reader;
+    _victim->firstSeen = _now;
+    _victim->lastSeen = _now;
+    _victim->reads = 1;
+    _victim->state = RFID_PRESENCE_PENDING;
+
+    if (arriveReads <= 1)
+    {
+        _victim->state = RFID_PRESENCE_PRESENT;
+        emit(RFID_PRESENCE_ARRIVED, _victim, _now);
+    }
+
+    return true;
+}
+
+/**
+ * @brief                   Checks for the departed tags. Call it often, departure is detected at most one call late.
+ *
+ * @param                   uint32_t _now
+ *                          Current time in milliseconds (millis()).
+ */
+void RfidPresenceTracker::update(uint32_t _now)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        RfidPresenceEntry *_entry = &entries[i];
+
+        if (_entry->state != RFID_PRESENCE_EMPTY && (uint32_t)(_now - _entry->lastSeen) >= departMs)
+        {
+            // Pending tags never arrived, so they leave silently.
+            if (_entry->state == RFID_PRESENCE_PRESENT)
+                emit(RFID_PRESENCE_DEPARTED, _entry, _now);
+
+            _entry->state = RFID_PRESENCE_EMPTY;
+        }
+    }
+}
+
+/**
+ * @brief                   Gets the oldest queued event (only used when no callback is set).
+ *
+ * @param                   RfidPresenceEvent *_event
+ *                          Pointer to the event to fill.
+ *
+ * @return                  bool - True if there was an event, false if not.
+ */
+bool RfidPresenceTracker::getEvent(RfidPresenceEvent *_event)
+{
+    if (!queueCount)
+        return false;
+
+    *_event = queue[queueHead];
+    queueHead = (queueHead + 1) % RFID_PRESENCE_QUEUE_SIZE;
+    queueCount--;
+
+    return true;
+}
+
+/**
+ * @brief                   Checks if the tag is present on the reader.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ * @param                   uint8_t _reader
+ *                          Reader index.
+ *
+ * @return                  bool - True if the tag arrived and did not depart yet, false if not.
+ */
+bool RfidPresenceTracker::isPresent(uint32_t _id, uint8_t _reader)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        if (entries[i].state == RFID_PRESENCE_PRESENT && entries[i].id == _id && entries[i].reader == _reader)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief                   Gets the number of present tags on all readers.
+ *
+ * @return                  uint8_t - Number of present tags.
+ */
+uint8_t RfidPresenceTracker::presentCount()
+{
+    uint8_t _n = 0;
+    for (uint8_t i = 0; i < size; i++)
+    {
+        if (entries[i].state == RFID_PRESENCE_PRESENT)
+            _n++;
+    }
+
+    return _n;
+}
+
+/**
+ * @brief                   Forgets all tags without any events and empties the event queue.
+ */
+void RfidPresenceTracker::clear()
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        entries[i].state = RFID_PRESENCE_EMPTY;
+    }
+
+    queueHead = 0;
+    queueCount = 0;
+}
+
+/**
+ * @brief                   Sends the event to the callback or queues it.
+ *
+ * @param                   uint8_t _type
+ *                          RFID_PRESENCE_ARRIVED or RFID_PRESENCE_DEPARTED.
+ * @param                   const RfidPresenceEntry *_entry
+ *                          Entry of the tag.
+ * @param                   uint32_t _now
+ *                          Current time in milliseconds.
+ */
+void RfidPresenceTracker::emit(uint8_t _type, const RfidPresenceEntry *_entry, uint32_t _now)
+{
+    RfidPresenceEvent _event;
+    _event.type = _type;
+    _event.reader = _entry->reader;
+    _event.id = _entry->id;
+    _event.time = _now;
+    _event.dwell = _type == RFID_PRESENCE_DEPARTED ? _entry->lastSeen - _entry->firstSeen : 0;
+
+    if (callback)
+    {
+        callback(_event);
+        return;
+    }
+
+    if (queueCount < RFID_PRESENCE_QUEUE_SIZE)
+    {
+        queue[(queueHead + queueCount) % RFID_PRESENCE_QUEUE_SIZE] = _event;
+        queueCount++;
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-PRESENCE.h
+ * @brief       Header file for the tag presence tracker (arrive and depart events).
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_PRESENCE__
+#define __RFID_PRESENCE__
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+// Presence event types.
+#define RFID_PRESENCE_ARRIVED  1
+#define RFID_PRESENCE_DEPARTED 2
+
+// Number of events kept for getEvent() when no callback is set.
+#define RFID_PRESENCE_QUEUE_SIZE 8
+
+// Entry states.
+#define RFID_PRESENCE_EMPTY   0
+#define RFID_PRESENCE_PENDING 1
+#define RFID_PRESENCE_PRESENT 2
+
+// One tracked tag on one reader.
+struct RfidPresenceEntry
+{
+    uint32_t id;
+    uint32_t firstSeen;
+    uint32_t lastSeen;
+    uint8_t reader;
+    uint8_t reads;
+    uint8_t state;
+};
+
+// Arrive or depart event.
+struct RfidPresenceEvent
+{
+    // RFID_PRESENCE_ARRIVED or RFID_PRESENCE_DEPARTED.
+    uint8_t type;
+
+    // Reader index and tag ID.
+    uint8_t reader;
+    uint32_t id;
+
+    // Time of the event in milliseconds (millis()).
+    uint32_t time;
+
+    // Time in milliseconds from the first to the last read of the tag (0 for RFID_PRESENCE_ARRIVED).
+    uint32_t dwell;
+};
+
+/**
+ * Turns the stream of repeated reads into arrive and depart events. Use RfidPresence<N> to get the tracker with the
+ * table for N tags (same tag on different readers uses separate entries).
+ *
+ * A tag arrives when it's read arriveReads times, each read within departMs of the previous one, so a single stray read
+ * is not an arrival. It departs when it's not read for departMs. Call seen() for every read (do not filter the reads
+ * with Rfid::setDuplicateFilter(), the tracker needs them all) and update() often, for example from loop().
+ */
+class RfidPresenceTracker
+{
+  public:
+    RfidPresenceTracker(RfidPresenceEntry *_entries, uint8_t _size);
+    void setThresholds(uint8_t _arriveReads, uint32_t _departMs);
+    void onEvent(void (*_callback)(const RfidPresenceEvent &_event));
+    bool seen(uint32_t _id, uint8_t _reader, uint32_t _now);
+    void update(uint32_t _now);
+    bool getEvent(RfidPresenceEvent *_event);
+    bool isPresent(uint32_t _id, uint8_t _reader);
+    uint8_t presentCount();
+    void clear();
+
+  private:
+    void emit(uint8_t _type, const RfidPresenceEntry *_entry, uint32_t _now);
+
+    // State table.
+    RfidPresenceEntry *entries;
+    uint8_t size;
+
+    // Number of reads needed for the arrival and the time without reads after which the tag departs.
+    uint8_t arriveReads = 2;
+    uint32_t departMs = 1000;
+
+    // Callback for the events, if not set events are queued for getEvent().
+    void (*callback)(const RfidPresenceEvent &_event) = NULL;
+
+    // Queue of the events for getEvent(), new events are dropped when it's full.
+    RfidPresenceEvent queue[RFID_PRESENCE_QUEUE_SIZE];
+    uint8_t queueHead = 0;
+    uint8_t queueCount = 0;
+};
+
+/**
+ * Presence tracker with the table for N tags.
+ */
+template <uint8_t N> class RfidPresence : public RfidPresenceTracker
+{
+  public:
+    RfidPresence() : RfidPresenceTracker(storage, N)
+    {
+    }
+
+  private:
+    RfidPresenceEntry storage[N];
+};
+
+#endif
@@ -11,42 +11,145 @@
 
 
 #include "RFID-SOLDERED.h"
+#include "RFID-CAPTURE.h"
+#include "RFID-DEDUP.h"
+#include "RFID-EM4100.h"
+#include "RFID-FORMAT.h"
+#include "RFID-LATENCY.h"
+#include "RFID-METRICS.h"
+#include <new>
+
+// ISRs are placed into IRAM on ESP32, other boards don't need it.
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
 
 /**
- * @brief                   Sensor specific native constructor.
+ * @brief                   Native (UART) constructor, the reader uses its own software serial.
  *
- * @param int _pin          Example parameter.
+ * @param                   int _rxPin
+ *                          Pin connected to the TX pin of the breakout.
+ * @param                   int _txPin
+ *                          Pin connected to the RX pin of the breakout.
+ * @param                   uint32_t _baud
+ *                          Baud rate set by the DIP switches of the breakout.
  */
 Rfid::Rfid(int _rxPin, int _txPin, uint32_t _baud)
 {
-    rfidSerial = new SoftwareSerial(_rxPin, _txPin);
     rxPin = _rxPin;
     txPin = _txPin;
     baudRate = _baud;
     native = 1;
+    createSerial();
+}
+
+/**
+ * @brief                   Native (UART) constructor with the serial that is already set up (for example hardware
+ *                          Serial1). The reader does not own the serial, call its begin() before Rfid::begin().
+ *
+ * @param                   Stream &_serial
+ *                          Serial connected to the breakout.
+ */
+Rfid::Rfid(Stream &_serial)
+{
+    rfidSerial = &_serial;
+    native = 1;
 }
 
+/**
+ * @brief                   easyC constructor.
+ */
 Rfid::Rfid()
 {
     native = 0;
 }
 
+/**
+ * @brief                   Move constructor. The software serial can't be moved while its interrupts point to it,
+ *                          so the other reader's serial is stopped and recreated in this one (bytes not read yet are
+ *                          lost).
+ *
+ * @param                   Rfid &&_other
+ *                          Reader to take over, it's left ended.
+ */
+Rfid::Rfid(Rfid &&_other)
+{
+    moveFrom(_other);
+}
+
+/**
+ * @brief                   Move assignment, ends this reader and takes over the other one (see the move constructor).
+ *
+ * @param                   Rfid &&_other
+ *                          Reader to take over, it's left ended.
+ *
+ * @return                  Rfid & - This reader.
+ */
+Rfid &Rfid::operator=(Rfid &&_other)
+{
+    if (this != &_other)
+    {
+        end();
+#if RFID_METRICS
+        setMetrics(NULL, NULL);
+#endif
+        moveFrom(_other);
+    }
+
+    return *this;
+}
+
+/**
+ * @brief                   Destructor, releases the software serial and its interrupts.
+ */
+Rfid::~Rfid()
+{
+    end();
+#if RFID_METRICS
+    setMetrics(NULL, NULL);
+#endif
+}
+
+/**
+ * @brief                   Stops the reader. Owned software serial is stopped (its pin interrupt is detached) and
+ *                          destroyed, begin() creates it again. Serial given to the constructor is left as it is.
+ */
+void Rfid::end()
+{
+#if defined(ESP32)
+    endTask();
+#endif
+    detachInterruptPin();
+    destroySerial();
+    beginDone = 0;
+    pollStep = RFID_POLL_RECEIVE;
+    pollLength = 0;
+}
+
 /**
  * @brief                   Initialization of the native mode (serial / UART communication with the RFID).
  */
 void Rfid::initializeNative()
 {
-    rfidSerial->begin(baudRate);
+    // Software serial is created again after end() (not for the reader that was moved from).
+    if (!rfidSerial && rxPin >= 0)
+        createSerial();
+
+    if (ownSerial)
+        ownSerial->begin(baudRate);
 }
 
 bool Rfid::checkHW()
 {
-    if (native)
+    if (native && rfidSerial)
     {
         // Send a ping command and wait for UART to sent it.
         rfidSerial->println("#rfping");
         rfidSerial->flush();
 
+        if (capture)
+            capture->tx((const uint8_t *)"#rfping\r\n", 9);
+
         // Wait a little bit.
         delay(15);
 
@@ -68,9 +171,13 @@ bool Rfid::checkHW()
     {
         // Ping the module on it's default I2C address.
         Wire.beginTransmission(address);
+        uint8_t _error = Wire.endTransmission();
+
+        if (capture)
+            capture->i2cWrite(NULL, 0, _error);
 
         // Received ACK? Retrun success!
-        if (!Wire.endTransmission())
+        if (!_error)
         {
             // Clear all previous data from the RFID reader.
             clear();
@@ -102,32 +209,229 @@ bool Rfid::available()
 
         // If the data is available and it's valid, return success.
         if (getTheSerialData(_serialBuffer, sizeof(_serialBuffer) / sizeof(char), SERIAL_TIMEOUT_MS))
+            _availableFlag = decodeFrame(_serialBuffer);
+    }
+    else
+    {
+        // With the adaptive polling the breakout is checked only when the interval is over.
+        if (!checkDue())
+            return false;
+
+        // To check if there is new RFID data avaialble, set register address to 0.
+        busAddress(0);
+
+        // Read the data (but first cast it to char*).
+        busRead((char *)(&_availableFlag), 1);
+        checkDone(_availableFlag);
+
+        // New tag, what was read for the previous one is not valid any more.
+        if (_availableFlag)
+            idCached = rawCached = false;
+
+        if (_availableFlag)
+            latencyBegin();
+
+        // To validate the frame or to filter duplicates, tag ID and RAW data must be read now. They are kept in the
+        // class until read by getId() and getRaw().
+        if (_availableFlag && (frameValidation || duplicateFilter))
         {
-            // Try to get the RFID tag ID.
-            char *_tagIdStart = strchr(_serialBuffer, '$');
-            char *_tagRawStart = strchr(_serialBuffer, '&');
-            if (_tagIdStart && _tagRawStart)
+            uint32_t _tagID;
+            uint64_t _rfidRaw;
+
+            busAddress(1);
+            busRead((char *)(&_tagID), 4);
+            busAddress(2);
+            busRead((char *)(&_rfidRaw), 8);
+
+            latencyStamp(RFID_LATENCY_FRAME);
+
+            if (!frameValidation || Em4100::validate(_rfidRaw, _tagID))
             {
-                // Get the ID by converting it from string to the int.
-                tagID = atol(_tagIdStart + 1);
-                rfidRAW = getUint64(_tagRawStart + 1);
+                tagID = _tagID;
+                rfidRAW = _rfidRaw;
+                idCached = rawCached = true;
 
-                // Check if the result is non-zero.
-                if (tagID && rfidRAW)
-                    _availableFlag = true;
+                latencyStamp(RFID_LATENCY_DECODE);
+            }
+            else
+            {
+                _availableFlag = false;
+                count(RFID_METRIC_INVALID);
             }
         }
     }
-    else
+
+    return filterTag(_availableFlag);
+}
+
+/**
+ * @brief                   Cooperative version of available() for the schedulers with the time slots. Does only as
+ *                          much of the receive, decode and bus work as fits into the budget and carries the rest over
+ *                          to the next call, so the call never waits for the serial timeout. UART frame ends with the
+ *                          new line (or when no byte comes for SERIAL_TIMEOUT_MS). easyC read is split into the
+ *                          steps (check, tag ID, RAW data), a step is started only if its last measured time fits
+ *                          into what is left of the budget (an I2C transaction itself can't be interrupted). With
+ *                          the INT pin (attachInterruptPin()) the easyC bus is used only after the edge, with the
+ *                          adaptive polling (setAdaptivePolling()) only when the check interval is over. With the
+ *                          onTag() callback the tag is passed to it, getId() and getRaw() are not needed.
+ *
+ * @param                   uint32_t _budgetMicros
+ *                          Time the call may take in microseconds.
+ *
+ * @return                  bool - True if a tag is ready, read it with getId() and getRaw() (easyC tag is already
+ *                          read, they don't use the bus).
+ */
+bool Rfid::poll(uint32_t _budgetMicros)
+{
+    uint32_t _start = micros();
+
+    if (native)
     {
-        // To check if there is new RFID data avaialble, set register address to 0.
-        sendAddress(0);
+        // Take the bytes that are already received, up to the end of the frame.
+        while (pollStep == RFID_POLL_RECEIVE && rfidSerial && rfidSerial->available() &&
+               (uint32_t)(micros() - _start) < _budgetMicros)
+        {
+            char _c = rfidSerial->read();
+            if (capture)
+                capture->rx(_c);
 
-        // Read the data (but first cast it to char*).
-        readData((char *)(&_availableFlag), 1);
+            // Drop the data that does not fit into the buffer (as getTheSerialData() does).
+            if (pollLength < sizeof(pollFrame) - 2)
+            {
+                latencyByte(!pollLength);
+                pollFrame[pollLength++] = _c;
+            }
+            else
+            {
+                count(RFID_METRIC_RX_DROPPED);
+            }
+            pollLastByte = millis();
+
+            if (_c == '\n')
+                pollStep = RFID_POLL_DECODE;
+        }
+
+        countSerial();
+
+        // Frame without the new line ends after the serial timeout.
+        if (pollStep == RFID_POLL_RECEIVE && pollLength &&
+            (unsigned long)(millis() - pollLastByte) >= SERIAL_TIMEOUT_MS)
+            pollStep = RFID_POLL_DECODE;
+
+        if (pollStep != RFID_POLL_DECODE || (uint32_t)(micros() - _start) >= _budgetMicros)
+            return false;
+
+        pollFrame[pollLength] = '\0';
+        pollLength = 0;
+        pollStep = RFID_POLL_RECEIVE;
+        takeEdge();
+
+        return deliver(filterTag(decodeFrame(pollFrame)));
     }
 
-    return _availableFlag;
+    // With the INT pin the bus is used only after the edge, the tag is there so the check is skipped.
+    if (intPin >= 0 && pollStep == RFID_POLL_RECEIVE)
+    {
+        if (!intArmed)
+            return false;
+
+        takeEdge();
+        pollStep = RFID_POLL_ID;
+        latencyBegin();
+    }
+
+    while (true)
+    {
+        // With the adaptive polling the breakout is checked only when the interval is over.
+        if (pollStep == RFID_POLL_RECEIVE && !checkDue())
+            return false;
+
+        // Start the next step only if it fits. The estimate of the skipped step is halved, so one slow transaction
+        // (bus stall) does not block the step forever.
+        uint32_t _elapsed = micros() - _start;
+        if (_elapsed >= _budgetMicros || _budgetMicros - _elapsed < pollStepMicros[pollStep])
+        {
+            pollStepMicros[pollStep] /= 2;
+            return false;
+        }
+
+        uint8_t _step = pollStep;
+        uint32_t _stepStart = micros();
+        int _error;
+
+        if (_step == RFID_POLL_RECEIVE)
+        {
+            // Check if there is new RFID data (register 0).
+            bool _availableFlag = false;
+            _error = busAddress(0);
+            if (!_error)
+                busRead((char *)(&_availableFlag), 1);
+            checkDone(_availableFlag);
+
+            if (_availableFlag)
+            {
+                latencyBegin();
+                pollStep = RFID_POLL_ID;
+            }
+        }
+        else if (_step == RFID_POLL_ID)
+        {
+            // Tag ID (register 1).
+            _error = busAddress(1);
+            if (!_error)
+                busRead((char *)(&pollTag.id), 4);
+            pollStep = RFID_POLL_DECODE;
+        }
+        else
+        {
+            // RFID RAW data (register 2).
+            _error = busAddress(2);
+            if (!_error)
+                busRead((char *)(&pollTag.raw), 8);
+            pollStep = RFID_POLL_RECEIVE;
+        }
+
+        // Longer than 65 ms only with a stuck bus, the estimate saturates.
+        uint32_t _stepMicros = micros() - _stepStart;
+        pollStepMicros[_step] = _stepMicros > 0xFFFF ? 0xFFFF : _stepMicros;
+
+        // Start over on a bus error, the breakout keeps the tag until it's read (and the INT pin stays high, so the
+        // read is armed again).
+        if (_error)
+        {
+            if (_step != RFID_POLL_RECEIVE && intPin >= 0)
+                intArmed = true;
+            pollStep = RFID_POLL_RECEIVE;
+            if (_step != RFID_POLL_RECEIVE)
+                latencyEnd();
+            return false;
+        }
+
+        // Nothing new, one check per call.
+        if (pollStep == RFID_POLL_RECEIVE && _step == RFID_POLL_RECEIVE)
+            return false;
+
+        if (_step == RFID_POLL_DECODE)
+        {
+            latencyStamp(RFID_LATENCY_FRAME);
+
+            bool _availableFlag = !frameValidation || Em4100::validate(pollTag.raw, pollTag.id);
+            idCached = rawCached = _availableFlag;
+            if (_availableFlag)
+            {
+                tagID = pollTag.id;
+                rfidRAW = pollTag.raw;
+
+                latencyStamp(RFID_LATENCY_DECODE);
+            }
+            else
+            {
+                count(RFID_METRIC_INVALID);
+            }
+
+            return deliver(filterTag(_availableFlag));
+        }
+    }
 }
 
 /**
@@ -139,24 +443,33 @@ uint32_t Rfid::getId()
 {
     uint32_t _tagID;
 
-    if (native)
+    // Tag ID already read by available() is used first (always for the native, with frame validation, duplicate
+    // filter or poll() for easyC).
+    if (native || idCached)
     {
         // Copy the tag ID into local variable.
         _tagID = tagID;
 
         // Clear the tag ID stored in the class.
         tagID = 0;
+        idCached = false;
     }
     else
     {
         // To read RFID tag ID, set register address to 1.
-        sendAddress(1);
+        busAddress(1);
 
         // Read the data (but first cast it to char*). RFID data is 4 bytes.
         // Tag ID is automatically cleared in the breakout after reading it.
-        readData((char *)(&_tagID), 4);
+        busRead((char *)(&_tagID), 4);
     }
 
+    latencyStamp(RFID_LATENCY_DELIVERED);
+    latencyEnd();
+
+    if (capture)
+        capture->tag(_tagID);
+
     // Retrun the result.
     return _tagID;
 }
@@ -170,22 +483,25 @@ uint64_t Rfid::getRaw()
 {
     uint64_t _rfidRaw;
 
-    if (native)
+    // RFID RAW data already read by available() is used first (always for the native, with frame validation,
+    // duplicate filter or poll() for easyC).
+    if (native || rawCached)
     {
         // Copy the RFID RAW data into local variable.
         _rfidRaw = rfidRAW;
 
         // Clear the RFID RAW data stored in the class.
         rfidRAW = 0;
+        rawCached = false;
     }
     else
     {
         // To read RFID RAW data, set register address to 2.
-        sendAddress(2);
+        busAddress(2);
 
         // Read the data (but first cast it to char*). RFID RAW data is 8 bytes.
         // RFID RAW data, is automatically cleared in the breakout after reading it.
-        readData((char *)(&_rfidRaw), 8);
+        busRead((char *)(&_rfidRaw), 8);
     }
 
     // Return the result.
@@ -200,22 +516,497 @@ uint64_t Rfid::getRaw()
  */
 void Rfid::printHex64(uint64_t _number)
 {
-    // Temporary array for storing 64 bit HEX value.
-    char _temp[17];
+    // Arduino can't print 64 bit numbers, so format it first.
+    RfidFormat::printHex64(Serial, _number);
+}
+
+/**
+ * @brief                   Constructs the owned software serial in the storage inside the reader.
+ */
+void Rfid::createSerial()
+{
+    ownSerial = new (serialStorage) SoftwareSerial(rxPin, txPin);
+    rfidSerial = ownSerial;
+    captureEdges();
+
+#if RFID_METRICS && defined(ARDUINO_ESP32_DEV)
+    // New serial counts from zero, its metrics keep counting on.
+    serialCounted = SoftwareSerialCounters();
+#endif
+}
+
+/**
+ * @brief                   Stops and destroys the owned software serial, if there is one.
+ */
+void Rfid::destroySerial()
+{
+    if (ownSerial)
+    {
+        countSerial();
+
+        // Destructor also ends the serial (detaches its pin interrupt and frees its buffers).
+        ownSerial->~SoftwareSerial();
+        ownSerial = NULL;
+        rfidSerial = NULL;
+    }
+}
+
+/**
+ * @brief                   Takes over the settings and the serial of the other reader, leaving it ended.
+ *
+ * @param                   Rfid &_other
+ *                          Reader to take over.
+ */
+void Rfid::moveFrom(Rfid &_other)
+{
+    native = _other.native;
+    address = _other.address;
+    err = _other.err;
+    rxPin = _other.rxPin;
+    txPin = _other.txPin;
+    baudRate = _other.baudRate;
+    tagID = _other.tagID;
+    rfidRAW = _other.rfidRAW;
+    idCached = _other.idCached;
+    rawCached = _other.rawCached;
+    frameValidation = _other.frameValidation;
+    duplicateFilter = _other.duplicateFilter;
+#if RFID_LATENCY_STATS
+    latencyStats = _other.latencyStats;
+    lastByteMicros = _other.lastByteMicros;
+#endif
+    capture = _other.capture;
+    pollStep = _other.pollStep;
+    if (native)
+        memcpy(pollFrame, _other.pollFrame, sizeof(pollFrame));
+    else
+        pollTag = _other.pollTag;
+    pollLength = _other.pollLength;
+    pollLastByte = _other.pollLastByte;
+    memcpy(pollStepMicros, _other.pollStepMicros, sizeof(pollStepMicros));
+#if RFID_ADAPTIVE_POLLING
+    adaptive = _other.adaptive;
+    adaptiveFast = _other.adaptiveFast;
+    adaptiveCeiling = _other.adaptiveCeiling;
+    adaptiveBurstMs = _other.adaptiveBurstMs;
+    adaptiveInterval = _other.adaptiveInterval;
+    adaptiveLastCheck = _other.adaptiveLastCheck;
+    adaptiveLastTag = _other.adaptiveLastTag;
+    adaptiveBurst = _other.adaptiveBurst;
+#endif
+#if RFID_BUS_STATS
+    busMicros = _other.busMicros;
+    busChecks = _other.busChecks;
+    busWindowStart = _other.busWindowStart;
+    busLastUtilization = _other.busLastUtilization;
+    busLastRate = _other.busLastRate;
+#endif
+#if RFID_METRICS
+    metrics = _other.metrics;
+    metricsRegistry = _other.metricsRegistry;
+    busMetrics = _other.busMetrics;
+    _other.metrics = NULL;
+    _other.metricsRegistry = NULL;
+    _other.busMetrics = NULL;
+#if defined(ARDUINO_ESP32_DEV)
+    serialMetrics = _other.serialMetrics;
+    _other.serialMetrics = NULL;
+#endif
+#endif
+    pollEdge = _other.pollEdge;
+    pollEdgeMillis = _other.pollEdgeMillis;
+    tagCallback = _other.tagCallback;
+    int _intPin = _other.intPin;
+    int _intMode = _other.intMode;
+
+    bool _begun = _other.beginDone;
+    bool _owned = _other.ownSerial != NULL;
+    Stream *_serial = _other.rfidSerial;
+    _other.end();
+    _other.rfidSerial = NULL;
+
+    if (_owned)
+    {
+        createSerial();
+        if (_begun)
+            ownSerial->begin(baudRate);
+    }
+    else
+    {
+        rfidSerial = _serial;
+    }
+    beginDone = _begun;
+
+    // ISR of the INT pin gets this reader.
+    if (_intPin >= 0)
+        attachInterruptPin(_intPin, _intMode);
+}
+
+/**
+ * @brief                   Passes the edges seen by the owned software serial to the capture (ESP32 only, the AVR
+ *                          SoftwareSerial does not timestamp the edges).
+ */
+void Rfid::captureEdges()
+{
+#if defined(ARDUINO_ESP32_DEV)
+    if (!ownSerial)
+        return;
+
+    if (capture && capture->capturing(RFID_CAPTURE_EDGES))
+    {
+        ownSerial->onRxEdge(Delegate<void(uint32_t), void *>(
+            [](void *_capture, uint32_t _isrCycle) { ((RfidCapture *)_capture)->edge(_isrCycle); }, capture));
+    }
+    else
+    {
+        ownSerial->onRxEdge(nullptr);
+    }
+#endif
+}
+
+/**
+ * @brief                   Sets the easyC register address, recording it in the capture.
+ *
+ * @param                   char _reg
+ *                          Register address.
+ *
+ * @return                  int - Wire.endTransmission() result.
+ */
+int Rfid::busAddress(char _reg)
+{
+    uint32_t _start = micros();
+    int _error = sendAddress(_reg);
+    busTime(_start);
+    countBus(RFID_METRIC_EASYC_WRITES, _error, _error);
+
+    if (capture)
+        capture->i2cWrite((const uint8_t *)&_reg, 1, _error);
+
+    return _error;
+}
+
+/**
+ * @brief                   Reads the easyC register, recording the data in the capture.
+ *
+ * @param                   char *_data
+ *                          Buffer for the data.
+ * @param                   int _n
+ *                          Number of bytes to read.
+ */
+void Rfid::busRead(char *_data, int _n)
+{
+    // Same as EasyC::readData(), but keeps the number of the bytes received for the metrics.
+    uint32_t _start = micros();
+    int _received = Wire.requestFrom(address, _n);
+    Wire.readBytes(_data, _n);
+    busTime(_start);
+    countBus(RFID_METRIC_EASYC_READS, _received < _n, 0);
+
+    if (capture)
+        capture->i2cRead((const uint8_t *)_data, _n);
+}
+
+/**
+ * @brief                   Adds the time of the easyC transaction to the bus utilisation.
+ *
+ * @param                   uint32_t _start
+ *                          Time the transaction started, micros().
+ */
+void Rfid::busTime(uint32_t _start)
+{
+#if RFID_BUS_STATS || RFID_METRICS
+    uint32_t _now = micros();
+    count(RFID_METRIC_BUS_MICROS, _now - _start);
+#if RFID_BUS_STATS
+    busMicros += _now - _start;
+    busWindow(_now);
+#endif
+#endif
+}
+
+/**
+ * @brief                   Adds to the counter of the reader metrics, if they are registered.
+ *
+ * @param                   uint8_t _metric
+ *                          Counter (RFID_METRIC_*).
+ * @param                   uint32_t _n
+ *                          Amount to add.
+ */
+void Rfid::count(uint8_t _metric, uint32_t _n)
+{
+#if RFID_METRICS
+    if (metrics)
+        metrics[_metric] += _n;
+#endif
+}
+
+/**
+ * @brief                   Counts the easyC transaction in the bus metrics, if they are registered.
+ *
+ * @param                   uint8_t _metric
+ *                          RFID_METRIC_EASYC_WRITES or RFID_METRIC_EASYC_READS.
+ * @param                   bool _failed
+ *                          True if the transaction failed (NACK or fewer bytes received).
+ * @param                   int _error
+ *                          Wire.endTransmission() result of the write, kept as the last error.
+ */
+void Rfid::countBus(uint8_t _metric, bool _failed, int _error)
+{
+#if RFID_METRICS
+    if (!busMetrics)
+        return;
+
+    busMetrics[_metric]++;
+    if (_failed)
+        busMetrics[RFID_METRIC_EASYC_ERRORS]++;
+    if (_metric == RFID_METRIC_EASYC_WRITES)
+        busMetrics[RFID_METRIC_EASYC_LAST_ERROR] = _error;
+#endif
+}
+
+/**
+ * @brief                   Adds what the own software serial counted since the last call to its metrics, if they are
+ *                          registered (ESP32 only, the AVR SoftwareSerial has no counters).
+ */
+void Rfid::countSerial()
+{
+#if RFID_METRICS && defined(ARDUINO_ESP32_DEV)
+    if (!serialMetrics || !ownSerial)
+        return;
+
+    const SoftwareSerialCounters &_counters = ownSerial->counters();
+    serialMetrics[RFID_METRIC_SERIAL_RX_BYTES] += _counters.rxBytes - serialCounted.rxBytes;
+    serialMetrics[RFID_METRIC_SERIAL_TX_BYTES] += _counters.txBytes - serialCounted.txBytes;
+    serialMetrics[RFID_METRIC_SERIAL_OVERFLOWS] += _counters.overflows - serialCounted.overflows;
+    serialMetrics[RFID_METRIC_SERIAL_ISR_OVERFLOWS] += _counters.isrOverflows - serialCounted.isrOverflows;
+    serialMetrics[RFID_METRIC_SERIAL_FRAMING_ERRORS] += _counters.framingErrors - serialCounted.framingErrors;
+    serialCounted = _counters;
+#endif
+}
+
+/**
+ * @brief                   Starts the latency measurement of a tag, if the latency stats are used.
+ */
+void Rfid::latencyBegin()
+{
+#if RFID_LATENCY_STATS
+    if (latencyStats)
+        latencyStats->begin(micros());
+#endif
+}
+
+/**
+ * @brief                   Timestamps the received UART byte, if the latency stats are used. The first byte of the
+ *                          frame starts the measurement.
+ *
+ * @param                   bool _first
+ *                          True for the first byte of the frame.
+ */
+void Rfid::latencyByte(bool _first)
+{
+#if RFID_LATENCY_STATS
+    if (!latencyStats)
+        return;
+
+    lastByteMicros = micros();
+    if (_first)
+        latencyStats->begin(lastByteMicros);
+#endif
+}
+
+/**
+ * @brief                   Records the time of the stage of the current read, if the latency stats are used.
+ *
+ * @param                   uint8_t _stage
+ *                          Stage (RFID_LATENCY_*).
+ */
+void Rfid::latencyStamp(uint8_t _stage)
+{
+#if RFID_LATENCY_STATS
+    if (latencyStats)
+        latencyStats->stamp(_stage, micros());
+#endif
+}
+
+/**
+ * @brief                   Ends the latency measurement of the current read, if the latency stats are used.
+ */
+void Rfid::latencyEnd()
+{
+#if RFID_LATENCY_STATS
+    if (latencyStats)
+        latencyStats->end();
+#endif
+}
+
+#if RFID_BUS_STATS
+/**
+ * @brief                   Closes the window of the bus utilisation and the check rate if it's over and starts a new
+ *                          one.
+ *
+ * @param                   uint32_t _now
+ *                          Current time, micros().
+ */
+void Rfid::busWindow(uint32_t _now)
+{
+    uint32_t _elapsed = _now - busWindowStart;
+    if (_elapsed < RFID_BUS_WINDOW_US)
+        return;
+
+    busLastUtilization = busMicros * 100.0 / _elapsed;
+    busLastRate = busChecks * 1000000.0 / _elapsed;
+    busMicros = 0;
+    busChecks = 0;
+    busWindowStart = _now;
+}
+#endif
+
+/**
+ * @brief                   Checks if the easyC breakout should be checked for a new tag now (always without the
+ *                          adaptive polling).
+ *
+ * @return                  bool - True if the check interval is over.
+ */
+bool Rfid::checkDue()
+{
+#if RFID_ADAPTIVE_POLLING
+    return !adaptive || (uint32_t)(micros() - adaptiveLastCheck) >= adaptiveInterval;
+#else
+    return true;
+#endif
+}
 
-    // Convert 64 bit integer into HEX char array (since Arduino can't print 64 bit numbers).
-    for (int i = 60; i >= 0; i -= 4)
+/**
+ * @brief                   Counts the easyC check and sets the next check interval: the fast interval after a tag and
+ *                          for the burst time after it, then doubled after each check without a tag, up to the
+ *                          ceiling.
+ *
+ * @param                   bool _availableFlag
+ *                          True if the breakout had a tag.
+ */
+void Rfid::checkDone(bool _availableFlag)
+{
+#if RFID_BUS_STATS
+    busChecks++;
+#endif
+    count(RFID_METRIC_BUS_CHECKS);
+#if RFID_ADAPTIVE_POLLING
+    if (!adaptive)
+        return;
+
+    adaptiveLastCheck = micros();
+    if (_availableFlag)
+    {
+        adaptiveBurst = true;
+        adaptiveLastTag = millis();
+        adaptiveInterval = adaptiveFast;
+    }
+    else if (adaptiveBurst && (unsigned long)(millis() - adaptiveLastTag) < adaptiveBurstMs)
+    {
+        adaptiveInterval = adaptiveFast;
+    }
+    else
     {
-        // Go trough the whole 64 bit number, take 4 bits, convert them into char (HEX char), store them and move by
-        // next 4 bits.
-        _temp[15 - (i / 4)] = intToHex((_number >> i) & 0x0F);
+        adaptiveBurst = false;
+        adaptiveInterval = adaptiveInterval > adaptiveCeiling / 2 ? adaptiveCeiling : adaptiveInterval * 2;
     }
 
-    // Add null-terminating char at the end of the string.
-    _temp[16] = '\0';
+#if RFID_METRICS
+    if (metrics)
+        metrics[RFID_METRIC_POLL_INTERVAL] = adaptiveInterval;
+#endif
+#endif
+}
 
-    // Print hex int to the serial.
-    Serial.print(_temp);
+/**
+ * @brief                   Time left until the next easyC check of the adaptive polling.
+ *
+ * @return                  uint32_t - Time in microseconds, 0 if the check is due or the adaptive polling is off.
+ */
+uint32_t Rfid::checkWait()
+{
+#if RFID_ADAPTIVE_POLLING
+    uint32_t _elapsed = micros() - adaptiveLastCheck;
+    return !adaptive || _elapsed >= adaptiveInterval ? 0 : adaptiveInterval - _elapsed;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief                   Gets the tag ID and the RFID RAW data from the UART frame ("$<tag ID>&<RAW in HEX>") and
+ *                          validates them.
+ *
+ * @param                   char *_frame
+ *                          Null-terminated frame.
+ *
+ * @return                  bool - True if the frame holds a valid tag, false if not.
+ */
+bool Rfid::decodeFrame(char *_frame)
+{
+    // Try to get the RFID tag ID.
+    char *_tagIdStart = strchr(_frame, '$');
+    char *_tagRawStart = strchr(_frame, '&');
+    if (!_tagIdStart || !_tagRawStart)
+    {
+        count(RFID_METRIC_INVALID);
+        return false;
+    }
+
+    // Get the ID by converting it from string to the int (unsigned, tag ID can use all 32 bits).
+    tagID = strtoul(_tagIdStart + 1, NULL, 10);
+    rfidRAW = getUint64(_tagRawStart + 1);
+
+#if RFID_LATENCY_STATS
+    // The frame is complete with its last byte.
+    if (latencyStats)
+        latencyStats->stamp(RFID_LATENCY_FRAME, lastByteMicros);
+#endif
+
+    // Check if the result is non-zero and if the frame is valid.
+    if (tagID && rfidRAW && (!frameValidation || Em4100::validate(rfidRAW, tagID)))
+    {
+        latencyStamp(RFID_LATENCY_DECODE);
+
+        return true;
+    }
+
+    // Drop the corrupted tag data.
+    tagID = 0;
+    rfidRAW = 0;
+    count(RFID_METRIC_INVALID);
+    return false;
+}
+
+/**
+ * @brief                   Drops the repeated reads of the same tag and ends the latency measurement of the dropped
+ *                          reads.
+ *
+ * @param                   bool _availableFlag
+ *                          True if a tag was read.
+ *
+ * @return                  bool - True if the tag is passed to the application.
+ */
+bool Rfid::filterTag(bool _availableFlag)
+{
+    // Drop the repeated reads of the same tag.
+    if (_availableFlag && duplicateFilter && !duplicateFilter->check(tagID, millis()))
+    {
+        tagID = 0;
+        rfidRAW = 0;
+        idCached = rawCached = false;
+        _availableFlag = false;
+        count(RFID_METRIC_DUPLICATES);
+    }
+
+    if (_availableFlag)
+        count(RFID_METRIC_TAGS);
+
+    // Dropped reads are not measured any further.
+    if (!_availableFlag)
+        latencyEnd();
+
+    return _availableFlag;
 }
 
 /**
@@ -242,7 +1033,7 @@ bool Rfid::getTheSerialData(char *_data, int _n, int _serialTimeout)
     int n = 0;
 
     // If there is something in the serial buffer, try to read that data.
-    if (rfidSerial->available())
+    if (rfidSerial && rfidSerial->available())
     {
         // Read chars until you hit the timeout.
         while ((unsigned long)(millis() - _timeout) < _serialTimeout)
@@ -253,8 +1044,14 @@ bool Rfid::getTheSerialData(char *_data, int _n, int _serialTimeout)
                 // Check if there is still memory available in the buffer. If not start "dropping" incoming data.
                 if (n < (_n - 2))
                 {
+                    // Timestamp the first and the last byte for the latency stats.
+                    latencyByte(!n);
+
                     // Save it to the local buffer.
-                    _data[n++] = rfidSerial->read();
+                    _data[n] = rfidSerial->read();
+                    if (capture)
+                        capture->rx(_data[n]);
+                    n++;
 
                     // Update the timeout.
                     _timeout = millis();
@@ -262,12 +1059,18 @@ bool Rfid::getTheSerialData(char *_data, int _n, int _serialTimeout)
                 else
                 {
                     // Drop the incoming data.
-                    rfidSerial->read();
+                    int _dropped = rfidSerial->read();
+                    count(RFID_METRIC_RX_DROPPED);
+                    if (capture)
+                        capture->rx(_dropped);
                 }
             }
         }
     }
 
+    // Bytes received and sent by the software serial go into its metrics.
+    countSerial();
+
     // Add a null-terminating char at the end of the array.
     _data[n] = '\0';
 
@@ -357,32 +1160,503 @@ uint64_t Rfid::get16Base(int _exp)
 }
 
 /**
- * @brief                   Converts integer (from 0 to 15) to HEX char.
+ * @brief                   Enables or disables the EM4100 frame validation. When enabled, available()
+ *                          checks the frame header, row and column parities, stop bit and compares the tag ID in the
+ *                          frame with the tag ID reported by the breakout. Tags that fail the check are dropped.
+ *                          Disabled by default.
+ *
+ * @param                   bool _enable
+ *                          True to enable, false to disable the frame validation.
+ */
+void Rfid::setFrameValidation(bool _enable)
+{
+    frameValidation = _enable;
+}
+
+/**
+ * @brief                   Sets the cache used to drop repeated reads of the same tag, for example while the card
+ *                          rests on the antenna. Repeated reads are dropped by available() and are never returned.
  *
- * @param                   uint8_t _n
- *                          Number that will be converted into HEX char.
+ * @param                   RfidDedup *_filter
+ *                          Pointer to the duplicate suppression cache (RfidDedupCache). NULL disables the filter.
+ */
+void Rfid::setDuplicateFilter(RfidDedup *_filter)
+{
+    duplicateFilter = _filter;
+}
+
+#if RFID_LATENCY_STATS
+/**
+ * @brief                   Sets the histograms that measure the latency of each read, from the INT edge (if marked by
+ *                          RfidLatencyStats::markEdge() in the ISR) or the first byte to the frame, the decode and
+ *                          the getId().
  *
- * @return                  char - Converted HEX char.
+ * @param                   RfidLatencyStats *_stats
+ *                          Pointer to the latency stats of this reader. NULL disables the measurement.
  */
-char Rfid::intToHex(uint8_t _n)
+void Rfid::setLatencyStats(RfidLatencyStats *_stats)
 {
-    // Only numbers from 0 to 15 are allowed.
-    _n &= 0x0F;
+    latencyStats = _stats;
+}
+#endif
 
-    // Variable used to store return value.
-    char _result = 0;
+/**
+ * @brief                   Sets the capture of the traffic: the UART bytes read and written, the easyC transactions
+ *                          and, for the software serial on ESP32, the edges on the RX pin. Tag IDs returned by
+ *                          getId() are recorded too. Set it after begin(), the
+ *                          capture header holds the interface, the baud rate and the easyC address.
+ *
+ * @param                   RfidCapture *_capture
+ *                          Pointer to the capture, started by RfidCapture::begin(). NULL stops capturing.
+ */
+void Rfid::setCapture(RfidCapture *_capture)
+{
+    capture = _capture;
+
+    if (capture)
+    {
+        uint16_t _cpuMhz = 0;
+#if defined(ARDUINO_ESP32_DEV)
+        if (ownSerial && capture->capturing(RFID_CAPTURE_EDGES))
+            _cpuMhz = ESP.getCpuFreqMHz();
+#endif
+        capture->header(native, baudRate, address, _cpuMhz);
+    }
 
-    // If the number is between 0 and 9, convert it into ASCII number.
-    if (_n >= 0 && _n <= 9)
-        _result = _n + '0';
+    captureEdges();
+}
 
-    // If the number is between 10 and 15, convert it into ASCII letter (from A to F).
-    if (_n >= 10 && _n <= 15)
-        _result = (_n - 10) + 'A';
+#if RFID_ADAPTIVE_POLLING
+/**
+ * @brief                   Enables or disables the adaptive polling of the easyC breakout (without the INT pin).
+ *                          available() and poll() then check the breakout only when the check interval is over and
+ *                          return false right away before it, without using the bus. Interval doubles after each
+ *                          check without a tag, up to the ceiling, so the idle reader barely uses the bus. After a
+ *                          tag the fast interval is used for the burst time, so the next tags are found quickly.
+ *                          Tag can wait in the breakout up to the ceiling before it's found.
+ *
+ * @param                   bool _enable
+ *                          True to enable, false to check the breakout at every call (default).
+ * @param                   uint32_t _fastMicros
+ *                          Check interval after a tag in microseconds.
+ * @param                   uint32_t _ceilingMicros
+ *                          Longest check interval while no tag comes in microseconds.
+ * @param                   uint32_t _burstMs
+ *                          Time the fast interval is kept after the last tag in milliseconds.
+ */
+void Rfid::setAdaptivePolling(bool _enable, uint32_t _fastMicros, uint32_t _ceilingMicros, uint32_t _burstMs)
+{
+    adaptive = _enable;
+    adaptiveFast = _fastMicros ? _fastMicros : 1;
+    adaptiveCeiling = _ceilingMicros > adaptiveFast ? _ceilingMicros : adaptiveFast;
+    adaptiveBurstMs = _burstMs;
+    adaptiveBurst = false;
 
-    // Return the result.
-    return _result;
+    // First check is due right away.
+    adaptiveInterval = adaptiveFast;
+    adaptiveLastCheck = micros() - adaptiveInterval;
+
+#if RFID_METRICS
+    if (metrics)
+        metrics[RFID_METRIC_POLL_INTERVAL] = pollInterval();
+#endif
+}
+
+/**
+ * @brief                   Gets the current check interval of the adaptive polling.
+ *
+ * @return                  uint32_t - Interval in microseconds, 0 if the adaptive polling is off.
+ */
+uint32_t Rfid::pollInterval()
+{
+    return adaptive ? adaptiveInterval : 0;
+}
+#endif
+
+#if RFID_BUS_STATS
+/**
+ * @brief                   Gets the rate of the easyC checks (tag available register reads) measured over the last
+ *                          full window of RFID_BUS_WINDOW_US.
+ *
+ * @return                  float - Checks per second.
+ */
+float Rfid::pollRate()
+{
+    busWindow(micros());
+    return busLastRate;
+}
+
+/**
+ * @brief                   Gets the part of the time the reader spent in the easyC transactions over the last full
+ *                          window of RFID_BUS_WINDOW_US.
+ *
+ * @return                  float - Bus utilisation in percent.
+ */
+float Rfid::busUtilization()
+{
+    busWindow(micros());
+    return busLastUtilization;
+}
+#endif
+
+#if RFID_METRICS
+/**
+ * @brief                   Registers the metrics of the reader (RFID_METRIC_*) in the registry, with the metrics of
+ *                          its easyC bus (RFID_METRIC_EASYC_*) or of its own software serial on ESP32
+ *                          (RFID_METRIC_SERIAL_*), so the health of the reader can be sent with
+ *                          RfidMetrics::snapshot(). Counters start at zero and are updated as the reader runs.
+ *
+ * @param                   RfidMetrics *_metrics
+ *                          Registry, NULL removes the metrics of the reader from the registry they are in.
+ * @param                   const char *_source
+ *                          Name of the reader in the metrics (string literal, without spaces and commas).
+ *
+ * @return                  bool - True if registered, false if the registry is full (nothing is registered then).
+ */
+bool Rfid::setMetrics(RfidMetrics *_metrics, const char *_source)
+{
+    static const char *const _names[] = {"tags",       "invalid",   "duplicates",   "rx_dropped",
+                                         "bus_checks", "bus_us",    "task_dropped", "poll_interval_us"};
+    static const char *const _busNames[] = {"writes", "reads", "errors", "last_error"};
+#if defined(ARDUINO_ESP32_DEV)
+    static const char *const _serialNames[] = {"rx_bytes", "tx_bytes", "overflows", "isr_overflows",
+                                               "framing_errors"};
+#endif
+
+    if (metricsRegistry)
+    {
+        metricsRegistry->remove(metrics);
+        metricsRegistry->remove(busMetrics);
+#if defined(ARDUINO_ESP32_DEV)
+        metricsRegistry->remove(serialMetrics);
+#endif
+    }
+    metrics = NULL;
+    metricsRegistry = NULL;
+    busMetrics = NULL;
+#if defined(ARDUINO_ESP32_DEV)
+    serialMetrics = NULL;
+#endif
+
+    if (!_metrics)
+        return true;
+
+    metrics = _metrics->add("rfid", _source, _names, 7, 1);
+    if (!metrics)
+        return false;
+    metricsRegistry = _metrics;
+#if RFID_ADAPTIVE_POLLING
+    metrics[RFID_METRIC_POLL_INTERVAL] = pollInterval();
+#endif
+
+    bool _registered = true;
+    if (!native)
+    {
+        busMetrics = _metrics->add("easyc", _source, _busNames, 3, 1);
+        _registered = busMetrics != NULL;
+    }
+#if defined(ARDUINO_ESP32_DEV)
+    if (ownSerial && _registered)
+    {
+        // Only what the serial counts from now on goes into the metrics.
+        serialCounted = ownSerial->counters();
+        serialMetrics = _metrics->add("serial", _source, _serialNames, 5, 0);
+        _registered = serialMetrics != NULL;
+    }
+#endif
+
+    if (!_registered)
+        setMetrics(NULL, NULL);
+
+    return _registered;
+}
+#endif
+
+/**
+ * @brief                   Attaches the library ISR to the INT pin of the breakout. The ISR timestamps the edge and
+ *                          arms the read, poll() (or the reader task, which sleeps until the edge) then reads the tag
+ *                          and passes it to the onTag() callback, so the bus is not polled while there are no tags.
+ *                          Works for UART and easyC. On AVR only one reader can use the INT pin.
+ *
+ * @param                   uint8_t _pin
+ *                          Pin connected to the INT pin of the breakout.
+ * @param                   int _mode
+ *                          Interrupt mode, the breakout sets INT high when it has a tag (RISING).
+ *
+ * @return                  bool - True if attached, false if the pin has no interrupt (or on AVR, another reader uses
+ *                          it).
+ */
+bool Rfid::attachInterruptPin(uint8_t _pin, int _mode)
+{
+    if (digitalPinToInterrupt(_pin) == NOT_AN_INTERRUPT)
+        return false;
+
+#if !defined(ESP32)
+    if (intReader && intReader != this)
+        return false;
+#endif
+
+    detachInterruptPin();
+    pinMode(_pin, INPUT);
+    intPin = _pin;
+    intMode = _mode;
+
+    // Tag that came before the interrupt was attached holds the pin at its level, there will be no edge for it.
+    intArmed = (_mode == RISING && digitalRead(_pin) == HIGH) || (_mode == FALLING && digitalRead(_pin) == LOW);
+    intMillis = millis();
+
+#if defined(ESP32)
+    attachInterruptArg(digitalPinToInterrupt(_pin), intIsr, this, _mode);
+#else
+    intReader = this;
+    attachInterrupt(digitalPinToInterrupt(_pin), intIsrStatic, _mode);
+#endif
+
+    return true;
+}
+
+/**
+ * @brief                   Detaches the library ISR from the INT pin, poll() goes back to polling the breakout.
+ */
+void Rfid::detachInterruptPin()
+{
+    if (intPin < 0)
+        return;
+
+    detachInterrupt(digitalPinToInterrupt(intPin));
+    intPin = -1;
+    intArmed = false;
+
+#if !defined(ESP32)
+    intReader = NULL;
+#endif
+}
+
+/**
+ * @brief                   Sets the callback for the tags read by poll() and by the reader task. The tag is passed to
+ *                          the callback as the TagEvent (with the time of the INT edge if the INT pin is used), from
+ *                          the task that polls (loop() or the reader task).
+ *
+ * @param                   RfidTagCallback _callback
+ *                          Callback, nullptr to read the tags with getId() and getRaw() again.
+ */
+void Rfid::onTag(RfidTagCallback _callback)
+{
+    tagCallback = _callback;
+}
+
+/**
+ * @brief                   ISR of the INT pin, arms the read.
+ *
+ * @param                   void *_rfid
+ *                          Reader.
+ */
+void IRAM_ATTR Rfid::intIsr(void *_rfid)
+{
+    Rfid *_reader = (Rfid *)_rfid;
+    _reader->intMillis = millis();
+    _reader->intArmed = true;
+
+#if RFID_LATENCY_STATS
+    if (_reader->latencyStats)
+        _reader->latencyStats->markEdge();
+#endif
+
+#if defined(ESP32)
+    // Wake the reader task.
+    if (_reader->task)
+    {
+        BaseType_t _woken = pdFALSE;
+        vTaskNotifyGiveFromISR(_reader->task, &_woken);
+        if (_woken)
+            portYIELD_FROM_ISR();
+    }
+#endif
+}
+
+#if !defined(ESP32)
+Rfid *Rfid::intReader = NULL;
+
+/**
+ * @brief                   ISR of the INT pin for attachInterrupt() without the argument.
+ */
+void Rfid::intIsrStatic()
+{
+    if (intReader)
+        intIsr(intReader);
+}
+#endif
+
+/**
+ * @brief                   Takes the INT edge that armed the read, its time is the timestamp of the tag.
+ */
+void Rfid::takeEdge()
+{
+    if (intArmed)
+    {
+        intArmed = false;
+        pollEdge = true;
+        pollEdgeMillis = intMillis;
+    }
+}
+
+/**
+ * @brief                   Passes the tag read by poll() to the onTag() callback, if there is one.
+ *
+ * @param                   bool _availableFlag
+ *                          True if a tag was read.
+ *
+ * @return                  bool - _availableFlag.
+ */
+bool Rfid::deliver(bool _availableFlag)
+{
+    if (_availableFlag && tagCallback)
+    {
+        TagEvent _event = makeEvent();
+        tagCallback(_event);
+    }
+
+    return _availableFlag;
+}
+
+/**
+ * @brief                   Takes the tag read by poll() into the TagEvent.
+ *
+ * @return                  TagEvent - Tag, with the time of the INT edge (or the current time without the INT pin).
+ */
+TagEvent Rfid::makeEvent()
+{
+    TagEvent _event = TagEvent();
+    _event.id = getId();
+    _event.raw = getRaw();
+    _event.timestamp = pollEdge ? pollEdgeMillis : millis();
+    pollEdge = false;
+#if defined(ESP32)
+    _event.reader = taskConfig.reader;
+#endif
+
+    return _event;
+}
+
+#if defined(ESP32)
+/**
+ * @brief                   Starts the reader task. The task owns the reader: it polls the breakout, decodes,
+ *                          validates and filters the tags and pushes them into the queue, so the application code that
+ *                          blocks (WiFi, TLS) does not delay or drop the reads. Don't call available(), poll(),
+ *                          getId() or getRaw() while the task runs, take the tags from the queue (or from the onTag()
+ *                          callback, it's called from the task and the queue is not used then). Call it after
+ *                          begin(). The task is stopped by endTask() and end(), a moved reader does not take it over.
+ *
+ * @param                   RfidEventQueue &_queue
+ *                          Queue for the tags, it must live as long as the task runs.
+ * @param                   const RfidTaskConfig &_config
+ *                          Priority, core, stack size and polling of the task.
+ *
+ * @return                  bool - True if the task is started, false if it already runs, the reader is not started or
+ *                          the task can't be created.
+ */
+bool Rfid::beginTask(RfidEventQueue &_queue, const RfidTaskConfig &_config)
+{
+    if (task || !beginDone)
+        return false;
+
+    taskQueue = &_queue;
+    taskConfig = _config;
+    taskStop = false;
+    taskDropped = 0;
+
+    if (xTaskCreatePinnedToCore(taskLoop, "rfid", taskConfig.stackSize, this, taskConfig.priority, &task,
+                                taskConfig.core) != pdPASS)
+    {
+        task = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief                   Stops the reader task and waits until it ends. Tags already in the queue are kept.
+ */
+void Rfid::endTask()
+{
+    if (!task)
+        return;
+
+    // Called from the task itself (for example from a callback), it ends when it checks the flag.
+    taskStop = true;
+    if (xTaskGetCurrentTaskHandle() == task)
+        return;
+
+    // Task may sleep until the INT edge.
+    xTaskNotifyGive(task);
+
+    while (task)
+        delay(1);
+}
+
+/**
+ * @brief                   Checks if the reader task runs.
+ *
+ * @return                  bool - True if it runs.
+ */
+bool Rfid::taskRunning()
+{
+    return task != NULL;
+}
+
+/**
+ * @brief                   Number of tags the reader task dropped because the queue was full, since beginTask().
+ *
+ * @return                  uint32_t - Dropped tags.
+ */
+uint32_t Rfid::droppedEvents()
+{
+    return taskDropped;
+}
+
+/**
+ * @brief                   Reader task. Polls the reader with the budget, sleeping between the polls while there is
+ *                          nothing to read (until the INT edge with the INT pin).
+ *
+ * @param                   void *_rfid
+ *                          Reader.
+ */
+void Rfid::taskLoop(void *_rfid)
+{
+    Rfid *_reader = (Rfid *)_rfid;
+
+    while (!_reader->taskStop)
+    {
+        if (_reader->poll(_reader->taskConfig.budgetMicros))
+        {
+            // Tag is already passed to the onTag() callback if there is one.
+            if (!_reader->tagCallback && !_reader->taskQueue->push(_reader->makeEvent()))
+            {
+                _reader->taskDropped++;
+                _reader->count(RFID_METRIC_TASK_DROPPED);
+            }
+        }
+        else
+        {
+            // With the INT pin the task sleeps until the ISR wakes it, unless a frame is being received. With the
+            // adaptive polling it sleeps until the next check.
+            bool _idle = _reader->intPin >= 0 && !_reader->intArmed && _reader->pollStep == RFID_POLL_RECEIVE &&
+                         !_reader->pollLength;
+            uint32_t _waitMs = 0;
+            if (_reader->intPin < 0 && _reader->pollStep == RFID_POLL_RECEIVE)
+                _waitMs = (_reader->checkWait() + 999) / 1000;
+            if (_waitMs < _reader->taskConfig.pollMs)
+                _waitMs = _reader->taskConfig.pollMs;
+            TickType_t _ticks = pdMS_TO_TICKS(_waitMs);
+            ulTaskNotifyTake(pdTRUE, _idle ? portMAX_DELAY : _ticks ? _ticks : 1);
+        }
+    }
+
+    _reader->task = NULL;
+    vTaskDelete(NULL);
 }
+#endif
 
 /**
  * @brief                   Clears the tag ID data on brekaout.
@@ -392,5 +1666,5 @@ char Rfid::intToHex(uint8_t _n)
 void Rfid::clear()
 {
     // Clear all previous data from the RFID reader.
-    sendAddress(3);
+    busAddress(3);
 }
\ No newline at end of file
@@ -14,6 +14,11 @@
 
 #include "Arduino.h"
 #include "libs/Generic-easyC/easyC.hpp"
+#include "RFID-EVENT.h"
+
+#if defined(ESP32)
+#include "RFID-TASK.h"
+#endif
 
 #if defined(ARDUINO_ESP32_DEV)
 #include "libs/ESPSoftwareSerial/ESPSoftwareSerial.h"
@@ -21,46 +26,293 @@
 #include "SoftwareSerial.h"
 #endif
 
+// Optional components of the reader, include their headers (RFID-CAPTURE.h, RFID-DEDUP.h, RFID-LATENCY.h,
+// RFID-METRICS.h) to use them.
+class RfidCapture;
+class RfidDedup;
+class RfidLatencyStats;
+class RfidMetrics;
+
+// Optional parts of the reader state. They are on by default, AVR leaves them out to keep the reader small. Set them
+// to 0 or 1 with a build flag (-D...), a #define in the sketch does not reach the library.
+// Adaptive easyC polling: setAdaptivePolling(), pollInterval().
+#ifndef RFID_ADAPTIVE_POLLING
+#if defined(__AVR__)
+#define RFID_ADAPTIVE_POLLING 0
+#else
+#define RFID_ADAPTIVE_POLLING 1
+#endif
+#endif
+
+// easyC bus utilisation and check rate: busUtilization(), pollRate().
+#ifndef RFID_BUS_STATS
+#if defined(__AVR__)
+#define RFID_BUS_STATS 0
+#else
+#define RFID_BUS_STATS 1
+#endif
+#endif
+
+// Metrics of the reader, its easyC bus and its software serial: setMetrics().
+#ifndef RFID_METRICS
+#if defined(__AVR__)
+#define RFID_METRICS 0
+#else
+#define RFID_METRICS 1
+#endif
+#endif
+
+// Read latency histograms: setLatencyStats().
+#ifndef RFID_LATENCY_STATS
+#if defined(__AVR__)
+#define RFID_LATENCY_STATS 0
+#else
+#define RFID_LATENCY_STATS 1
+#endif
+#endif
+
 // How long serial will still try to get the data from the last char that has been received.
 #define SERIAL_TIMEOUT_MS 20
 
+// Steps of the cooperative poll(): receiving the UART frame (checking the easyC register), reading the easyC tag ID and
+// decoding the frame (reading the easyC RAW data).
+#define RFID_POLL_RECEIVE 0
+#define RFID_POLL_ID      1
+#define RFID_POLL_DECODE  2
+
+// Adaptive easyC polling (setAdaptivePolling()): the fast check interval, the ceiling the interval backs off to while
+// no tag comes (both in microseconds) and how long the fast interval is kept after a tag (in milliseconds).
+#define RFID_ADAPTIVE_FAST_US    10000
+#define RFID_ADAPTIVE_CEILING_US 250000
+#define RFID_ADAPTIVE_BURST_MS   2000
+
+// Window of the easyC bus utilisation and the check rate, in microseconds.
+#define RFID_BUS_WINDOW_US 1000000
+
+// Callback for the tags delivered by poll() or by the reader task. Delegate on ESP32 (a lambda, or a function with its
+// context), function pointer on the other boards.
+#if defined(ESP32)
+typedef Delegate<void(const TagEvent &), void *> RfidTagCallback;
+#else
+typedef void (*RfidTagCallback)(const TagEvent &_event);
+#endif
+
 class Rfid : public EasyC
 {
   public:
     Rfid();
     Rfid(int _rxPin, int _txPin, uint32_t _baud);
+    Rfid(Stream &_serial);
+    Rfid(const Rfid &) = delete;
+    Rfid &operator=(const Rfid &) = delete;
+    Rfid(Rfid &&_other);
+    Rfid &operator=(Rfid &&_other);
+    virtual ~Rfid();
+    void end();
     bool checkHW();
     bool available();
+    bool poll(uint32_t _budgetMicros);
     uint32_t getId();
     uint64_t getRaw();
     void printHex64(uint64_t _number);
     void clear();
+    void setFrameValidation(bool _enable);
+    void setDuplicateFilter(RfidDedup *_filter);
+#if RFID_LATENCY_STATS
+    void setLatencyStats(RfidLatencyStats *_stats);
+#endif
+    void setCapture(RfidCapture *_capture);
+#if RFID_METRICS
+    bool setMetrics(RfidMetrics *_metrics, const char *_source);
+#endif
+#if RFID_ADAPTIVE_POLLING
+    void setAdaptivePolling(bool _enable, uint32_t _fastMicros = RFID_ADAPTIVE_FAST_US,
+                            uint32_t _ceilingMicros = RFID_ADAPTIVE_CEILING_US,
+                            uint32_t _burstMs = RFID_ADAPTIVE_BURST_MS);
+    uint32_t pollInterval();
+#endif
+#if RFID_BUS_STATS
+    float pollRate();
+    float busUtilization();
+#endif
+    bool attachInterruptPin(uint8_t _pin, int _mode = RISING);
+    void detachInterruptPin();
+    void onTag(RfidTagCallback _callback);
+#if defined(ESP32)
+    bool beginTask(RfidEventQueue &_queue, const RfidTaskConfig &_config = RfidTaskConfig());
+    void endTask();
+    bool taskRunning();
+    uint32_t droppedEvents();
+#endif
 
   protected:
     void initializeNative();
 
   private:
+    void createSerial();
+    void destroySerial();
+    void moveFrom(Rfid &_other);
+    void captureEdges();
+    static void intIsr(void *_rfid);
+#if !defined(ESP32)
+    static void intIsrStatic();
+#endif
+    void takeEdge();
+    bool deliver(bool _availableFlag);
+    TagEvent makeEvent();
+#if defined(ESP32)
+    static void taskLoop(void *_rfid);
+#endif
+    int busAddress(char _reg);
+    void busRead(char *_data, int _n);
+    void busTime(uint32_t _start);
+    void count(uint8_t _metric, uint32_t _n = 1);
+    void countBus(uint8_t _metric, bool _failed, int _error);
+    void countSerial();
+    void latencyBegin();
+    void latencyByte(bool _first);
+    void latencyStamp(uint8_t _stage);
+    void latencyEnd();
+#if RFID_BUS_STATS
+    void busWindow(uint32_t _now);
+#endif
+    bool checkDue();
+    void checkDone(bool _availableFlag);
+    uint32_t checkWait();
+    bool decodeFrame(char *_frame);
+    bool filterTag(bool _availableFlag);
     bool getTheSerialData(char *_data, int _n, int _serialTimeout);
     uint64_t getUint64(char *_c);
     int hexToInt(char _c);
     uint64_t get16Base(int _exp);
-    char intToHex(uint8_t _n);
 
     // Software Serial UART pins.
-    int rxPin;
-    int txPin;
+    int rxPin = -1;
+    int txPin = -1;
 
     // Software Serial baud rate. Default is 9600.
-    uint32_t baudRate;
+    uint32_t baudRate = 0;
 
-    // Software serial object (used for serial communication with RFID breakout board).
-    SoftwareSerial *rfidSerial;
+    // Serial used for communication with RFID breakout board (owned software serial or the one given to the
+    // constructor).
+    Stream *rfidSerial = NULL;
+
+    // Software serial owned by the reader, constructed in place in serialStorage, so the reader itself is not on the
+    // heap (on ESP32 the begin() of the software serial still allocates its buffers).
+    // NULL if not created or if the serial was given to the constructor.
+    SoftwareSerial *ownSerial = NULL;
+    alignas(SoftwareSerial) uint8_t serialStorage[sizeof(SoftwareSerial)];
 
     // Variables that holds the tagID for the serial.
     uint32_t tagID = 0;
 
     // Variables that holds the RFID RAW data for the serial.
     uint64_t rfidRAW = 0;
+
+    // easyC tag ID and RAW data already read from the breakout by available() or poll() and not yet taken by getId()
+    // and getRaw(). Without them getId() and getRaw() read the breakout.
+    bool idCached = false;
+    bool rawCached = false;
+
+    // Reject tags with corrupted EM4100 frame or with the frame that does not match the tag ID. Disabled by default.
+    bool frameValidation = false;
+
+    // Optional cache used to drop repeated reads of the same tag. NULL if not used.
+    RfidDedup *duplicateFilter = NULL;
+
+#if RFID_LATENCY_STATS
+    // Optional latency histograms. NULL if not used.
+    RfidLatencyStats *latencyStats = NULL;
+
+    // Time of the last received UART byte in microseconds (only updated when latency stats are used).
+    uint32_t lastByteMicros = 0;
+#endif
+
+    // Optional capture of the traffic. NULL if not used.
+    RfidCapture *capture = NULL;
+
+    // State of poll() between the calls: the step, the UART frame received so far with the time of its last byte
+    // (millis()), the easyC tag being read (a reader uses one interface, so it shares the memory with the frame) and
+    // the last measured time of each easyC step in microseconds.
+    uint8_t pollStep = RFID_POLL_RECEIVE;
+    union
+    {
+        char pollFrame[30] = {0};
+        struct
+        {
+            uint32_t id;
+            uint64_t raw;
+        } pollTag;
+    };
+    uint8_t pollLength = 0;
+    uint32_t pollLastByte = 0;
+    uint16_t pollStepMicros[3] = {0, 0, 0};
+
+#if RFID_ADAPTIVE_POLLING
+    // Adaptive easyC polling: the settings, the interval of the checks in microseconds (doubled after each check
+    // without a tag, up to the ceiling), the time of the last check (micros()) and of the last tag (millis()).
+    bool adaptive = false;
+    uint32_t adaptiveFast = RFID_ADAPTIVE_FAST_US;
+    uint32_t adaptiveCeiling = RFID_ADAPTIVE_CEILING_US;
+    uint32_t adaptiveBurstMs = RFID_ADAPTIVE_BURST_MS;
+    uint32_t adaptiveInterval = RFID_ADAPTIVE_FAST_US;
+    uint32_t adaptiveLastCheck = 0;
+    uint32_t adaptiveLastTag = 0;
+    bool adaptiveBurst = false;
+#endif
+
+#if RFID_BUS_STATS
+    // easyC bus time and the checks in the current window (started at busWindowStart, micros()), and the utilisation
+    // in percent and the checks per second of the last full window.
+    uint32_t busMicros = 0;
+    uint32_t busChecks = 0;
+    uint32_t busWindowStart = 0;
+    float busLastUtilization = 0;
+    float busLastRate = 0;
+#endif
+
+#if RFID_METRICS
+    // Metrics of the reader (RFID_METRIC_*) and the registry they are in, NULL if not registered.
+    volatile uint32_t *metrics = NULL;
+    RfidMetrics *metricsRegistry = NULL;
+
+    // Metrics of the easyC bus (RFID_METRIC_EASYC_*), in the same registry. NULL if not registered.
+    volatile uint32_t *busMetrics = NULL;
+#endif
+
+#if RFID_METRICS && defined(ARDUINO_ESP32_DEV)
+    // Metrics of the own software serial (RFID_METRIC_SERIAL_*), in the same registry, NULL if not registered, and its
+    // counters already added to them.
+    volatile uint32_t *serialMetrics = NULL;
+    SoftwareSerialCounters serialCounted;
+#endif
+
+    // INT pin of the breakout (-1 if not used) and its interrupt mode. The ISR arms the read and keeps the time of the
+    // edge (millis()), poll() takes it as the timestamp of the tag.
+    int intPin = -1;
+    int intMode = RISING;
+    volatile bool intArmed = false;
+    volatile uint32_t intMillis = 0;
+    bool pollEdge = false;
+    uint32_t pollEdgeMillis = 0;
+
+    // Callback for the tags read by poll() or by the reader task.
+    RfidTagCallback tagCallback = nullptr;
+
+#if !defined(ESP32)
+    // Reader with the INT pin (attachInterrupt() on AVR has no argument for the ISR).
+    static Rfid *intReader;
+#endif
+
+#if defined(ESP32)
+    // Reader task (NULL if not running), its queue and settings, the request to stop it and the tags that did not fit
+    // into the queue.
+    TaskHandle_t task = NULL;
+    RfidEventQueue *taskQueue = NULL;
+    RfidTaskConfig taskConfig;
+    volatile bool taskStop = false;
+    volatile uint32_t taskDropped = 0;
+#endif
 };
 
 #endif
\ No newline at end of file
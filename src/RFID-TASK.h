@@ -0,0 +1,56 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-TASK.h
+ * @brief       Settings of the reader task (ESP32 only) and the queue it hands the tags over to the application with.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_TASK__
+#define __RFID_TASK__
+
+#if defined(ESP32)
+
+#include "Arduino.h"
+#include "RFID-EVENT.h"
+#include "libs/ESPSoftwareSerial/circular_queue/circular_queue_waitable.h"
+
+// Core of the reader task, the Arduino loop runs on core 1.
+#define RFID_TASK_CORE 0
+
+/**
+ * Lock-free queue of the tags read by the reader task (one producer, the task, and one consumer, the application).
+ * Drain it with pop() / pop_n() from loop(), or sleep on it with pop_wait() from another task.
+ */
+typedef circular_queue_waitable<TagEvent> RfidEventQueue;
+
+/**
+ * Settings of the reader task, see Rfid::beginTask().
+ */
+struct RfidTaskConfig
+{
+    // FreeRTOS priority of the task (the Arduino loop task has priority 1).
+    UBaseType_t priority = 5;
+
+    // Core the task is pinned to, or tskNO_AFFINITY.
+    BaseType_t core = RFID_TASK_CORE;
+
+    // Stack of the task in bytes.
+    uint32_t stackSize = 4096;
+
+    // Time the task sleeps between the polls while no tag comes, in milliseconds.
+    uint32_t pollMs = 1;
+
+    // Budget of each Rfid::poll() in microseconds.
+    uint32_t budgetMicros = 1000;
+
+    // Index of the reader, put into the TagEvent.
+    uint8_t reader = 0;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,359 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-WIEGAND.cpp
+ * @brief       Non-blocking Wiegand 26/34 transmitter functions.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#include "RFID-WIEGAND.h"
+
+#if defined(ESP32)
+#include "soc/gpio_struct.h"
+#endif
+
+// update() can run from the timer ISR, its path is placed into IRAM on ESP32, other boards don't need it.
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// Transmitter states.
+#define RFID_WIEGAND_IDLE  0
+#define RFID_WIEGAND_PULSE 1
+#define RFID_WIEGAND_SPACE 2
+
+/**
+ * @brief                   Wiegand transmitter constructor.
+ *
+ * @param                   uint8_t _d0Pin
+ *                          Pin connected to the D0 line.
+ * @param                   uint8_t _d1Pin
+ *                          Pin connected to the D1 line.
+ */
+RfidWiegand::RfidWiegand(uint8_t _d0Pin, uint8_t _d1Pin)
+{
+    d0Pin = _d0Pin;
+    d1Pin = _d1Pin;
+
+#if defined(ESP32)
+    d0Mask = 1UL << (d0Pin % 32);
+    d1Mask = 1UL << (d1Pin % 32);
+#endif
+}
+
+#if defined(ESP32)
+RfidWiegand *RfidWiegand::timerWiegand = NULL;
+
+/**
+ * @brief                   Wiegand transmitter destructor, stops the timer.
+ */
+RfidWiegand::~RfidWiegand()
+{
+    endTimer();
+}
+#endif
+
+/**
+ * @brief                   Sets both lines to idle (high).
+ */
+void RfidWiegand::begin()
+{
+    digitalWrite(d0Pin, HIGH);
+    digitalWrite(d1Pin, HIGH);
+    pinMode(d0Pin, OUTPUT);
+    pinMode(d1Pin, OUTPUT);
+
+    // First frame can go out right away.
+    frameEnd = micros() - gapUs;
+}
+
+/**
+ * @brief                   Sets the timing of the pulses (check the access panel documentation).
+ *
+ * @param                   uint16_t _pulseUs
+ *                          Pulse width in microseconds (20 - 100 is usual).
+ * @param                   uint16_t _periodUs
+ *                          Time from one pulse start to the next one in microseconds (200 - 20000 is usual).
+ * @param                   uint32_t _gapUs
+ *                          Minimal time between two frames in microseconds.
+ */
+void RfidWiegand::setTiming(uint16_t _pulseUs, uint16_t _periodUs, uint32_t _gapUs)
+{
+    pulseUs = _pulseUs;
+    periodUs = _periodUs > _pulseUs ? _periodUs : _pulseUs + 1;
+    gapUs = _gapUs;
+}
+
+/**
+ * @brief                   Queues the tag ID to be sent.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID (as returned by Rfid::getId()). Wiegand 26 sends the low 24 bits (8 bit facility
+ *                          code and 16 bit card number), Wiegand 34 sends all 32 bits.
+ * @param                   uint8_t _format
+ *                          RFID_WIEGAND_26 or RFID_WIEGAND_34.
+ *
+ * @return                  bool - True if queued, false if the queue is full or the format is unknown.
+ */
+bool RfidWiegand::send(uint32_t _id, uint8_t _format)
+{
+    if (_format != RFID_WIEGAND_26 && _format != RFID_WIEGAND_34)
+        return false;
+
+    return sendBits(encode(_id, _format), _format);
+}
+
+/**
+ * @brief                   Queues the raw frame to be sent (for the formats that are not built in).
+ *
+ * @param                   uint64_t _bits
+ *                          Frame bits with the parity, the last bit sent is bit 0.
+ * @param                   uint8_t _length
+ *                          Number of bits (1 - 64).
+ *
+ * @return                  bool - True if queued, false if the queue is full.
+ */
+bool RfidWiegand::sendBits(uint64_t _bits, uint8_t _length)
+{
+    uint8_t _next = (head + 1) % RFID_WIEGAND_QUEUE_SIZE;
+    if (_next == tail || !_length || _length > 64)
+        return false;
+
+    queue[head].bits = _bits;
+    queue[head].length = _length;
+    head = _next;
+
+    return true;
+}
+
+/**
+ * @brief                   Checks if a frame is being sent or waits to be sent.
+ *
+ * @return                  bool - True if busy, false if idle.
+ */
+bool RfidWiegand::busy()
+{
+    return state != RFID_WIEGAND_IDLE || head != tail;
+}
+
+/**
+ * @brief                   Advances the transmitter, using micros() for the time.
+ */
+void IRAM_ATTR RfidWiegand::update()
+{
+    update(micros());
+}
+
+/**
+ * @brief                   Advances the transmitter. It only writes the pins when a pulse starts or ends, otherwise it
+ *                          returns right away.
+ *
+ * @param                   uint32_t _nowMicros
+ *                          Current time in microseconds (micros()).
+ */
+void IRAM_ATTR RfidWiegand::update(uint32_t _nowMicros)
+{
+    switch (state)
+    {
+    case RFID_WIEGAND_IDLE:
+        if (head != tail && (uint32_t)(_nowMicros - frameEnd) >= gapUs)
+        {
+            bit = 0;
+            pulse(_nowMicros);
+        }
+        break;
+
+    case RFID_WIEGAND_PULSE:
+        if ((uint32_t)(_nowMicros - pulseStart) >= pulseUs)
+        {
+            setLine(pin, HIGH);
+            state = RFID_WIEGAND_SPACE;
+        }
+        break;
+
+    case RFID_WIEGAND_SPACE:
+        if ((uint32_t)(_nowMicros - pulseStart) >= periodUs)
+        {
+            if (++bit < queue[tail].length)
+            {
+                pulse(_nowMicros);
+            }
+            else
+            {
+                // Frame is sent, free its place in the queue.
+                tail = (tail + 1) % RFID_WIEGAND_QUEUE_SIZE;
+                frameEnd = _nowMicros;
+                state = RFID_WIEGAND_IDLE;
+            }
+        }
+        break;
+    }
+}
+
+/**
+ * @brief                   Makes the Wiegand frame from the tag ID: even parity of the first half of the data bits,
+ *                          data bits, odd parity of the second half of the data bits.
+ *
+ * @param                   uint32_t _id
+ *                          Tag ID.
+ * @param                   uint8_t _format
+ *                          RFID_WIEGAND_26 or RFID_WIEGAND_34.
+ *
+ * @return                  uint64_t - Frame bits, the last bit sent is bit 0.
+ */
+uint64_t RfidWiegand::encode(uint32_t _id, uint8_t _format)
+{
+    if (_format == RFID_WIEGAND_34)
+    {
+        uint64_t _even = parity(_id >> 16);
+        uint64_t _odd = !parity(_id & 0xFFFF);
+        return (_even << 33) | ((uint64_t)_id << 1) | _odd;
+    }
+
+    uint32_t _data = _id & 0xFFFFFFUL;
+    uint32_t _even = parity(_data >> 12);
+    uint32_t _odd = !parity(_data & 0xFFF);
+    return ((uint64_t)_even << 25) | ((uint64_t)_data << 1) | _odd;
+}
+
+/**
+ * @brief                   Calculates the parity of the number.
+ *
+ * @param                   uint32_t _x
+ *                          Number.
+ *
+ * @return                  uint8_t - 1 if the number of set bits is odd, 0 if it's even.
+ */
+uint8_t RfidWiegand::parity(uint32_t _x)
+{
+    _x ^= _x >> 16;
+    _x ^= _x >> 8;
+    _x ^= _x >> 4;
+
+    // Bit n of 0x6996 is the parity of n.
+    return (0x6996 >> (_x & 0x0F)) & 1;
+}
+
+/**
+ * @brief                   Starts the pulse of the current bit on D0 or D1.
+ *
+ * @param                   uint32_t _nowMicros
+ *                          Current time in microseconds.
+ */
+void IRAM_ATTR RfidWiegand::pulse(uint32_t _nowMicros)
+{
+    const RfidWiegandFrame *_frame = &queue[tail];
+
+    pin = ((_frame->bits >> (_frame->length - 1 - bit)) & 1) ? d1Pin : d0Pin;
+    setLine(pin, LOW);
+
+    pulseStart = _nowMicros;
+    state = RFID_WIEGAND_PULSE;
+}
+
+/**
+ * @brief                   Sets the level of the D0 or D1 line.
+ *
+ * @param                   uint8_t _pin
+ *                          d0Pin or d1Pin.
+ * @param                   bool _level
+ *                          LOW for the pulse, HIGH for idle.
+ */
+void IRAM_ATTR RfidWiegand::setLine(uint8_t _pin, bool _level)
+{
+#if defined(ESP32)
+    // Write-1-to-set and write-1-to-clear registers change only this pin, a read-modify-write of the output register
+    // could undo a digitalWrite() of another pin done by loop() or by the other core in the meantime.
+    uint32_t _mask = _pin == d1Pin ? d1Mask : d0Mask;
+#if SOC_GPIO_PIN_COUNT > 32
+    if (_pin >= 32)
+    {
+        if (_level)
+            GPIO.out1_w1ts.val = _mask;
+        else
+            GPIO.out1_w1tc.val = _mask;
+        return;
+    }
+#endif
+    if (_level)
+        GPIO.out_w1ts = _mask;
+    else
+        GPIO.out_w1tc = _mask;
+#else
+    digitalWrite(_pin, _level);
+#endif
+}
+
+#if defined(ESP32)
+/**
+ * @brief                   Calls update() from the hardware timer every _tickUs, so the pulses are accurate whatever
+ *                          loop() does. Call it after begin() and do not call update() from loop() while the timer
+ *                          runs. Only one transmitter can use the timer.
+ *
+ * @param                   uint16_t _tickUs
+ *                          Timer period in microseconds. Pulse edges come on the ticks, so it should divide the pulse
+ *                          width and the bit period.
+ * @param                   uint8_t _timer
+ *                          Hardware timer (0 - 3), used by the 1.x and 2.x ESP32 cores only, 3.x takes a free one.
+ *
+ * @return                  bool - True if the timer runs, false if there is no free timer.
+ */
+bool RfidWiegand::beginTimer(uint16_t _tickUs, uint8_t _timer)
+{
+    endTimer();
+    if (timerWiegand)
+        return false;
+
+    uint16_t _alarm = _tickUs ? _tickUs : 1;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    (void)_timer;
+
+    // Timer counts microseconds.
+    timer = timerBegin(1000000);
+    if (!timer)
+        return false;
+
+    timerWiegand = this;
+    timerAttachInterrupt(timer, timerIsr);
+    timerAlarm(timer, _alarm, true, 0);
+#else
+    // 80 MHz APB clock divided to count microseconds.
+    timer = timerBegin(_timer, 80, true);
+    if (!timer)
+        return false;
+
+    timerWiegand = this;
+    timerAttachInterrupt(timer, timerIsr, true);
+    timerAlarmWrite(timer, _alarm, true);
+    timerAlarmEnable(timer);
+#endif
+
+    return true;
+}
+
+/**
+ * @brief                   Stops the timer started by beginTimer(). The frame being sent stops too, call update() from
+ *                          loop() to finish it.
+ */
+void RfidWiegand::endTimer()
+{
+    if (!timer)
+        return;
+
+    timerEnd(timer);
+    timer = NULL;
+    timerWiegand = NULL;
+}
+
+/**
+ * @brief                   Hardware timer ISR, advances the transmitter that started the timer.
+ */
+void IRAM_ATTR RfidWiegand::timerIsr()
+{
+    if (timerWiegand)
+        timerWiegand->update();
+}
+#endif
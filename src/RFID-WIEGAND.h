@@ -0,0 +1,120 @@
+/**
+ **************************************************
+ *
+ * @file        RFID-WIEGAND.h
+ * @brief       Header file for the non-blocking Wiegand 26/34 transmitter.
+ *
+ *
+ * @copyright   GNU General Public License v3.0
+ * @authors     Borna Biro for soldered.com
+ ***************************************************/
+
+#ifndef __RFID_WIEGAND__
+#define __RFID_WIEGAND__
+
+#include "Arduino.h"
+
+// Wiegand formats (the value is the number of bits in the frame).
+#define RFID_WIEGAND_26 26
+#define RFID_WIEGAND_34 34
+
+// Number of frames that can wait to be sent.
+#define RFID_WIEGAND_QUEUE_SIZE 4
+
+// Default timing in microseconds: pulse width, time from one pulse to the next one and the minimal gap between frames.
+#define RFID_WIEGAND_PULSE_US  50
+#define RFID_WIEGAND_PERIOD_US 1000
+#define RFID_WIEGAND_GAP_US    20000
+
+// Period of the ESP32 hardware timer calling update() in microseconds (see beginTimer()). Pulse edges come on the
+// ticks, so the tick should divide the pulse width and the bit period.
+#define RFID_WIEGAND_TICK_US 50
+
+// One frame, sent MSB first.
+struct RfidWiegandFrame
+{
+    uint64_t bits;
+    uint8_t length;
+};
+
+/**
+ * Sends the tag IDs to the access panel over Wiegand (D0 and D1 lines, idle high, a low pulse on D0 for 0 and on D1
+ * for 1). Frames are queued and clocked out by update(), which only changes the lines when it's time to. update() must
+ * be called by one of:
+ *
+ *      Timer                   On ESP32, beginTimer() calls update() from a hardware timer every RFID_WIEGAND_TICK_US,
+ *                              the pulses are accurate whatever loop() does. On the other boards call update() from a
+ *                              timer ISR of your own, for example with the TimerOne library:
+ *                              Timer1.initialize(50); Timer1.attachInterrupt(wiegandTick); with
+ *                              void wiegandTick() { wiegand.update(); }
+ *      loop()                  Call update() at least every pulse width. That only works if nothing else in loop()
+ *                              blocks: read the tags with Rfid::poll(), Rfid::available() waits for the whole UART
+ *                              frame and the easyC transactions and stretches the pulses.
+ *
+ * Do not use both at once.
+ */
+class RfidWiegand
+{
+  public:
+    RfidWiegand(uint8_t _d0Pin, uint8_t _d1Pin);
+#if defined(ESP32)
+    ~RfidWiegand();
+#endif
+    void begin();
+    void setTiming(uint16_t _pulseUs, uint16_t _periodUs, uint32_t _gapUs);
+    bool send(uint32_t _id, uint8_t _format = RFID_WIEGAND_26);
+    bool sendBits(uint64_t _bits, uint8_t _length);
+    bool busy();
+    void update();
+    void update(uint32_t _nowMicros);
+#if defined(ESP32)
+    bool beginTimer(uint16_t _tickUs = RFID_WIEGAND_TICK_US, uint8_t _timer = 0);
+    void endTimer();
+#endif
+    static uint64_t encode(uint32_t _id, uint8_t _format);
+
+  private:
+    static uint8_t parity(uint32_t _x);
+    void pulse(uint32_t _nowMicros);
+    void setLine(uint8_t _pin, bool _level);
+#if defined(ESP32)
+    static void timerIsr();
+#endif
+
+    // Wiegand output pins.
+    uint8_t d0Pin;
+    uint8_t d1Pin;
+
+    // Timing in microseconds.
+    uint16_t pulseUs = RFID_WIEGAND_PULSE_US;
+    uint16_t periodUs = RFID_WIEGAND_PERIOD_US;
+    uint32_t gapUs = RFID_WIEGAND_GAP_US;
+
+    // Frame queue, send() adds at the head, update() takes from the tail (safe with update() in the timer ISR).
+    RfidWiegandFrame queue[RFID_WIEGAND_QUEUE_SIZE];
+    volatile uint8_t head = 0;
+    volatile uint8_t tail = 0;
+
+    // State of the transmitter, the bit being sent and the times of the last pulse start and the last frame end. State
+    // and bit are changed by update() in the timer ISR while busy() reads them.
+    volatile uint8_t state = 0;
+    volatile uint8_t bit = 0;
+    uint8_t pin = 0;
+    uint32_t pulseStart = 0;
+    uint32_t frameEnd = 0;
+
+#if defined(ESP32)
+    // Bit masks of the lines in the GPIO set and clear registers, written directly by the timer ISR (digitalWrite() is
+    // not in IRAM on every core version).
+    uint32_t d0Mask = 0;
+    uint32_t d1Mask = 0;
+
+    // Hardware timer calling update(), NULL if not used.
+    hw_timer_t *timer = NULL;
+
+    // Transmitter updated by the timer ISR (only one transmitter can use the timer).
+    static RfidWiegand *timerWiegand;
+#endif
+};
+
+#endif
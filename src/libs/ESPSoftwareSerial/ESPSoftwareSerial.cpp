@@ -158,7 +158,7 @@ void SoftwareSerial::begin(uint32_t baud, SoftwareSerialConfig config,
             m_parityBuffer.reset(new circular_queue<uint8_t>((m_buffer->capacity() + 7) / 8));
             m_parityInPos = m_parityOutPos = 1;
         }
-        m_isrBuffer.reset(new circular_queue<uint32_t, SoftwareSerial*>((isrBufCapacity > 0) ?
+        m_isrBuffer.reset(new circular_queue<uint32_t>((isrBufCapacity > 0) ?
             isrBufCapacity : m_buffer->capacity() * (2 + m_dataBits + static_cast<bool>(m_parityMode))));
         if (m_buffer && (!m_parityMode || m_parityBuffer) && m_isrBuffer) {
             m_rxValid = true;
@@ -473,6 +473,7 @@ size_t IRAM_ATTR SoftwareSerial::write(const uint8_t* buffer, size_t size, Softw
     if (m_txEnableValid) {
         digitalWrite(m_txEnablePin, LOW);
     }
+    m_counters.txBytes += size;
     return size;
 }
 
@@ -508,14 +509,20 @@ void SoftwareSerial::rxBits() {
     if (m_isrOverflow.load()) {
         m_overflow = true;
         m_isrOverflow.store(false);
+        ++m_counters.isrOverflows;
     }
 #else
     if (m_isrOverflow.exchange(false)) {
         m_overflow = true;
+        ++m_counters.isrOverflows;
     }
 #endif
 
-    m_isrBuffer->for_each(m_isrBufferForEachDel);
+    // The lambda is passed by type, so the bit decoder is inlined into the drain loop.
+    m_isrBuffer->for_each([this](uint32_t&& isrCycle) {
+        if (rxEdgeHandler) { rxEdgeHandler(isrCycle); }
+        rxBits(isrCycle);
+    });
 
     // A stop bit can go undetected if leading data bits are at same level
     // and there was also no next start bit yet, so one word may be pending.
@@ -572,8 +579,10 @@ void SoftwareSerial::rxBits(const uint32_t isrCycle) {
             m_rxCurByte >>= (sizeof(uint8_t) * 8 - m_dataBits);
             if (!m_buffer->push(m_rxCurByte)) {
                 m_overflow = true;
+                ++m_counters.overflows;
             }
             else {
+                ++m_counters.rxBytes;
                 if (m_parityBuffer)
                 {
                     if (m_rxCurParity) {
@@ -591,6 +600,9 @@ void SoftwareSerial::rxBits(const uint32_t isrCycle) {
                 }
             }
         }
+        else {
+            ++m_counters.framingErrors;
+        }
         m_rxLastBit = m_pduBits - 1;
         // reset to 0 is important for masked bit logic
         m_rxCurByte = 0;
@@ -635,6 +647,10 @@ void SoftwareSerial::onReceive(Delegate<void(int available), void*> handler) {
     receiveHandler = handler;
 }
 
+void SoftwareSerial::onRxEdge(Delegate<void(uint32_t isrCycle), void*> handler) {
+    rxEdgeHandler = handler;
+}
+
 void SoftwareSerial::perform_work() {
     if (!m_rxValid) { return; }
     rxBits();
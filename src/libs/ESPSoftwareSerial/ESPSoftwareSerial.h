@@ -29,6 +29,20 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "circular_queue/circular_queue.h"
 #include <Stream.h>
 
+/// Counters of the received and sent bytes and of the errors, see SoftwareSerial::counters().
+struct SoftwareSerialCounters {
+    /// Bytes put into the rx buffer.
+    uint32_t rxBytes = 0;
+    /// Bytes sent.
+    uint32_t txBytes = 0;
+    /// Bytes dropped because the rx buffer was full.
+    uint32_t overflows = 0;
+    /// ISR edge buffer overflows, counted once per rx drain that finds the buffer overflowed.
+    uint32_t isrOverflows = 0;
+    /// Words dropped for the missing stop bit.
+    uint32_t framingErrors = 0;
+};
+
 enum SoftwareSerialParity : uint8_t {
     SWSERIAL_PARITY_NONE = 000,
     SWSERIAL_PARITY_EVEN = 020,
@@ -205,6 +219,12 @@ public:
 
     /// Set an event handler for received data.
     void onReceive(Delegate<void(int available), void*> handler);
+    /// Set a handler for the raw ISR timestamps of the rx pin edges (cycle count,
+    /// level in the LSB), called from rxBits() just before each one is decoded.
+    void onRxEdge(Delegate<void(uint32_t isrCycle), void*> handler);
+    /// Counters since the construction, updated by write() and as the rx bits
+    /// are decoded (available(), read(), perform_work()).
+    const SoftwareSerialCounters& counters() const { return m_counters; }
 
     /// Run the internal processing and event engine. Can be iteratively called
     /// from loop, or otherwise scheduled.
@@ -280,12 +300,13 @@ private:
 #endif
     // the ISR stores the relative bit times in the buffer. The inversion corrected level is used as sign bit (2's complement):
     // 1 = positive including 0, 0 = negative.
-    std::unique_ptr<circular_queue<uint32_t, SoftwareSerial*> > m_isrBuffer;
-    const Delegate<void(uint32_t&&), SoftwareSerial*> m_isrBufferForEachDel = { [](SoftwareSerial* self, uint32_t&& isrCycle) { self->rxBits(isrCycle); }, this };
+    std::unique_ptr<circular_queue<uint32_t> > m_isrBuffer;
     std::atomic<bool> m_isrOverflow;
     uint32_t m_isrLastCycle;
     bool m_rxCurParity = false;
     Delegate<void(int available), void*> receiveHandler;
+    Delegate<void(uint32_t isrCycle), void*> rxEdgeHandler;
+    SoftwareSerialCounters m_counters;
 };
 
 #endif
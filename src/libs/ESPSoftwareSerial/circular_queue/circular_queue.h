@@ -238,6 +238,29 @@ public:
     void for_each(Delegate<void(T&&), ForEachArg> fun);
 #endif
 
+#if defined(ESP8266) || defined(ESP32) || !defined(ARDUINO)
+    /*!
+        @brief	Iterate over and remove each available element from queue,
+                calling back any callable fun with an rvalue reference of every single element.
+                Unlike the Delegate overload, the call is resolved at compile time,
+                so a functor or lambda can be inlined into the loop.
+    */
+    template< typename F >
+    void for_each(F&& fun)
+    {
+        auto outPos = m_outPos.load(std::memory_order_acquire);
+        const auto inPos = m_inPos.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        while (outPos != inPos)
+        {
+            fun(std::move(m_buffer[outPos]));
+            std::atomic_thread_fence(std::memory_order_release);
+            outPos = (outPos + 1) % m_bufSize;
+            m_outPos.store(outPos, std::memory_order_release);
+        }
+    }
+#endif
+
     /*!
         @brief	In reverse order, iterate over, pop and optionally requeue each available element from the queue,
                 calling back fun with a reference of every single element.
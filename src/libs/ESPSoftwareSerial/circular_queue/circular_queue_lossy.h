@@ -0,0 +1,264 @@
+/*
+circular_queue_lossy.h - Implementation of an overwrite-oldest circular queue for EspSoftwareSerial.
+Copyright (c) 2019 Dirk O. Kaar. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __circular_queue_lossy_h
+#define __circular_queue_lossy_h
+
+#include "circular_queue.h"
+
+#if defined(ESP8266) || defined(ESP32) || !defined(ARDUINO)
+
+/*!
+    @brief	Instance class for a single-producer, single-consumer circular queue / ring buffer (FIFO)
+            that never blocks the producer. When the queue is full, the oldest element is discarded
+            to make room for the newest one, and the discard is counted.
+            Positions never wrap, each slot carries a sequence number derived from the position it
+            holds and its state (free, committed, being read). Producer and consumer race for the
+            oldest committed slot with a CAS on its sequence number, the winner owns the slot:
+            the producer overwrites it, the consumer copies it out. A slot the consumer is copying
+            is never written; if the producer finds the queue full and the oldest slot being read,
+            it discards the new element instead. The capacity is rounded up to the next power of two.
+*/
+template< typename T, typename ForEachArg = void >
+class circular_queue_lossy
+{
+public:
+    /*!
+        @brief	Constructs a valid, but zero-capacity dummy queue.
+    */
+    circular_queue_lossy() : m_bufMask(0)
+    {
+        m_inPos.store(0);
+        m_outPos.store(0);
+    }
+    /*!
+        @brief  Constructs a queue of at least the given maximum capacity.
+    */
+    circular_queue_lossy(const size_t capacity) : m_bufMask(roundCapacity(capacity) - 1),
+        m_buffer(new Slot[m_bufMask + 1])
+    {
+        for (size_t i = 0; i <= m_bufMask; ++i) m_buffer[i].seq.store(freeSeq(i), std::memory_order_relaxed);
+        m_inPos.store(0);
+        m_outPos.store(0);
+    }
+    circular_queue_lossy(const circular_queue_lossy&) = delete;
+    circular_queue_lossy& operator=(const circular_queue_lossy&) = delete;
+
+    /*!
+        @brief	Get the numer of elements the queue can hold at most.
+    */
+    size_t capacity() const
+    {
+        return m_buffer ? m_bufMask + 1 : 0;
+    }
+
+    /*!
+        @brief	Get a snapshot number of elements that can be retrieved by pop.
+    */
+    size_t available() const
+    {
+        const size_t avail = m_inPos.load() - m_outPos.load();
+        return min(avail, capacity());
+    }
+
+    /*!
+        @brief	Get a snapshot number of the remaining free elementes for pushing
+                without discarding the oldest one.
+    */
+    size_t available_for_push() const
+    {
+        return capacity() - available();
+    }
+
+    /*!
+        @brief	Move the rvalue parameter into the queue, overwriting the oldest
+                element if the queue is full.
+        @return true if the queue took the value, false for a zero-capacity queue or
+                if the value was discarded because the consumer is reading the oldest slot.
+    */
+    bool IRAM_ATTR push(T&& val)
+    {
+        if (!m_buffer) return false;
+        const auto inPos = m_inPos.load(std::memory_order_relaxed);
+        Slot& slot = m_buffer[inPos & m_bufMask];
+        auto seq = slot.seq.load(std::memory_order_acquire);
+        const size_t oldPos = inPos - m_bufMask - 1;
+        while (seq != freeSeq(inPos))
+        {
+            if (seq == readingSeq(oldPos))
+            {
+                // The consumer owns the oldest slot, the new element is the one discarded.
+                countDropped();
+                return false;
+            }
+            // Committed element from the previous lap: take the slot from the consumer.
+            // If the CAS fails, the consumer has just reserved or released it, look again.
+            if (slot.seq.compare_exchange_weak(seq, freeSeq(inPos), std::memory_order_acquire))
+            {
+                countDropped();
+                break;
+            }
+        }
+        slot.value = std::move(val);
+        slot.seq.store(committedSeq(inPos), std::memory_order_release);
+        m_inPos.store(inPos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        @brief	Push a copy of the parameter into the queue, overwriting the oldest
+                element if the queue is full.
+        @return true if the queue took the value, false for a zero-capacity queue or
+                if the value was discarded because the consumer is reading the oldest slot.
+    */
+    bool IRAM_ATTR push(const T& val)
+    {
+        T v(val);
+        return push(std::move(v));
+    }
+
+    /*!
+        @brief	Pop the next available element from the queue.
+        @return A copy of the popped element, or a default
+                value of type T if the queue is empty.
+    */
+    T pop()
+    {
+        T val;
+        return pop(val) ? val : defaultValue;
+    }
+
+    /*!
+        @brief	Pop the next available element from the queue.
+        @return true if an element was popped into val, false if the queue was empty.
+    */
+    bool pop(T& val)
+    {
+        if (!m_buffer) return false;
+        auto outPos = m_outPos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const auto inPos = m_inPos.load(std::memory_order_acquire);
+            if (inPos == outPos) return false;
+            // Elements older than one lap behind the producer have been overwritten.
+            if (inPos - outPos > m_bufMask + 1) outPos = inPos - m_bufMask - 1;
+
+            Slot& slot = m_buffer[outPos & m_bufMask];
+            auto seq = committedSeq(outPos);
+            // Reserve the slot first, then copy: the producer never writes a slot being read.
+            if (slot.seq.compare_exchange_strong(seq, readingSeq(outPos), std::memory_order_acquire))
+            {
+                val = std::move(slot.value);
+                slot.seq.store(freeSeq(outPos + m_bufMask + 1), std::memory_order_release);
+                m_outPos.store(outPos + 1, std::memory_order_release);
+                return true;
+            }
+            // The producer took the slot for a newer element, this one was discarded.
+            ++outPos;
+            m_outPos.store(outPos, std::memory_order_release);
+        }
+    }
+
+    /*!
+        @brief	Pop multiple elements in ordered sequence from the queue to a buffer.
+        @return The number of elements actually popped from the queue to
+                buffer.
+    */
+    size_t pop_n(T* buffer, size_t size)
+    {
+        size_t n = 0;
+        while (n < size && pop(buffer[n])) ++n;
+        return n;
+    }
+
+    /*!
+        @brief	Iterate over and remove each available element from queue,
+                calling back fun with an rvalue reference of every single element.
+    */
+    void for_each(const Delegate<void(T&&), ForEachArg>& fun)
+    {
+        T val;
+        while (pop(val)) fun(std::move(val));
+    }
+
+    /*!
+        @brief	Iterate over and remove each available element from queue,
+                calling back any callable fun with an rvalue reference of every single element,
+                resolved at compile time.
+    */
+    template< typename F >
+    void for_each(F&& fun)
+    {
+        T val;
+        while (pop(val)) fun(std::move(val));
+    }
+
+    /*!
+        @brief	Discard all data in the queue. Consumer side only.
+    */
+    void flush()
+    {
+        T val;
+        while (pop(val)) {}
+    }
+
+    /*!
+        @brief	Get the number of elements that were discarded before the consumer popped them.
+    */
+    uint32_t dropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+protected:
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    static size_t roundCapacity(size_t capacity)
+    {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        return cap;
+    }
+
+    // Sequence numbers of a slot: free for the element at pos, holding it, or being read by the consumer.
+    static size_t freeSeq(size_t pos) { return pos * 4; }
+    static size_t committedSeq(size_t pos) { return pos * 4 + 1; }
+    static size_t readingSeq(size_t pos) { return pos * 4 + 2; }
+
+    void IRAM_ATTR countDropped()
+    {
+        // Only the producer writes the counter.
+        m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    const T defaultValue = {};
+    size_t m_bufMask;
+    std::unique_ptr<Slot[]> m_buffer;
+    std::atomic<size_t> m_inPos;
+    std::atomic<size_t> m_outPos;
+    std::atomic<uint32_t> m_dropped { 0 };
+};
+
+#endif
+
+#endif // __circular_queue_lossy_h
@@ -0,0 +1,290 @@
+/*
+circular_queue_mpsc.h - Implementation of a lock-free multi-producer circular queue for EspSoftwareSerial.
+Copyright (c) 2019 Dirk O. Kaar. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __circular_queue_mpsc_h
+#define __circular_queue_mpsc_h
+
+#include "circular_queue.h"
+
+#if defined(ESP8266) || defined(ESP32) || !defined(ARDUINO)
+
+/*!
+    @brief	Instance class for a multi-producer, single-consumer circular queue / ring buffer (FIFO).
+            Unlike circular_queue_mp, producers are not serialized by a lock. Each producer
+            reserves a slot by CAS on the input position and commits it by publishing the slot's
+            sequence number, so a preempted producer never blocks the other producers.
+            The consumer only ever sees committed slots, in reservation order. A producer that
+            has reserved but not yet committed its slot holds back the consumer at that slot.
+            The capacity is rounded up to the next power of two.
+*/
+template< typename T, typename ForEachArg = void >
+class circular_queue_mpsc
+{
+public:
+    /*!
+        @brief	Constructs a valid, but zero-capacity dummy queue.
+    */
+    circular_queue_mpsc() : m_bufMask(0)
+    {
+        m_inPos.store(0);
+        m_outPos.store(0);
+    }
+    /*!
+        @brief  Constructs a queue of at least the given maximum capacity.
+    */
+    circular_queue_mpsc(const size_t capacity) : m_bufMask(roundCapacity(capacity) - 1),
+        m_buffer(new Slot[m_bufMask + 1])
+    {
+        for (size_t i = 0; i <= m_bufMask; ++i) m_buffer[i].seq.store(i, std::memory_order_relaxed);
+        m_inPos.store(0);
+        m_outPos.store(0);
+    }
+    circular_queue_mpsc(const circular_queue_mpsc&) = delete;
+    circular_queue_mpsc& operator=(const circular_queue_mpsc&) = delete;
+
+    /*!
+        @brief	Get the numer of elements the queue can hold at most.
+    */
+    size_t capacity() const
+    {
+        return m_buffer ? m_bufMask + 1 : 0;
+    }
+
+    /*!
+        @brief	Get a snapshot number of elements that are reserved by producers.
+                Elements that are reserved but not yet committed are included.
+    */
+    size_t available() const
+    {
+        return m_inPos.load() - m_outPos.load();
+    }
+
+    /*!
+        @brief	Get a snapshot number of the remaining free elementes for pushing.
+    */
+    size_t available_for_push() const
+    {
+        return capacity() - available();
+    }
+
+    /*!
+        @brief	Move the rvalue parameter into the queue, lock-free
+                for multiple concurrent producers.
+        @return true if the queue accepted the value, false if the queue
+                was full.
+    */
+    bool IRAM_ATTR push(T&& val)
+    {
+        if (!m_buffer) return false;
+        auto inPos = m_inPos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;)
+        {
+            slot = &m_buffer[inPos & m_bufMask];
+            const auto seq = slot->seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<ptrdiff_t>(seq - inPos);
+            if (!diff)
+            {
+                // Slot is free for this position, try to reserve it.
+                if (m_inPos.compare_exchange_weak(inPos, inPos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0)
+            {
+                // The slot still holds the element from the previous lap: full.
+                return false;
+            }
+            else
+            {
+                // Another producer took this position, retry with the current one.
+                inPos = m_inPos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::move(val);
+        slot->seq.store(inPos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        @brief	Push a copy of the parameter into the queue, lock-free
+                for multiple concurrent producers.
+        @return true if the queue accepted the value, false if the queue
+                was full.
+    */
+    bool IRAM_ATTR push(const T& val)
+    {
+        T v(val);
+        return push(std::move(v));
+    }
+
+    /*!
+        @brief	Push copies of multiple elements from a buffer into the queue,
+                in order, beginning at buffer's head. The block is reserved with
+                a single CAS, so push_n() is atomic with respect to other producers.
+        @return The number of elements actually copied into the queue, counted
+                from the buffer head.
+    */
+    size_t push_n(const T* buffer, size_t size);
+
+    /*!
+        @brief	Pop the next available element from the queue.
+        @return An rvalue copy of the popped element, or a default
+                value of type T if the queue is empty.
+    */
+    T pop();
+
+    /*!
+        @brief	Pop multiple elements in ordered sequence from the queue to a buffer.
+                If buffer is nullptr, simply discards up to size elements from the queue.
+        @return The number of elements actually popped from the queue to
+                buffer.
+    */
+    size_t pop_n(T* buffer, size_t size);
+
+    /*!
+        @brief	Iterate over and remove each available element from queue,
+                calling back fun with an rvalue reference of every single element.
+    */
+    void for_each(const Delegate<void(T&&), ForEachArg>& fun);
+
+    /*!
+        @brief	Iterate over and remove each available element from queue,
+                calling back any callable fun with an rvalue reference of every single element,
+                resolved at compile time.
+    */
+    template< typename F >
+    void for_each(F&& fun)
+    {
+        if (!m_buffer) return;
+        auto outPos = m_outPos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while ((slot = committed(outPos)))
+        {
+            fun(std::move(slot->value));
+            release(slot, outPos);
+            ++outPos;
+        }
+    }
+
+protected:
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    static size_t roundCapacity(size_t capacity)
+    {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        return cap;
+    }
+
+    /*!
+        @brief	Check if the slot at the current output position has been committed.
+    */
+    Slot* committed(size_t outPos) const
+    {
+        Slot* slot = &m_buffer[outPos & m_bufMask];
+        return (slot->seq.load(std::memory_order_acquire) == outPos + 1) ? slot : nullptr;
+    }
+
+    /*!
+        @brief	Hand the slot back to the producers for the next lap.
+    */
+    void release(Slot* slot, size_t outPos)
+    {
+        slot->seq.store(outPos + m_bufMask + 1, std::memory_order_release);
+        m_outPos.store(outPos + 1, std::memory_order_release);
+    }
+
+    const T defaultValue = {};
+    size_t m_bufMask;
+    std::unique_ptr<Slot[]> m_buffer;
+    std::atomic<size_t> m_inPos;
+    std::atomic<size_t> m_outPos;
+};
+
+template< typename T, typename ForEachArg >
+size_t circular_queue_mpsc<T, ForEachArg>::push_n(const T* buffer, size_t size)
+{
+    if (!m_buffer || !size) return 0;
+    auto inPos = m_inPos.load(std::memory_order_relaxed);
+    size_t blockSize;
+    do {
+        // Every slot below outPos + capacity has been handed back by the consumer.
+        const auto outPos = m_outPos.load(std::memory_order_acquire);
+        blockSize = min(size, static_cast<size_t>(m_bufMask + 1 - (inPos - outPos)));
+        if (!blockSize) return 0;
+    } while (!m_inPos.compare_exchange_weak(inPos, inPos + blockSize, std::memory_order_relaxed));
+
+    for (size_t i = 0; i < blockSize; ++i)
+    {
+        Slot& slot = m_buffer[(inPos + i) & m_bufMask];
+        slot.value = buffer[i];
+        slot.seq.store(inPos + i + 1, std::memory_order_release);
+    }
+    return blockSize;
+}
+
+template< typename T, typename ForEachArg >
+T circular_queue_mpsc<T, ForEachArg>::pop()
+{
+    if (!m_buffer) return defaultValue;
+    const auto outPos = m_outPos.load(std::memory_order_relaxed);
+    Slot* slot = committed(outPos);
+    if (!slot) return defaultValue;
+    auto val = std::move(slot->value);
+    release(slot, outPos);
+    return val;
+}
+
+template< typename T, typename ForEachArg >
+size_t circular_queue_mpsc<T, ForEachArg>::pop_n(T* buffer, size_t size)
+{
+    if (!m_buffer) return 0;
+    auto outPos = m_outPos.load(std::memory_order_relaxed);
+    size_t n = 0;
+    Slot* slot;
+    while (n < size && (slot = committed(outPos)))
+    {
+        if (buffer) buffer[n] = std::move(slot->value);
+        release(slot, outPos);
+        ++outPos;
+        ++n;
+    }
+    return n;
+}
+
+template< typename T, typename ForEachArg >
+void circular_queue_mpsc<T, ForEachArg>::for_each(const Delegate<void(T&&), ForEachArg>& fun)
+{
+    if (!m_buffer) return;
+    auto outPos = m_outPos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while ((slot = committed(outPos)))
+    {
+        fun(std::move(slot->value));
+        release(slot, outPos);
+        ++outPos;
+    }
+}
+
+#endif
+
+#endif // __circular_queue_mpsc_h
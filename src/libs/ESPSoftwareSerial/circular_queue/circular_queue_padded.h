@@ -0,0 +1,239 @@
+/*
+circular_queue_padded.h - Implementation of a lock-free, cache-line isolated circular queue for EspSoftwareSerial.
+Copyright (c) 2019 Dirk O. Kaar. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __circular_queue_padded_h
+#define __circular_queue_padded_h
+
+#include "circular_queue.h"
+
+#if defined(ESP8266) || defined(ESP32) || !defined(ARDUINO)
+
+#ifndef CIRCULAR_QUEUE_CACHE_LINE_SIZE
+#if defined(ESP8266) || defined(ESP32)
+#define CIRCULAR_QUEUE_CACHE_LINE_SIZE 32
+#else
+#define CIRCULAR_QUEUE_CACHE_LINE_SIZE 64
+#endif
+#endif
+
+/*!
+    @brief	Instance class for a single-producer, single-consumer circular queue / ring buffer (FIFO),
+            with the same lock-free semantics as circular_queue, but laid out for a producer and
+            a consumer that run on different cores.
+            The producer's and the consumer's positions are padded onto separate cache lines, and
+            each side keeps a local copy of the other side's position. That copy is only refreshed
+            when the queue looks full to the producer or empty to the consumer, so in steady state
+            push and pop do not touch the other core's cache line at all.
+*/
+template< typename T, typename ForEachArg = void >
+class circular_queue_padded
+{
+public:
+    /*!
+        @brief	Constructs a valid, but zero-capacity dummy queue.
+    */
+    circular_queue_padded() : m_bufSize(1)
+    {
+        m_inPos.store(0);
+        m_outPos.store(0);
+    }
+    /*!
+        @brief  Constructs a queue of the given maximum capacity.
+    */
+    circular_queue_padded(const size_t capacity) : m_bufSize(capacity + 1), m_buffer(new T[m_bufSize])
+    {
+        m_inPos.store(0);
+        m_outPos.store(0);
+    }
+    circular_queue_padded(const circular_queue_padded&) = delete;
+    circular_queue_padded& operator=(const circular_queue_padded&) = delete;
+
+    /*!
+        @brief	Get the numer of elements the queue can hold at most.
+    */
+    size_t capacity() const
+    {
+        return m_bufSize - 1;
+    }
+
+    /*!
+        @brief	Discard all data in the queue. Consumer side only.
+    */
+    void flush()
+    {
+        m_outPos.store(m_cachedInPos = m_inPos.load());
+    }
+
+    /*!
+        @brief	Get a snapshot number of elements that can be retrieved by pop.
+    */
+    size_t available() const
+    {
+        int avail = static_cast<int>(m_inPos.load() - m_outPos.load());
+        if (avail < 0) avail += m_bufSize;
+        return avail;
+    }
+
+    /*!
+        @brief	Get the remaining free elementes for pushing.
+    */
+    size_t available_for_push() const
+    {
+        int avail = static_cast<int>(m_outPos.load() - m_inPos.load()) - 1;
+        if (avail < 0) avail += m_bufSize;
+        return avail;
+    }
+
+    /*!
+        @brief	Move the rvalue parameter into the queue.
+        @return true if the queue accepted the value, false if the queue
+                was full.
+    */
+    inline bool IRAM_ATTR push(T&& val) __attribute__((always_inline))
+    {
+        const auto inPos = m_inPos.load(std::memory_order_relaxed);
+        const size_t next = (inPos + 1 == m_bufSize) ? 0 : inPos + 1;
+        if (next == m_cachedOutPos)
+        {
+            // Looks full, only now fetch the consumer's position from its cache line.
+            m_cachedOutPos = m_outPos.load(std::memory_order_acquire);
+            if (next == m_cachedOutPos) return false;
+        }
+
+        m_buffer[inPos] = std::move(val);
+
+        m_inPos.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        @brief	Push a copy of the parameter into the queue.
+        @return true if the queue accepted the value, false if the queue
+                was full.
+    */
+    inline bool IRAM_ATTR push(const T& val) __attribute__((always_inline))
+    {
+        T v(val);
+        return push(std::move(v));
+    }
+
+    /*!
+        @brief	Pop the next available element from the queue.
+        @return An rvalue copy of the popped element, or a default
+                value of type T if the queue is empty.
+    */
+    T pop()
+    {
+        const auto outPos = m_outPos.load(std::memory_order_relaxed);
+        if (outPos == m_cachedInPos)
+        {
+            // Looks empty, only now fetch the producer's position from its cache line.
+            m_cachedInPos = m_inPos.load(std::memory_order_acquire);
+            if (outPos == m_cachedInPos) return defaultValue;
+        }
+
+        auto val = std::move(m_buffer[outPos]);
+
+        m_outPos.store((outPos + 1 == m_bufSize) ? 0 : outPos + 1, std::memory_order_release);
+        return val;
+    }
+
+    /*!
+        @brief	Pop multiple elements in ordered sequence from the queue to a buffer.
+                If buffer is nullptr, simply discards up to size elements from the queue.
+        @return The number of elements actually popped from the queue to
+                buffer.
+    */
+    size_t pop_n(T* buffer, size_t size);
+
+    /*!
+        @brief	Iterate over and remove each available element from queue,
+                calling back fun with an rvalue reference of every single element.
+    */
+    void for_each(const Delegate<void(T&&), ForEachArg>& fun);
+
+    /*!
+        @brief	Iterate over and remove each available element from queue,
+                calling back any callable fun with an rvalue reference of every single element,
+                resolved at compile time.
+    */
+    template< typename F >
+    void for_each(F&& fun)
+    {
+        auto outPos = m_outPos.load(std::memory_order_relaxed);
+        m_cachedInPos = m_inPos.load(std::memory_order_acquire);
+        while (outPos != m_cachedInPos)
+        {
+            fun(std::move(m_buffer[outPos]));
+            outPos = (outPos + 1 == m_bufSize) ? 0 : outPos + 1;
+            m_outPos.store(outPos, std::memory_order_release);
+        }
+    }
+
+protected:
+    // Read-only after construction, shared by both sides.
+    alignas(CIRCULAR_QUEUE_CACHE_LINE_SIZE) const T defaultValue = {};
+    size_t m_bufSize;
+    std::unique_ptr<T[]> m_buffer;
+    // Written by the producer.
+    alignas(CIRCULAR_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_inPos;
+    size_t m_cachedOutPos = 0;
+    // Written by the consumer.
+    alignas(CIRCULAR_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> m_outPos;
+    size_t m_cachedInPos = 0;
+    // Keeps whatever follows the queue off the consumer's line.
+    alignas(CIRCULAR_QUEUE_CACHE_LINE_SIZE) char m_tailPad[1] = {};
+};
+
+template< typename T, typename ForEachArg >
+size_t circular_queue_padded<T, ForEachArg>::pop_n(T* buffer, size_t size)
+{
+    const auto outPos = m_outPos.load(std::memory_order_relaxed);
+    m_cachedInPos = m_inPos.load(std::memory_order_acquire);
+    int avail = static_cast<int>(m_cachedInPos - outPos);
+    if (avail < 0) avail += m_bufSize;
+    size = min(size, static_cast<size_t>(avail));
+    if (!size) return 0;
+
+    if (buffer) {
+        const size_t n = min(size, static_cast<size_t>(m_bufSize - outPos));
+        buffer = std::copy_n(std::make_move_iterator(m_buffer.get() + outPos), n, buffer);
+        std::copy_n(std::make_move_iterator(m_buffer.get()), size - n, buffer);
+    }
+
+    m_outPos.store((outPos + size) % m_bufSize, std::memory_order_release);
+    return size;
+}
+
+template< typename T, typename ForEachArg >
+void circular_queue_padded<T, ForEachArg>::for_each(const Delegate<void(T&&), ForEachArg>& fun)
+{
+    auto outPos = m_outPos.load(std::memory_order_relaxed);
+    m_cachedInPos = m_inPos.load(std::memory_order_acquire);
+    while (outPos != m_cachedInPos)
+    {
+        fun(std::move(m_buffer[outPos]));
+        outPos = (outPos + 1 == m_bufSize) ? 0 : outPos + 1;
+        m_outPos.store(outPos, std::memory_order_release);
+    }
+}
+
+#endif
+
+#endif // __circular_queue_padded_h
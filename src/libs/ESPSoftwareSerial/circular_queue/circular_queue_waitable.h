@@ -0,0 +1,225 @@
+/*
+circular_queue_waitable.h - Implementation of a circular queue with blocking pop for EspSoftwareSerial.
+Copyright (c) 2019 Dirk O. Kaar. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __circular_queue_waitable_h
+#define __circular_queue_waitable_h
+
+#include "circular_queue.h"
+
+#if defined(ESP32) || !defined(ARDUINO)
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+/*!
+    @brief	Instance class for a single-producer, single-consumer circular queue / ring buffer (FIFO),
+            which in addition to the lock-free circular_queue interface lets the consumer sleep until
+            data arrives or a timeout expires.
+            The consumer registers itself as waiting only after it found the queue empty, and the producer
+            signals only while a consumer is registered. Besides a memory fence, a push into a busy queue
+            only does a relaxed load of the waiter, the atomic exchange runs only with a registered consumer.
+            On ESP32 the consumer task is woken by a FreeRTOS task notification, otherwise by a
+            condition variable.
+*/
+template< typename T, typename ForEachArg = void >
+class circular_queue_waitable : protected circular_queue<T, ForEachArg>
+{
+public:
+    /*!
+        @brief	Timeout value for the wait functions to wait without a limit.
+    */
+    static constexpr uint32_t WAIT_FOREVER = ~static_cast<uint32_t>(0);
+
+    circular_queue_waitable() = default;
+    circular_queue_waitable(const size_t capacity) : circular_queue<T, ForEachArg>(capacity)
+    {}
+    using circular_queue<T, ForEachArg>::capacity;
+    using circular_queue<T, ForEachArg>::flush;
+    using circular_queue<T, ForEachArg>::available;
+    using circular_queue<T, ForEachArg>::available_for_push;
+    using circular_queue<T, ForEachArg>::peek;
+    using circular_queue<T, ForEachArg>::pop;
+    using circular_queue<T, ForEachArg>::pop_n;
+    using circular_queue<T, ForEachArg>::for_each;
+
+    /*!
+        @brief	Move the rvalue parameter into the queue and wake a waiting consumer.
+        @return true if the queue accepted the value, false if the queue
+                was full.
+    */
+    bool push(T&& val)
+    {
+        if (!circular_queue<T, ForEachArg>::push(std::move(val))) return false;
+        signal();
+        return true;
+    }
+
+    /*!
+        @brief	Push a copy of the parameter into the queue and wake a waiting consumer.
+        @return true if the queue accepted the value, false if the queue
+                was full.
+    */
+    bool push(const T& val)
+    {
+        T v(val);
+        return push(std::move(v));
+    }
+
+    /*!
+        @brief	Push copies of multiple elements from a buffer into the queue and
+                wake a waiting consumer.
+        @return The number of elements actually copied into the queue, counted
+                from the buffer head.
+    */
+    size_t push_n(const T* buffer, size_t size)
+    {
+        const auto n = circular_queue<T, ForEachArg>::push_n(buffer, size);
+        if (n) signal();
+        return n;
+    }
+
+#if defined(ESP32)
+    /*!
+        @brief	Move the rvalue parameter into the queue from an ISR and wake a waiting consumer.
+        @return true if the queue accepted the value, false if the queue
+                was full.
+    */
+    bool IRAM_ATTR push_from_isr(T&& val)
+    {
+        if (!circular_queue<T, ForEachArg>::push(std::move(val))) return false;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!m_waiter.load(std::memory_order_relaxed)) return true;
+        TaskHandle_t waiter = m_waiter.exchange(nullptr);
+        if (waiter)
+        {
+            BaseType_t woken = pdFALSE;
+            vTaskNotifyGiveFromISR(waiter, &woken);
+            if (woken) { portYIELD_FROM_ISR(); }
+        }
+        return true;
+    }
+#endif
+
+    /*!
+        @brief	Pop the next element from the queue, sleeping until one is
+                available or the timeout expires.
+        @param  val Receives the popped element.
+        @param  timeoutMs Maximum time to wait in milliseconds, WAIT_FOREVER for no limit.
+        @return true if an element was popped, false on timeout.
+    */
+    bool pop_wait(T& val, uint32_t timeoutMs)
+    {
+        if (!wait(timeoutMs)) return false;
+        val = circular_queue<T, ForEachArg>::pop();
+        return true;
+    }
+
+    /*!
+        @brief	Pop up to size elements from the queue to buffer, sleeping until at
+                least one is available or the timeout expires.
+        @param  timeoutMs Maximum time to wait in milliseconds, WAIT_FOREVER for no limit.
+        @return The number of elements actually popped, 0 on timeout.
+    */
+    size_t pop_n_wait(T* buffer, size_t size, uint32_t timeoutMs)
+    {
+        if (!size || !wait(timeoutMs)) return 0;
+        return circular_queue<T, ForEachArg>::pop_n(buffer, size);
+    }
+
+protected:
+    /*!
+        @brief	Wake the consumer if it has registered for waiting on an empty queue.
+    */
+    void signal()
+    {
+        // Pairs with the fence in wait(): either the consumer sees the new element
+        // on its re-check, or the producer sees the registered consumer. The fence is
+        // a barrier only, the exchange is done only when a consumer is registered.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+#if defined(ESP32)
+        if (!m_waiter.load(std::memory_order_relaxed)) return;
+        TaskHandle_t waiter = m_waiter.exchange(nullptr);
+        if (waiter) xTaskNotifyGive(waiter);
+#else
+        if (m_waiting.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_cv.notify_one();
+        }
+#endif
+    }
+
+    /*!
+        @brief	Sleep until the queue is non-empty or the timeout expires.
+        @return true if there is at least one element available.
+    */
+    bool wait(uint32_t timeoutMs)
+    {
+        if (circular_queue<T, ForEachArg>::available()) return true;
+        if (!timeoutMs) return false;
+#if defined(ESP32)
+        const TickType_t ticks = (WAIT_FOREVER == timeoutMs) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+        const TickType_t start = xTaskGetTickCount();
+        for (;;)
+        {
+            m_waiter.store(xTaskGetCurrentTaskHandle());
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (circular_queue<T, ForEachArg>::available()) break;
+            TickType_t remaining = portMAX_DELAY;
+            if (portMAX_DELAY != ticks)
+            {
+                const TickType_t elapsed = xTaskGetTickCount() - start;
+                if (elapsed >= ticks) break;
+                remaining = ticks - elapsed;
+            }
+            // Stale notifications from an earlier wait only cause another round.
+            ulTaskNotifyTake(pdTRUE, remaining);
+            if (circular_queue<T, ForEachArg>::available()) break;
+        }
+        m_waiter.store(nullptr);
+#else
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto ready = [this]() { return circular_queue<T, ForEachArg>::available() != 0; };
+        if (WAIT_FOREVER == timeoutMs) m_cv.wait(lock, ready);
+        else m_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready);
+        m_waiting.store(false, std::memory_order_relaxed);
+#endif
+        return circular_queue<T, ForEachArg>::available();
+    }
+
+#if defined(ESP32)
+    std::atomic<TaskHandle_t> m_waiter { nullptr };
+#else
+    std::atomic<bool> m_waiting { false };
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+#endif
+};
+
+#endif
+
+#endif // __circular_queue_waitable_h